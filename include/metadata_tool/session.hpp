@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// Embeddable API: inspect and strip from your own process instead of spawning the CLI.
+// A Session holds the built policy, per-thread scratch buffers and the worker pool
+// settings for batch calls. Every method is const and a Session can be shared between
+// threads. Nothing here exposes the internal `core` types, so it stays stable across
+// releases.
+namespace metasweep {
+
+enum class FileType { Unknown, Image, PDF, Audio, ZIP };
+
+struct Field {
+  std::string name;  // canonical, e.g. "EXIF.GPSLatitude"
+  std::string value;
+  std::string risk;  // HIGH|MEDIUM|LOW|SAFE
+  std::string block; // EXIF / XMP / IPTC / PDF.Info / ID3 / ZIP ...
+  std::size_t bytes = 0;
+};
+
+struct Result {
+  std::string file;
+  FileType type = FileType::Unknown;
+  std::vector<std::string> blocks; // metadata blocks present, e.g. ["EXIF","XMP"]
+  std::vector<Field> fields;
+  std::size_t meta_bytes = 0;
+  std::string verdict;             // highest field risk, or "NONE"
+  bool ok = true;                  // false: unreadable input, unsupported type, no output written,
+                                   // or sink refused
+  std::string error;
+};
+
+struct PolicyOptions {
+  bool safe = false;               // built-in safe policy instead of aggressive
+  std::string custom;              // policy file (YAML/JSON)
+  std::vector<std::string> keep;   // glob patterns on canonical names
+  std::vector<std::string> drop;
+};
+
+struct SessionOptions {
+  PolicyOptions policy;
+  unsigned jobs = 1;               // worker threads for batch calls (0 = one per core)
+  std::string max_memory;          // budget for batch calls, e.g. "2G" (empty = unlimited)
+};
+
+// Receives the cleaned file. Return false to report the strip as failed.
+using Sink = std::function<bool(std::span<const std::byte>)>;
+
+// Called once per input as it finishes, never concurrently.
+using Completion = std::function<void(std::size_t index, Result&& result)>;
+
+class Session {
+public:
+  // Throws std::invalid_argument for a bad max_memory.
+  explicit Session(const SessionOptions& opts = {});
+  ~Session();
+  Session(Session&&) noexcept;
+  Session& operator=(Session&&) noexcept;
+
+  Result inspect(const std::string& path) const;
+  // `name` labels the result; the type is sniffed from the bytes.
+  Result inspect(std::span<const std::byte> bytes, const std::string& name = {}) const;
+
+  // Writes the cleaned copy atomically to `out_path` (which may equal `in_path`) and
+  // returns the inspection of the output.
+  Result strip(const std::string& in_path, const std::string& out_path) const;
+  // Strips in memory and hands the cleaned file to `sink`; no temp files are created.
+  Result strip(std::span<const std::byte> bytes, const Sink& sink, const std::string& name = {}) const;
+
+  // Batch calls run on `jobs` threads under the memory budget.
+  void inspect_batch(const std::vector<std::string>& paths, const Completion& done) const;
+  // `out_paths` pairs with `paths`.
+  void strip_batch(const std::vector<std::string>& paths, const std::vector<std::string>& out_paths,
+                   const Completion& done) const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+} // namespace metasweep
@@ -0,0 +1,167 @@
+#include "metadata_tool/session.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include "core/detect.hpp"
+#include "core/policy.hpp"
+#include "core/report.hpp"
+#include "core/sanitize.hpp"
+#include "util/commit.hpp"
+#include "util/sched.hpp"
+
+namespace metasweep {
+namespace {
+
+FileType to_public(core::FileType t) {
+  switch (t) {
+    case core::FileType::Image: return FileType::Image;
+    case core::FileType::PDF:   return FileType::PDF;
+    case core::FileType::Audio: return FileType::Audio;
+    case core::FileType::ZIP:   return FileType::ZIP;
+    default:                    return FileType::Unknown;
+  }
+}
+
+Result to_public(core::InspectResult&& ir) {
+  Result r;
+  r.verdict = core::verdict(ir);
+  r.file = std::move(ir.file);
+  r.type = to_public(ir.type);
+  r.blocks = std::move(ir.detected_blocks);
+  r.meta_bytes = ir.meta_bytes;
+  r.fields.reserve(ir.fields.size());
+  for (auto& f : ir.fields) {
+    r.fields.push_back({std::move(f.canonical), std::move(f.value), std::move(f.risk), std::move(f.block), f.bytes});
+  }
+  return r;
+}
+
+Result failed(const std::string& file, std::string error) {
+  Result r;
+  r.file = file;
+  r.verdict = "NONE";
+  r.ok = false;
+  r.error = std::move(error);
+  return r;
+}
+
+// strip_to hands back the input's result when it wrote nothing, and a batch-mode commit
+// can still fail its rename afterwards (util::output_lost).
+Result stripped(core::InspectResult&& ir, const std::string& out_path) {
+  const bool written = ir.file == out_path;
+  auto r = to_public(std::move(ir));
+  if (!written) { r.ok = false; r.error = "no output written"; }
+  else if (util::output_lost(out_path)) { r.ok = false; r.error = "output was not renamed into place"; }
+  return r;
+}
+
+std::string_view as_chars(std::span<const std::byte> b) {
+  return {reinterpret_cast<const char*>(b.data()), b.size()};
+}
+
+bool readable(const std::string& path) {
+  std::error_code ec;
+  return std::filesystem::is_regular_file(path, ec);
+}
+
+} // namespace
+
+struct Session::Impl {
+  core::Policy policy;
+  unsigned jobs = 1;
+  std::uint64_t max_memory = 0;
+
+  // Cleaned output of an in-memory strip; reused per thread so steady-state calls
+  // do not reallocate.
+  static std::string& scratch() {
+    thread_local std::string buf;
+    return buf;
+  }
+
+  template <class Fn>
+  void run_batch(const std::vector<std::string>& paths, bool strip, const Completion& done, Fn&& one) const {
+    util::MemBudget budget(max_memory);
+    if (!budget.unlimited()) util::bound_heap_retention();
+    auto cost = [&](std::size_t i) -> std::uint64_t {
+      if (budget.unlimited()) return 0;
+      std::error_code ec;
+      const auto size = std::filesystem::file_size(paths[i], ec);
+      return core::estimate_footprint(paths[i], ec ? 0 : size, strip, false);
+    };
+    std::mutex done_mu;
+    const auto lanes = core::backend_lanes(paths);
+    util::run_budgeted(paths.size(), jobs, budget, cost, [&](std::size_t i) {
+      Result r = one(i);
+      std::lock_guard<std::mutex> lk(done_mu);
+      done(i, std::move(r));
+    }, &lanes);
+  }
+};
+
+Session::Session(const SessionOptions& o) : impl_(std::make_unique<Impl>()) {
+  impl_->policy = core::load_policy(o.policy.safe, o.policy.custom, o.policy.keep, o.policy.drop);
+  impl_->jobs = o.jobs ? o.jobs : std::max(1u, std::thread::hardware_concurrency());
+  if (!o.max_memory.empty() && !util::parse_memory(o.max_memory, impl_->max_memory)) {
+    throw std::invalid_argument("metasweep: bad max_memory '" + o.max_memory + "'");
+  }
+}
+
+Session::~Session() = default;
+Session::Session(Session&&) noexcept = default;
+Session& Session::operator=(Session&&) noexcept = default;
+
+Result Session::inspect(const std::string& path) const {
+  if (!readable(path)) return failed(path, "not a readable file");
+  return to_public(core::inspect(core::detect_file(path)));
+}
+
+Result Session::inspect(std::span<const std::byte> bytes, const std::string& name) const {
+  if (bytes.empty()) return failed(name, "empty input");
+  return to_public(core::inspect(core::detect_buffer(name, as_chars(bytes))));
+}
+
+Result Session::strip(const std::string& in_path, const std::string& out_path) const {
+  if (!readable(in_path)) return failed(in_path, "not a readable file");
+  auto d = core::detect_file(in_path);
+  if (d.type == core::FileType::Unknown) return failed(in_path, "unsupported file type");
+  auto ir = core::strip_to(d, out_path, impl_->policy);
+  util::flush_outputs();
+  return stripped(std::move(ir), out_path);
+}
+
+Result Session::strip(std::span<const std::byte> bytes, const Sink& sink, const std::string& name) const {
+  if (bytes.empty()) return failed(name, "empty input");
+  auto d = core::detect_buffer(name, as_chars(bytes));
+  if (d.type == core::FileType::Unknown) return failed(name, "unsupported file type");
+  auto& out = Impl::scratch();
+  auto r = to_public(core::strip_buffer(d, impl_->policy, out));
+  if (out.empty()) return failed(name, "could not parse input");
+  const bool accepted = sink(std::as_bytes(std::span<const char>(out.data(), out.size())));
+  if (out.capacity() > (std::size_t{64} << 20)) std::string().swap(out); // do not pin huge buffers
+  if (!accepted) { r.ok = false; r.error = "sink refused the output"; }
+  return r;
+}
+
+void Session::inspect_batch(const std::vector<std::string>& paths, const Completion& done) const {
+  impl_->run_batch(paths, false, done, [&](std::size_t i) { return inspect(paths[i]); });
+}
+
+void Session::strip_batch(const std::vector<std::string>& paths, const std::vector<std::string>& out_paths,
+                          const Completion& done) const {
+  if (out_paths.size() != paths.size()) {
+    throw std::invalid_argument("metasweep: strip_batch needs one output path per input");
+  }
+  impl_->run_batch(paths, true, done, [&](std::size_t i) {
+    if (!readable(paths[i])) return failed(paths[i], "not a readable file");
+    auto d = core::detect_file(paths[i]);
+    if (d.type == core::FileType::Unknown) return failed(paths[i], "unsupported file type");
+    return stripped(core::strip_to(d, out_paths[i], impl_->policy), out_paths[i]);
+  });
+  util::flush_outputs();
+}
+
+} // namespace metasweep
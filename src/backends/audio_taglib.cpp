@@ -4,10 +4,24 @@
 #include <taglib/mpegfile.h>
 #include <taglib/flacfile.h>
 #include <taglib/vorbisfile.h>
+#include <taglib/opusfile.h>
+#include <taglib/mp4file.h>
+#include <taglib/taglib.h>
+#include <taglib/tbytevectorstream.h>
+#include <taglib/tfilestream.h>
+#if TAGLIB_MAJOR_VERSION < 2
+#include <taglib/id3v2framefactory.h>
+#endif
 
 #include <fstream>
+#include <iterator>
 #include <string>
+#include <type_traits>
+#include <string_view>
+#include "util/commit.hpp"
+#include "util/stats.hpp"
 
+using core::AudioKind;
 using core::Detected;
 using core::InspectResult;
 using core::FileType;
@@ -20,15 +34,14 @@ static inline std::string s8(const TagLib::String& s) {
   return s.to8Bit(true);
 }
 
-// Add a canonical field to InspectResult and return counted bytes
+// Add a field by ID3 frame ID and return counted bytes
 static std::size_t add_field(InspectResult& ir,
-                             const std::string& canon,
-                             const std::string& value,
-                             const std::string& block,
-                             const std::string& risk = "LOW") {
+                             std::string_view frame,
+                             std::string value,
+                             const std::string& block) {
   if (value.empty()) return 0;
   std::size_t bytes = value.size();
-  ir.fields.push_back({canon, value, risk, block, bytes});
+  ir.fields.push_back(core::make_field("ID3.", frame, std::move(value), block, bytes));
   return bytes;
 }
 
@@ -36,83 +49,281 @@ static std::size_t add_field(InspectResult& ir,
 static void read_basic(TagLib::Tag* t, const char* block, InspectResult& ir) {
   if (!t) return;
   std::size_t meta = 0;
-  meta += add_field(ir, "ID3.TIT2", s8(t->title()),  block);   // Title
-  meta += add_field(ir, "ID3.TPE1", s8(t->artist()), block);   // Artist
-  meta += add_field(ir, "ID3.TALB", s8(t->album()),  block);   // Album
-  if (t->year() > 0) meta += add_field(ir, "ID3.TDRC", std::to_string((int)t->year()), block); // Year
+  meta += add_field(ir, "TIT2", s8(t->title()),  block);   // Title
+  meta += add_field(ir, "TPE1", s8(t->artist()), block);   // Artist
+  meta += add_field(ir, "TALB", s8(t->album()),  block);   // Album
+  if (t->year() > 0) meta += add_field(ir, "TDRC", std::to_string((int)t->year()), block); // Year
 
   ir.meta_bytes += meta;
 }
 
-} // namespace
+// Opens `s` as exactly the container detection named (one TagLib object, one parse) and
+// hands the valid file to fn(file, block). An unknown kind goes through FileRef's own
+// detection instead. False when the stream does not parse as that container.
+template <class Fn>
+static bool with_file(TagLib::IOStream* s, AudioKind kind, Fn&& fn) {
+  s->seek(0);
+  switch (kind) {
+    case AudioKind::MPEG: {
+#if TAGLIB_MAJOR_VERSION >= 2
+      TagLib::MPEG::File f(s, false);
+#else
+      TagLib::MPEG::File f(s, TagLib::ID3v2::FrameFactory::instance(), false);
+#endif
+      if (!f.isValid()) return false;
+      fn(f, "ID3");
+      return true;
+    }
+    case AudioKind::FLAC: {
+#if TAGLIB_MAJOR_VERSION >= 2
+      TagLib::FLAC::File f(s, false);
+#else
+      TagLib::FLAC::File f(s, TagLib::ID3v2::FrameFactory::instance(), false);
+#endif
+      if (!f.isValid()) return false;
+      fn(f, "Vorbis");
+      return true;
+    }
+    case AudioKind::Vorbis: {
+      TagLib::Ogg::Vorbis::File f(s, false);
+      if (!f.isValid()) return false;
+      fn(f, "Vorbis");
+      return true;
+    }
+    case AudioKind::Opus: {
+      TagLib::Ogg::Opus::File f(s, false);
+      if (!f.isValid()) return false;
+      fn(f, "Vorbis");
+      return true;
+    }
+    case AudioKind::MP4: {
+      TagLib::MP4::File f(s, false);
+      if (!f.isValid()) return false;
+      fn(f, "MP4");
+      return true;
+    }
+    case AudioKind::Unknown:
+      break;
+  }
+  // whatever TagLib can parse
+  TagLib::FileRef f(s, false);
+  if (f.isNull() || !f.file()->isValid()) return false;
+  fn(*f.file(), "Tag");
+  return true;
+}
 
-namespace backends {
+static void inspect_stream(TagLib::IOStream* s, AudioKind kind, InspectResult& ir) {
+  with_file(s, kind, [&](auto& f, const char* block) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(f)>, TagLib::MPEG::File>) {
+      // TagLib hands back an empty tag for a tag-free stream: no block, nothing to strip
+      if (!f.hasID3v2Tag() && !f.hasID3v1Tag() && !f.hasAPETag()) return;
+    }
+    ir.detected_blocks.push_back(block);
+    read_basic(f.tag(), block, ir);
+  });
+}
 
-bool audio_can_handle(const Detected& d) {
-  return d.type == FileType::Audio;
+static void clear_basic(TagLib::Tag* t) {
+  if (!t) return;
+  t->setTitle({}); t->setArtist({}); t->setAlbum({}); t->setComment({}); t->setYear(0); t->setTrack(0);
 }
 
-InspectResult audio_inspect(const Detected& d) {
-  InspectResult ir; ir.file = d.path; ir.type = FileType::Audio;
+// Remove or blank the tags of whatever container `s` holds, saving through the stream
+static bool strip_stream(TagLib::IOStream* s, AudioKind kind) {
+  return with_file(s, kind, [](auto& f, const char*) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(f)>, TagLib::MPEG::File>) {
+      // Remove ID3v1, ID3v2 and APE; second arg 'true' updates file immediately
+      f.strip(TagLib::MPEG::File::AllTags, true);
+    } else {
+      clear_basic(f.tag());
+    }
+    f.save();
+  });
+}
+
+constexpr std::uint64_t kMaxHead = 64u << 20; // tag region parsed in memory
+// TagLib::ByteVector sizes are `unsigned int`; larger inputs cannot be handed over whole
+constexpr std::uint64_t kMaxInMemory = 0xFFFFFFFFu;
+static_assert(kMaxHead <= kMaxInMemory);
+
+// Byte source for the layout probe: the preloaded view, or reads from the file.
+class Source {
+public:
+  bool open(const Detected& d) {
+    if (!d.bytes.empty()) { bytes_ = d.bytes; size_ = d.bytes.size(); return true; }
+    f_.open(d.path, std::ios::binary | std::ios::ate);
+    if (!f_) return false;
+    size_ = static_cast<std::uint64_t>(f_.tellg());
+    return true;
+  }
+  std::uint64_t size() const { return size_; }
+  bool read(std::uint64_t off, std::size_t n, std::string& out) {
+    if (off > size_ || n > size_ - off) return false;
+    if (!bytes_.empty()) { out.assign(bytes_.substr(off, n)); return true; }
+    out.resize(n);
+    f_.seekg(static_cast<std::streamoff>(off));
+    f_.read(out.data(), static_cast<std::streamsize>(n));
+    util::stats::bytes_read(static_cast<std::uint64_t>(f_.gcount()));
+    return static_cast<std::size_t>(f_.gcount()) == n;
+  }
 
-  // Prefer specific containers first for nicer detected block labels
-  if (TagLib::MPEG::File mp3(d.path.c_str()); mp3.isValid()) {
-    ir.detected_blocks.push_back("ID3");
-    read_basic(mp3.tag(), "ID3", ir);
-    return ir;
+private:
+  std::string_view bytes_;
+  std::ifstream f_;
+  std::uint64_t size_ = 0;
+};
+
+static std::uint32_t le32(const std::string& b, std::size_t off) {
+  auto u = [&](std::size_t i) { return std::uint32_t(static_cast<unsigned char>(b[off + i])); };
+  return u(0) | u(1) << 8 | u(2) << 16 | u(3) << 24;
+}
+
+// MPEG and FLAC keep every tag this backend edits in front of the audio (ID3v2, the FLAC
+// metadata blocks) or behind it (ID3v1, and for MPEG an APE tag). Sets `head` to where the
+// audio starts and `tail` to the size of the tags after it; false for containers laid out
+// otherwise. The loops only stop at edges that carry no tag, so what lies between holds
+// none of them: MPEG output written from that range is tag-free without parsing it again.
+static bool tag_layout(Source& src, AudioKind kind, std::uint64_t& head, std::uint64_t& tail) {
+  head = tail = 0;
+  if (kind != AudioKind::MPEG && kind != AudioKind::FLAC) return false;
+  std::string b;
+  // MPEG::File::strip takes every ID3v2 tag in a row
+  while (src.read(head, 10, b) && b.compare(0, 3, "ID3") == 0) {
+    auto u = [&](int i) { return std::uint64_t(static_cast<unsigned char>(b[i]) & 0x7F); };
+    head += 10 + (u(6) << 21 | u(7) << 14 | u(8) << 7 | u(9)) + ((b[5] & 0x10) ? 10 : 0);
+    if (head > src.size() || head > kMaxHead) return false;
+    if (kind == AudioKind::FLAC) break;
   }
-  if (TagLib::FLAC::File flac(d.path.c_str()); flac.isValid()) {
-    ir.detected_blocks.push_back("Vorbis");
-    read_basic(flac.tag(), "Vorbis", ir);
-    return ir;
+  if (kind == AudioKind::FLAC) {
+    if (!src.read(head, 4, b) || b != "fLaC") return false;
+    head += 4;
+    for (bool last = false; !last;) {
+      if (!src.read(head, 4, b)) return false;
+      last = (b[0] & 0x80) != 0;
+      head += 4 + (std::uint64_t(static_cast<unsigned char>(b[1])) << 16 |
+                   std::uint64_t(static_cast<unsigned char>(b[2])) << 8 | static_cast<unsigned char>(b[3]));
+      if (head > src.size() || head > kMaxHead) return false;
+    }
   }
-  if (TagLib::Ogg::Vorbis::File ogg(d.path.c_str()); ogg.isValid()) {
-    ir.detected_blocks.push_back("Vorbis");
-    read_basic(ogg.tag(), "Vorbis", ir);
-    return ir;
+  if (head > src.size()) return false;
+  for (;;) {
+    const auto left = src.size() - head - tail;
+    const auto end = src.size() - tail;
+    if (left >= 128 && src.read(end - 128, 3, b) && b == "TAG") {
+      tail += 128;
+      if (kind == AudioKind::FLAC) break;
+      continue;
+    }
+    if (kind == AudioKind::MPEG && left >= 32 && src.read(end - 32, 32, b) && b.compare(0, 8, "APETAGEX") == 0) {
+      // footer: size of the items and footer, then flags (bit 31: a header precedes them)
+      const std::uint64_t n = le32(b, 12) + ((le32(b, 20) & 0x80000000u) ? 32 : 0);
+      if (n < 32 || n > left) return false; // let TagLib sort it out
+      tail += n;
+      continue;
+    }
+    return true;
   }
+}
+
+} // namespace
+
+namespace backends {
 
-  // Fallback: whatever TagLib can parse
-  if (TagLib::FileRef f(d.path.c_str()); !f.isNull()) {
-    ir.detected_blocks.push_back("Tag");
-    read_basic(f.tag(), "Tag", ir);
+InspectResult audio_inspect(const Detected& d) {
+  InspectResult ir; ir.file = d.path; ir.type = FileType::Audio;
+  util::stats::Timer timer(util::stats::Phase::Parse, d.path);
+
+  // Preloaded bytes (--io uring) are parsed in memory; otherwise stream from the file
+  if (!d.bytes.empty() && d.bytes.size() <= kMaxInMemory) {
+    TagLib::ByteVectorStream mem(TagLib::ByteVector(d.bytes.data(), static_cast<unsigned>(d.bytes.size())));
+    inspect_stream(&mem, d.audio, ir);
+  } else {
+    TagLib::FileStream file(d.path.c_str(), /*openReadOnly=*/true);
+    if (file.isOpen()) inspect_stream(&file, d.audio, ir);
   }
   return ir;
 }
 
-InspectResult audio_strip_to(const std::string& in_path,
-                             const std::string& out_path,
-                             const Policy& /*p*/) {
-  // Copy input -> output (simple; you can swap to atomic temp+rename later)
+// Holds about three copies of the file at its peak (see core::estimate_footprint): the
+// input and TagLib's copy, then that copy and the output, then the output and the copy
+// the re-inspection parses. Inputs TagLib cannot take in one buffer are refused.
+InspectResult audio_strip_buffer(const Detected& in, const Policy& p, std::string& out) {
+  out.clear();
+  std::string loaded;
+  std::string_view src = in.bytes;
+  if (src.empty()) {
+    std::ifstream f(in.path, std::ios::binary | std::ios::ate);
+    if (!f) return audio_inspect(in);
+    const auto size = f.tellg();
+    if (size < 0 || static_cast<std::uint64_t>(size) > kMaxInMemory) return audio_inspect(in);
+    f.seekg(0);
+    loaded.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    util::stats::bytes_read(loaded.size());
+    src = loaded;
+  }
+  if (src.size() > kMaxInMemory) return audio_inspect(in);
   {
-    std::ifstream src(in_path, std::ios::binary);
-    std::ofstream dst(out_path, std::ios::binary | std::ios::trunc);
-    dst << src.rdbuf();
+    TagLib::ByteVectorStream mem(TagLib::ByteVector(src.data(), static_cast<unsigned>(src.size())));
+    std::string().swap(loaded);
+    // tags (ID3, Vorbis comments, MP4 atoms) go whole, unless every ID3.* field is kept
+    if (core::block_action(p, "ID3.") != core::BlockAction::KeepAll) {
+      util::stats::Timer timer(util::stats::Phase::Write, in.path);
+      strip_stream(&mem, in.audio);
+    }
+    const auto* data = mem.data();
+    out.assign(data->data(), data->size());
   }
+  Detected cleaned = in;
+  cleaned.bytes = out;
+  return audio_inspect(cleaned);
+}
 
-  // Strip tags on the OUTPUT file in-place
-  if (TagLib::MPEG::File mp3(out_path.c_str()); mp3.isValid()) {
-    // Remove ID3v1 & ID3v2; second arg 'true' updates file immediately
-    mp3.strip(TagLib::MPEG::File::ID3v1 | TagLib::MPEG::File::ID3v2, true);
-    mp3.save();
-  } else if (TagLib::FLAC::File flac(out_path.c_str()); flac.isValid()) {
-    if (auto* t = flac.tag()) {
-      t->setTitle({}); t->setArtist({}); t->setAlbum({}); t->setComment({}); t->setYear(0); t->setTrack(0);
+InspectResult audio_strip_to(const Detected& in,
+                             const std::string& out_path,
+                             const Policy& p) {
+  // Tags in front of the audio: rewrite only that header in memory, then append the
+  // payload untouched in one in-kernel copy.
+  Source src;
+  std::uint64_t head = 0, tail = 0;
+  if (core::block_action(p, "ID3.") != core::BlockAction::KeepAll &&
+      src.open(in) && tag_layout(src, in.audio, head, tail)) {
+    InspectResult ir; ir.file = out_path; ir.type = FileType::Audio;
+    std::string header;
+    bool ok = true;
+    if (in.audio == AudioKind::FLAC) {
+      // MPEG drops its ID3 and APE tags outright; FLAC's metadata blocks are rewritten
+      ok = src.read(0, static_cast<std::size_t>(head), header);
+      if (ok) {
+        TagLib::ByteVectorStream mem(TagLib::ByteVector(header.data(), static_cast<unsigned>(header.size())));
+        {
+          util::stats::Timer timer(util::stats::Phase::Write, out_path);
+          ok = strip_stream(&mem, AudioKind::FLAC);
+        }
+        if (ok) {
+          inspect_stream(&mem, AudioKind::FLAC, ir);
+          header.assign(mem.data()->data(), mem.data()->size());
+        }
+      }
     }
-    flac.save();
-  } else if (TagLib::Ogg::Vorbis::File ogg(out_path.c_str()); ogg.isValid()) {
-    if (auto* t = ogg.tag()) {
-      t->setTitle({}); t->setArtist({}); t->setAlbum({}); t->setComment({}); t->setYear(0); t->setTrack(0);
+    if (ok) {
+      const auto len = src.size() - tail - head;
+      util::OutputFile out(out_path, in.path);
+      ok = out.write(header.data(), header.size()) &&
+           (in.bytes.empty() ? out.copy_range(in.path, head, len)
+                             : out.write(in.bytes.data() + head, static_cast<std::size_t>(len)));
+      if (ok && out.commit()) return ir;
+      return audio_inspect(in);
     }
-    ogg.save();
-  } else if (TagLib::FileRef f(out_path.c_str()); !f.isNull() && f.tag()) {
-    auto* t = f.tag();
-    t->setTitle({}); t->setArtist({}); t->setAlbum({}); t->setComment({}); t->setYear(0); t->setTrack(0);
-    f.file()->save();
   }
 
-  Detected d2{out_path, FileType::Audio, {}};
-  return audio_inspect(d2);
+  // Other containers are edited whole in memory and written once
+  std::string buf;
+  auto ir = audio_strip_buffer(in, p, buf);
+  if (buf.empty()) return audio_inspect(in);
+  util::OutputFile out(out_path, in.path);
+  if (!out.write(buf.data(), buf.size()) || !out.commit()) return audio_inspect(in);
+  ir.file = out_path;
+  return ir;
 }
 
 } // namespace backends
@@ -1,44 +1,73 @@
 #include "image_exiv2.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <mutex>
 #include <exiv2/exiv2.hpp>
-#include <filesystem>
-#include <cstdio>
-#ifndef _WIN32
-#include <unistd.h>
-#endif
+#include "util/commit.hpp"
+#include "util/stats.hpp"
 
 using namespace core;
 
 namespace {
-std::string canon_from_exif(const std::string& key) {
-  if (key.rfind("Exif.GPSInfo.GPSLatitude",0)==0)  return "EXIF.GPSLatitude";
-  if (key.rfind("Exif.GPSInfo.GPSLongitude",0)==0) return "EXIF.GPSLongitude";
-  if (key=="Exif.Image.Orientation")               return "EXIF.Orientation";
-  if (key=="Exif.Image.Make")                      return "EXIF.Make";
-  if (key=="Exif.Image.Model")                     return "EXIF.Model";
-  if (key=="Exif.Photo.BodySerialNumber" || key=="Exif.Image.BodySerialNumber") return "EXIF.SerialNumber";
-  return "EXIF." + key;
+// XMP array items ("Xmp.xmpMM.History[1]/stEvt:action") are classified by their property
+std::string_view xmp_native(std::string_view key) {
+  const auto prop = key.substr(0, key.find('['));
+  return field_by_native(prop) ? prop : key;
 }
-std::string canon_from_xmp(const std::string& key) {
-  if (key=="Xmp.xmp.CreatorTool") return "XMP.CreatorTool";
-  if (key.rfind("Xmp.xmpMM.History",0)==0) return "XMP.History";
-  return "XMP." + key;
+std::string canon_from(std::string_view prefix, std::string_view native) {
+  if (auto* f = field_by_native(native)) return std::string(f->canonical);
+  return std::string(prefix).append(native);
 }
-std::string canon_from_iptc(const std::string& key) {
-  return "IPTC." + key;
+std::string canon_from_exif(const std::string& key) { return canon_from("EXIF.", key); }
+std::string canon_from_xmp(const std::string& key)  { return canon_from("XMP.", xmp_native(key)); }
+std::string canon_from_iptc(const std::string& key) { return canon_from("IPTC.", key); }
+// Clears `data` when the policy drops its whole block, leaves it when it keeps it, and
+// only tests each entry otherwise.
+template <class Data, class Canon>
+void apply_block(Data& data, const core::Policy& p, std::string_view prefix, Canon canon) {
+  switch (block_action(p, prefix)) {
+    case BlockAction::KeepAll: return;
+    case BlockAction::DropAll: data.clear(); return;
+    case BlockAction::Mixed: break;
+  }
+  for (auto it = data.begin(); it != data.end(); ) {
+    if (!policy_keep(p, canon(it->key()))) it = data.erase(it); else ++it;
+  }
+}
+// Drop every field the policy does not keep; the caller writes the image back
+void apply_policy(Exiv2::Image& image, const core::Policy& p, const std::string& path) {
+  util::stats::Timer t(util::stats::Phase::Policy, path);
+  apply_block(image.exifData(), p, "EXIF.", canon_from_exif);
+  apply_block(image.xmpData(),  p, "XMP.",  canon_from_xmp);
+  apply_block(image.iptcData(), p, "IPTC.", canon_from_iptc);
 }
 } // anon
 
 namespace backends {
 
-bool image_can_handle(const Detected& d) {
-  return d.type == FileType::Image;
+void image_init() {
+  static std::recursive_mutex xmp_mu;
+  Exiv2::XmpParser::initialize([](void* mu, bool lock) {
+    auto* m = static_cast<std::recursive_mutex*>(mu);
+    if (lock) m->lock(); else m->unlock();
+  }, &xmp_mu);
 }
 
 core::InspectResult image_inspect(const Detected& d) {
   core::InspectResult ir; ir.file = d.path; ir.type = FileType::Image;
   try {
-    auto image = Exiv2::ImageFactory::open(d.path);
+    Exiv2::Image::UniquePtr image;
+    if (!d.bytes.empty()) {
+      // preloaded (--io uring): parse through Exiv2's MemIo
+      image = Exiv2::ImageFactory::open(reinterpret_cast<const Exiv2::byte*>(d.bytes.data()), d.bytes.size());
+    } else {
+      util::stats::Timer t(util::stats::Phase::Open, d.path);
+      image = Exiv2::ImageFactory::open(d.path);
+    }
+    util::stats::Timer timer(util::stats::Phase::Parse, d.path);
     image->readMetadata();
+    util::stats::bytes_read(image->io().size());
 
     const auto& exif = image->exifData();
     const auto& xmp  = image->xmpData();
@@ -49,34 +78,30 @@ core::InspectResult image_inspect(const Detected& d) {
     if (!xmp.empty())  ir.detected_blocks.push_back("XMP");
     if (!iptc.empty()) ir.detected_blocks.push_back("IPTC");
 
-    for (const auto& md : exif) {
-      std::string c = canon_from_exif(md.key());
-      std::string v = md.toString();
-      size_t sz = v.size() + md.key().size();
+    // toString() on MakerNotes, thumbnails and other blobs dominates the parse, so values
+    // are only formatted when the caller prints them; sizes come from the raw datum.
+    auto add = [&](const Exiv2::Metadatum& md, const char* prefix, const char* block, bool xmp_key) {
+      const std::string key = md.key();
+      const size_t raw = md.size();
+      std::string v;
+      if (d.max_value) {
+        v = md.toString();
+        clip_value(v, d.max_value);
+      }
+      const size_t sz = raw + key.size();
       meta_bytes += sz;
-      ir.fields.push_back({c, v, risk_for(c), "EXIF", sz});
-    }
-    for (const auto& md : xmp) {
-      std::string c = canon_from_xmp(md.key());
-      std::string v = md.toString();
-      size_t sz = v.size() + md.key().size();
-      meta_bytes += sz;
-      ir.fields.push_back({c, v, risk_for(c), "XMP", sz});
-    }
-    for (const auto& md : iptc) {
-      std::string c = canon_from_iptc(md.key());
-      std::string v = md.toString();
-      size_t sz = v.size() + md.key().size();
-      meta_bytes += sz;
-      ir.fields.push_back({c, v, risk_for(c), "IPTC", sz});
-    }
+      ir.fields.push_back(make_field(prefix, xmp_key ? xmp_native(key) : key, std::move(v), block, sz));
+      ir.fields.back().value_bytes = raw;
+    };
+    for (const auto& md : exif) add(md, "EXIF.", "EXIF", false);
+    for (const auto& md : xmp)  add(md, "XMP.", "XMP", true);
+    for (const auto& md : iptc) add(md, "IPTC.", "IPTC", false);
     ir.meta_bytes = meta_bytes;
 
     for (auto& f : ir.fields) {
-      if (f.canonical.rfind("EXIF.GPS",0)==0) ir.risk_tags.push_back("gps");
-      else if (f.canonical=="EXIF.SerialNumber") ir.risk_tags.push_back("device_serial");
-      else if (f.canonical=="XMP.CreatorTool") ir.risk_tags.push_back("software");
-      else if (f.canonical=="EXIF.Model") ir.risk_tags.push_back("device_model");
+      if (f.tag == RiskTag::None) continue;
+      std::string t(tag_name(f.tag));
+      if (std::find(ir.risk_tags.begin(), ir.risk_tags.end(), t) == ir.risk_tags.end()) ir.risk_tags.push_back(std::move(t));
     }
   } catch (...) {
     // leave empty if read fails
@@ -84,59 +109,78 @@ core::InspectResult image_inspect(const Detected& d) {
   return ir;
 }
 
-core::InspectResult image_strip_to(const std::string& in_path,
+core::InspectResult image_strip_buffer(const core::Detected& in,
+                                       const core::Policy& p,
+                                       std::string& out) {
+  out.clear();
+  try {
+    std::string loaded;
+    std::string_view src = in.bytes;
+    if (src.empty()) {
+      // read the whole file: the rewrite happens in a MemIo and never touches the disk
+      util::stats::Timer t(util::stats::Phase::Open, in.path);
+      std::ifstream f(in.path, std::ios::binary);
+      if (!f) return image_inspect(in);
+      loaded.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+      util::stats::bytes_read(loaded.size());
+      src = loaded;
+    }
+    auto image = Exiv2::ImageFactory::open(reinterpret_cast<const Exiv2::byte*>(src.data()), src.size());
+    {
+      util::stats::Timer t(util::stats::Phase::Parse, in.path);
+      image->readMetadata();
+    }
+    apply_policy(*image, p, in.path);
+    {
+      util::stats::Timer t(util::stats::Phase::Write, in.path);
+      image->writeMetadata();
+    }
+    auto& io = image->io();
+    const auto* data = io.mmap();
+    out.assign(reinterpret_cast<const char*>(data), io.size());
+    io.munmap();
+  } catch (...) {
+    out.clear();
+    return image_inspect(in);
+  }
+  core::Detected cleaned = in;
+  cleaned.bytes = out;
+  return image_inspect(cleaned);
+}
+
+core::InspectResult image_strip_to(const core::Detected& in,
                                    const std::string& out_path,
                                    const core::Policy& p) {
-  namespace fs = std::filesystem;
-  fs::path tmp = fs::path(out_path).parent_path() / (fs::path(out_path).filename().string()+".tmp");
-
-  std::error_code ec;
-  fs::create_directories(tmp.parent_path(), ec);
-  fs::copy_file(in_path, tmp, fs::copy_options::overwrite_existing, ec);
+  const std::string& in_path = in.path;
+  util::OutputFile out(out_path, in_path, /*need_path=*/true);
+  if (!in.bytes.empty()) {
+    if (!out.write(in.bytes.data(), in.bytes.size())) return image_inspect(in);
+  } else {
+    util::stats::Timer t(util::stats::Phase::Open, in_path);
+    if (!out.copy_from(in_path)) return image_inspect(in);
+  }
 
   try {
-    auto image = Exiv2::ImageFactory::open(tmp.string());
-    image->readMetadata();
-
-    auto& exif = image->exifData();
-    auto& xmp  = image->xmpData();
-    auto& iptc = image->iptcData();
-
-    for (auto it = exif.begin(); it != exif.end(); ) {
-      std::string c = canon_from_exif(it->key());
-      bool keep = policy_keep(p, c);
-      if (!keep) it = exif.erase(it); else ++it;
-    }
-    for (auto it = xmp.begin(); it != xmp.end(); ) {
-      std::string c = canon_from_xmp(it->key());
-      bool keep = policy_keep(p, c);
-      if (!keep) it = xmp.erase(it); else ++it;
-    }
-    for (auto it = iptc.begin(); it != iptc.end(); ) {
-      std::string c = canon_from_iptc(it->key());
-      bool keep = policy_keep(p, c);
-      if (!keep) it = iptc.erase(it); else ++it;
+    auto image = Exiv2::ImageFactory::open(out.path());
+    {
+      util::stats::Timer t(util::stats::Phase::Parse, in_path);
+      image->readMetadata();
     }
 
-    image->setExifData(exif);
-    image->setXmpData(xmp);
-    image->setIptcData(iptc);
+    apply_policy(*image, p, in_path);
+    util::stats::Timer t(util::stats::Phase::Write, out_path);
     image->writeMetadata();
-
-#ifndef _WIN32
-    { FILE* f = std::fopen(tmp.string().c_str(), "rb");
-      if (f) { int fd = fileno(f); if (fd!=-1) ::fsync(fd); std::fclose(f); } }
-#endif
-    fs::rename(tmp, out_path, ec);
+    util::stats::bytes_written(image->io().size());
   } catch (...) {
-    std::error_code del_ec;
-    std::filesystem::remove(tmp, del_ec);
-    core::Detected d{in_path, core::FileType::Image, {}};
-    return image_inspect(d);
+    return image_inspect(in);
   }
 
-  core::Detected d2{out_path, core::FileType::Image, {}};
-  return image_inspect(d2);
+  core::Detected staged{out.path(), core::FileType::Image, {}};
+  staged.max_value = in.max_value;
+  auto ir = image_inspect(staged);
+  if (!out.commit()) return image_inspect(in);
+  ir.file = out_path;
+  return ir;
 }
 
 } // namespace backends
@@ -4,9 +4,12 @@
 #include "core/policy.hpp"
 
 namespace backends {
-bool image_can_handle(const core::Detected& d);
+// Gives Exiv2's XMP toolkit a lock so images can be parsed on several threads
+void image_init();
 core::InspectResult image_inspect(const core::Detected& d);
-core::InspectResult image_strip_to(const std::string& in_path,
+// In-memory strip: `out` receives the cleaned file (empty if the input is unreadable)
+core::InspectResult image_strip_buffer(const core::Detected& in, const core::Policy& p, std::string& out);
+core::InspectResult image_strip_to(const core::Detected& in,
                                    const std::string& out_path,
                                    const core::Policy& p);
 }
@@ -1,21 +1,28 @@
 #include "pdf_info.hpp"
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <string_view>
 #include <vector>
 #include <filesystem>
+#include "pdf_objects.hpp"
+#include "core/text.hpp"
+#include "util/commit.hpp"
+#include "util/stats.hpp"
 
 using namespace std::literals;
 using core::Detected;
 using core::InspectResult;
 using core::FileType;
 using core::Policy;
-using core::risk_for;
+using core::make_field;
+namespace pdf = backends::pdf;
 
 namespace {
 
 // --- IO ---
 static bool read_all(const std::string& path, std::string& out) {
+  util::stats::Timer t(util::stats::Phase::Open, path);
   std::ifstream f(path, std::ios::binary);
   if (!f) return false;
   f.seekg(0, std::ios::end);
@@ -24,260 +31,237 @@ static bool read_all(const std::string& path, std::string& out) {
   out.resize(static_cast<size_t>(len));
   f.seekg(0, std::ios::beg);
   f.read(out.data(), len);
+  util::stats::bytes_read(static_cast<std::uint64_t>(f.gcount()));
   return f.good() || f.eof();
 }
 
-static inline bool is_space(char c){
-  unsigned char u = static_cast<unsigned char>(c);
-  return u==' ' || u=='\t' || u=='\r' || u=='\n' || u=='\f' || u=='\v';
-}
+static constexpr std::string_view kInfoKeys[] = {
+  "/Title","/Author","/Creator","/Producer","/CreationDate","/ModDate"
+};
 
-static std::string trim_parens(std::string_view v) {
-  if (v.size()>=2 && v.front()=='(' && v.back()==')') {
-    return std::string(v.substr(1, v.size()-2));
-  }
-  return std::string(v);
+static bool is_info_key(std::string_view key) {
+  return std::find(std::begin(kInfoKeys), std::end(kInfoKeys), key) != std::end(kInfoKeys);
 }
 
-// Extract value “( … )” starting at pos (which points to '('). Very simple,
-// handles nested escaped parens minimally.
-static std::pair<size_t,size_t> paren_span(const std::string& s, size_t pos){
-  if (pos>=s.size() || s[pos]!='(') return {std::string::npos,std::string::npos};
-  int depth = 0; size_t i = pos;
-  for (; i<s.size(); ++i) {
-    char c = s[i];
-    if (c=='\\') { ++i; continue; } // skip escaped char
-    if (c=='(') ++depth;
-    else if (c==')') { --depth; if (depth==0) { return {pos, i}; }
-    }
-  }
-  return {std::string::npos,std::string::npos};
+// --- Parse the common keys from a dict ("<<" at the start of `dict`), in one walk ---
+static void parse_info_dict(std::string_view dict,
+                            std::vector<core::Field>& out_fields,
+                            size_t& meta_bytes) {
+  pdf::for_each_entry(dict, 0, [&](pdf::Span k, pdf::Span v) {
+    const auto key = k.in(dict);
+    std::string text;
+    if (!is_info_key(key) || !core::pdf_string(v.in(dict), text)) return true;
+    meta_bytes += key.size() + v.size();
+    out_fields.push_back(make_field("PDF.", key, std::move(text), "PDF.Info", key.size() + v.size()));
+    return true;
+  });
 }
 
-// --- Primary strategy: trailer → /Info N 0 R → object span ---
-struct InfoLoc {
-  bool present=false;
-  int obj_num=-1;
-  size_t obj_start=std::string::npos;
-  size_t obj_end=std::string::npos;
-};
-
-static size_t rfind_simple(const std::string& s, std::string_view needle) {
-  return s.rfind(needle.data());
+// Blank the common keys' string values in the dict at `dict` to "()" / "<>" plus spaces,
+// so no byte offset in the file moves.
+static void blank_info_dict(std::string& buf, size_t dict) {
+  pdf::for_each_entry(buf, dict, [&](pdf::Span k, pdf::Span v) {
+    if (!is_info_key(k.in(buf)) || v.size() < 2 || (buf[v.b] != '(' && buf[v.b] != '<')) return true;
+    buf[v.b + 1] = buf[v.b] == '(' ? ')' : '>';
+    std::fill(buf.begin() + v.b + 2, buf.begin() + v.e, ' ');
+    return true;
+  });
 }
 
-static InfoLoc locate_info_via_trailer(const std::string& pdf) {
-  InfoLoc loc{};
-  if (pdf.rfind("%PDF-", 0) != 0) return loc;
-
-  // find the LAST "trailer"
-  size_t trailer_pos = rfind_simple(pdf, "trailer");
-  if (trailer_pos == std::string::npos) return loc;
-  size_t dict_start = pdf.find("<<", trailer_pos);
-  if (dict_start == std::string::npos) return loc;
-  size_t dict_end = pdf.find(">>", dict_start);
-  if (dict_end == std::string::npos) return loc;
-
-  // /Info N 0 R
-  size_t info_pos = pdf.find("/Info", dict_start);
-  if (info_pos == std::string::npos || info_pos > dict_end) return loc;
-
-  size_t num_start = pdf.find_first_of("0123456789", info_pos+5);
-  if (num_start == std::string::npos) return loc;
-  size_t num_end = pdf.find_first_not_of("0123456789", num_start);
-  if (num_end == std::string::npos) return loc;
-  int objnum = std::stoi(pdf.substr(num_start, num_end-num_start));
-
-  // find "obj" for that number
-  std::string needle = std::to_string(objnum) + " 0 obj";
-  size_t ostart = pdf.find(needle);
-  if (ostart == std::string::npos) return loc;
-  size_t dict_s = pdf.find("<<", ostart);
-  if (dict_s == std::string::npos) return loc;
-  size_t oend = pdf.find("endobj", dict_s);
-  if (oend == std::string::npos) return loc;
-
-  loc.present = true;
-  loc.obj_num = objnum;
-  loc.obj_start = dict_s;
-  loc.obj_end = oend;
-  return loc;
+// --- XMP (/Metadata stream of the catalog) ---
+static constexpr size_t kXmpMax = 4u << 20; // decoded packet cap
+
+// The catalog's /Metadata stream, when it is a plain object.
+static bool metadata_stream(std::string_view buf, const pdf::Xref& xref, pdf::Stream& st) {
+  pdf::Ref root, meta;
+  auto rv = xref.trailer_get("/Root");
+  if (!rv.ok() || !pdf::parse_ref(rv.in(xref.trailer()), root)) return false;
+  std::string scratch;
+  std::string_view cat;
+  pdf::Entry where;
+  if (!pdf::load_object(buf, xref, root.num, scratch, cat, where)) return false;
+  auto mv = pdf::dict_get(cat, 0, "/Metadata");
+  if (!mv.ok() || !pdf::parse_ref(mv.in(cat), meta)) return false;
+  const auto* e = xref.find(meta.num);
+  return e && e->type == 1 && pdf::stream_at(buf, xref, e->off, st);
 }
 
-// --- Fallback: scan for any object with Info-like keys in a dict ---
-// returns dict spans [dict_s, dict_e] inside "N 0 obj ... endobj"
-struct DictSpan { size_t dict_s, dict_e; };
-static bool looks_info_dict(std::string_view dict) {
-  return (dict.find("/Title")!=std::string_view::npos)
-      || (dict.find("/Author")!=std::string_view::npos)
-      || (dict.find("/Creator")!=std::string_view::npos)
-      || (dict.find("/Producer")!=std::string_view::npos)
-      || (dict.find("/CreationDate")!=std::string_view::npos)
-      || (dict.find("/ModDate")!=std::string_view::npos);
+static void read_xmp(std::string_view buf, const pdf::Xref& xref, InspectResult& ir, size_t& meta_bytes) {
+  pdf::Stream st;
+  if (!metadata_stream(buf, xref, st)) return;
+  ir.detected_blocks.push_back("XMP");
+  std::string x;
+  auto keep = [&](std::string_view w) {
+    x.append(w.substr(0, std::min(w.size(), kXmpMax - x.size())));
+    return x.size() < kXmpMax;
+  };
+  const auto raw = buf.substr(st.data, st.len);
+  switch (pdf::stream_filter(buf, st)) {
+    case pdf::Filter::None:  keep(raw); break;
+    case pdf::Filter::Flate: pdf::inflate(raw, keep); break;
+    default: return;
+  }
+  for (auto qname : core::kXmpProps) {
+    auto v = core::xmp_value(x, qname);
+    if (v.empty()) continue;
+    const size_t bytes = qname.size() + v.size();
+    meta_bytes += bytes;
+    ir.fields.push_back(make_field("XMP.", qname, std::move(v), "XMP", bytes));
+  }
 }
 
-static DictSpan find_first_info_like_object(const std::string& pdf){
-  size_t pos = 0;
-  while (true) {
-    // find next "obj"
-    size_t obj = pdf.find(" obj", pos);
-    if (obj == std::string::npos) break;
-
-    // backtrack to beginning of the line to include object header
-    size_t line_start = pdf.rfind('\n', obj);
-    size_t hdr_start = (line_start==std::string::npos? 0 : line_start+1);
-    // quick sanity: header looks like "N 0 obj"
-    // not strictly required here
-
-    // find dict inside this object
-    size_t dict_s = pdf.find("<<", obj);
-    if (dict_s == std::string::npos) break;
-    size_t dict_e = pdf.find(">>", dict_s);
-    if (dict_e == std::string::npos) break;
+// Replace the packet in place with an empty one padded to the same length, and drop the
+// stream's filter entries: offsets stay valid and nothing of the old packet remains.
+static void clear_xmp(std::string& buf, const pdf::Xref& xref) {
+  pdf::Stream st;
+  if (!metadata_stream(buf, xref, st) || !st.len) return;
+  static constexpr std::string_view head =
+    "<?xpacket begin=\"\xEF\xBB\xBF\" id=\"W5M0MpCehiHzreSzNTczkc9d\"?>\n"
+    "<x:xmpmeta xmlns:x=\"adobe:ns:meta/\"/>\n";
+  static constexpr std::string_view tail = "<?xpacket end=\"w\"?>";
+  auto out = buf.begin() + st.data;
+  std::fill(out, out + st.len, ' ');
+  if (st.len >= head.size() + tail.size()) {
+    std::copy(head.begin(), head.end(), out);
+    std::copy(tail.begin(), tail.end(), out + (st.len - tail.size()));
+  }
+  for (auto key : {"/Filter", "/DecodeParms", "/DL"}) pdf::blank_entry(buf, st.dict, key);
+}
 
-    std::string_view dv(pdf.data()+dict_s, dict_e - dict_s + 2);
-    if (looks_info_dict(dv)) return {dict_s, dict_e};
+// Info located through the cross-reference chain: blanked in place when it is a plain
+// object, or by re-encoding its object stream into an appended update (the old stream's
+// bytes are zeroed). False when the chain does not lead to an Info dict.
+static bool clear_info_objects(std::string& buf, const pdf::Xref& xref) {
+  pdf::Ref info;
+  auto iv = xref.trailer_get("/Info");
+  if (!iv.ok() || !pdf::parse_ref(iv.in(xref.trailer()), info)) return false;
+  const auto* e = xref.find(info.num);
+  if (!e) return false;
+  util::stats::Timer t(util::stats::Phase::Policy);
+  if (e->type == 1) {
+    auto body = pdf::object_at(buf, e->off);
+    if (!body.ok() || buf.compare(body.b, 2, "<<") != 0) return false;
+    blank_info_dict(buf, body.b);
+    return true;
+  }
+  const auto stm = static_cast<std::uint32_t>(e->off);
+  std::string dict, data;
+  const bool ok = pdf::rewrite_objstm(buf, xref, stm, e->idx, [](std::string& obj) {
+    blank_info_dict(obj, pdf::skip_ws(obj, 0));
+  }, dict, data);
+  if (!ok) return false;
+  pdf::Stream old;
+  if (const auto* se = xref.find(stm); se && pdf::stream_at(buf, xref, se->off, old)) {
+    std::fill(buf.begin() + old.data, buf.begin() + old.data + old.len, '\0');
+  }
+  pdf::append_update(buf, xref, stm, dict, data);
+  return true;
+}
 
-    // move past endobj
-    size_t endobj = pdf.find("endobj", dict_e);
-    if (endobj == std::string::npos) break;
-    pos = endobj + 6;
+// Info dict of a file without a usable cross-reference chain, from one indexing pass:
+// the last trailer's /Info when that object is found, else the first dict carrying any of
+// the common keys. Returns the offset of its "<<".
+static size_t info_by_scan(std::string_view buf) {
+  pdf::ObjectIndex index;
+  index.build(buf, kInfoKeys);
+  pdf::Ref ref;
+  if (auto tr = index.trailer(); tr.ok() && tr.e != std::string::npos) {
+    auto iv = pdf::dict_get(buf, tr.b, "/Info");
+    const auto* o = iv.ok() && pdf::parse_ref(iv.in(buf), ref) ? index.find(ref.num) : nullptr;
+    if (o && o->dict.ok()) return o->dict.b;
   }
-  return {std::string::npos, std::string::npos};
+  for (auto& o : index.objects()) {
+    if (o.names && o.dict.ok()) return o.dict.b;
+  }
+  return std::string::npos;
 }
 
-// --- Parse key/value from a dict span ---
-static void parse_info_dict(std::string_view dict,
-                            std::vector<core::Field>& out_fields,
-                            size_t& meta_bytes) {
-  auto grab = [&](std::string_view key, const char* canon){
-    size_t pos = dict.find(key);
-    if (pos == std::string::npos) return;
-    pos += key.size();
-    while (pos < dict.size() && is_space(dict[pos])) ++pos;
-    if (pos >= dict.size() || dict[pos] != '(') return;
-    size_t global_pos = pos; // relative to dict start
-    int depth = 0; size_t i = pos;
-    for (; i<dict.size(); ++i) {
-      char c = dict[i];
-      if (c=='\\') { ++i; continue; }
-      if (c=='(') ++depth;
-      else if (c==')') { --depth; if (depth==0) break; }
-    }
-    if (i<dict.size()) {
-      std::string val(dict.substr(pos, i-pos+1)); // include parens
-      std::string clean = trim_parens(val);
-      meta_bytes += key.size() + val.size();
-      out_fields.push_back({canon, clean, risk_for(canon), "PDF.Info", key.size()+val.size()});
+// Loads the cross-reference chain; false for damaged or encrypted files, which fall
+// back to the plaintext heuristics.
+static bool load_xref(std::string_view buf, pdf::Xref& xref) {
+  return xref.load(buf) && !xref.trailer_get("/Encrypt").ok();
+}
+
+static InspectResult inspect_buffer(const std::string& path, std::string_view buf) {
+  util::stats::Timer timer(util::stats::Phase::Parse, path);
+  InspectResult ir; ir.file = path; ir.type = FileType::PDF;
+  size_t meta_bytes = 0;
+
+  pdf::Xref xref;
+  std::string scratch;
+  std::string_view info;
+  if (load_xref(buf, xref)) {
+    pdf::Ref ref;
+    pdf::Entry where;
+    auto iv = xref.trailer_get("/Info");
+    std::string_view body;
+    if (iv.ok() && pdf::parse_ref(iv.in(xref.trailer()), ref) &&
+        pdf::load_object(buf, xref, ref.num, scratch, body, where)) {
+      info = body.substr(std::min(body.size(), pdf::skip_ws(body, 0)));
     }
-  };
+    read_xmp(buf, xref, ir, meta_bytes);
+  } else if (auto dict_s = info_by_scan(buf); dict_s != std::string::npos) {
+    info = buf.substr(dict_s);
+  }
 
-  grab("/Title"sv,        "PDF.Title");
-  grab("/Author"sv,       "PDF.Author");
-  grab("/Creator"sv,      "PDF.Creator");
-  grab("/Producer"sv,     "PDF.Producer");
-  grab("/CreationDate"sv, "PDF.CreationDate");
-  grab("/ModDate"sv,      "PDF.ModDate");
+  if (info.substr(0, 2) == "<<") {
+    ir.detected_blocks.insert(ir.detected_blocks.begin(), "Info");
+    parse_info_dict(info, ir.fields, meta_bytes);
+  }
+  ir.meta_bytes = meta_bytes;
+  return ir;
 }
 
-// Replace the value for a key within [dict_s, dict_e] with empty "()"
-static void clear_key_inplace(std::string& buf, size_t dict_s, size_t dict_e, std::string_view key){
-  size_t pos = buf.find(key.data(), dict_s);
-  if (pos == std::string::npos || pos > dict_e) return;
-  pos += key.size();
-  while (pos < dict_e && is_space(buf[pos])) ++pos;
-  if (pos >= dict_e || buf[pos] != '(') return;
-  auto [start,end] = paren_span(buf, pos);
-  if (start==std::string::npos || end==std::string::npos || end>dict_e) return;
-  // replace "(...)" with "()"
-  buf.replace(start, (end-start+1), "()");
+// Blank the common Info keys (`info`) and empty the XMP packet (`xmp`). With a usable
+// cross-reference chain every edit keeps the file's offsets; otherwise the /Info
+// dictionary is found by scanning.
+static void clear_info(std::string& buf, const std::string& path, bool info, bool xmp) {
+  pdf::Xref xref;
+  if (load_xref(buf, xref)) {
+    if (xmp) clear_xmp(buf, xref);
+    if (!info || clear_info_objects(buf, xref)) return;
+  }
+  if (!info) return;
+  const auto dict_s = info_by_scan(buf);
+  if (dict_s == std::string::npos) return;
+  util::stats::Timer t(util::stats::Phase::Policy, path);
+  blank_info_dict(buf, dict_s);
 }
 
 } // anon
 
 namespace backends {
 
-bool pdf_can_handle(const Detected& d) { return d.type == FileType::PDF; }
-
 core::InspectResult pdf_inspect(const Detected& d) {
-  InspectResult ir; ir.file = d.path; ir.type = FileType::PDF;
+  if (!d.bytes.empty()) return inspect_buffer(d.path, d.bytes);
   std::string buf;
-  if (!read_all(d.path, buf)) return ir;
-
-  // Strategy A: via trailer
-  auto loc = locate_info_via_trailer(buf);
-  size_t dict_s = std::string::npos, dict_e = std::string::npos;
-
-  if (loc.present) {
-    dict_s = buf.find("<<", loc.obj_start);
-    dict_e = (dict_s==std::string::npos)? std::string::npos : buf.find(">>", dict_s);
-  }
-
-  // Strategy B: fallback scan
-  if (dict_s == std::string::npos || dict_e == std::string::npos || dict_e <= dict_s) {
-    auto ds = find_first_info_like_object(buf);
-    dict_s = ds.dict_s; dict_e = ds.dict_e;
-  }
-
-  if (dict_s == std::string::npos || dict_e == std::string::npos || dict_e <= dict_s)
-    return ir; // no info-like dict found
-
-  ir.detected_blocks.push_back("Info");
-  size_t meta_bytes = 0;
-  parse_info_dict(std::string_view(buf.data()+dict_s, dict_e - dict_s + 2),
-                  ir.fields, meta_bytes);
-  ir.meta_bytes = meta_bytes;
-  return ir;
+  if (!read_all(d.path, buf)) { InspectResult ir; ir.file = d.path; ir.type = FileType::PDF; return ir; }
+  return inspect_buffer(d.path, buf);
 }
 
-core::InspectResult pdf_strip_to(const std::string& in_path,
-                                 const Policy& /*p*/, // MVP: clear all common keys
-                                 size_t dict_s, size_t dict_e,
-                                 std::string& buf) {
-  // List of keys to clear
-  static constexpr std::string_view keys[] = {
-    "/Title","/Author","/Creator","/Producer","/CreationDate","/ModDate"
-  };
-  for (auto k : keys) clear_key_inplace(buf, dict_s, dict_e, k);
-  // Done. Caller will write out.
-  Detected d2{in_path, FileType::PDF, {}};
-  return pdf_inspect(d2);
+core::InspectResult pdf_strip_buffer(const Detected& in, const Policy& p, std::string& buf) {
+  // Each block is cleared whole (no per-key policy yet), unless the policy keeps all of it
+  const bool info = core::block_action(p, "PDF.") != core::BlockAction::KeepAll;
+  const bool xmp = core::block_action(p, "XMP.") != core::BlockAction::KeepAll;
+  buf.clear();
+  if (!in.bytes.empty()) buf.assign(in.bytes);
+  else if (!read_all(in.path, buf)) return pdf_inspect(in);
+  if (info || xmp) clear_info(buf, in.path, info, xmp);
+  return inspect_buffer(in.path, buf);
 }
 
-core::InspectResult pdf_strip_to(const std::string& in_path,
+core::InspectResult pdf_strip_to(const Detected& in,
                                  const std::string& out_path,
                                  const Policy& p) {
-  (void)p; // MVP: strip the common /Info keys unconditionally
+  const std::string& in_path = in.path;
   std::string buf;
-  if (!read_all(in_path, buf)) {
-    Detected d{in_path, FileType::PDF, {}}; return pdf_inspect(d);
-  }
-
-  // Find dict span via trailer or fallback
-  auto loc = locate_info_via_trailer(buf);
-  size_t dict_s = std::string::npos, dict_e = std::string::npos;
-  if (loc.present) {
-    dict_s = buf.find("<<", loc.obj_start);
-    dict_e = (dict_s==std::string::npos)? std::string::npos : buf.find(">>", dict_s);
-  }
-  if (dict_s == std::string::npos || dict_e == std::string::npos || dict_e <= dict_s) {
-    auto ds = find_first_info_like_object(buf);
-    dict_s = ds.dict_s; dict_e = ds.dict_e;
-  }
-
-  if (dict_s != std::string::npos && dict_e != std::string::npos && dict_e > dict_s) {
-    // Clear common keys in-place
-    static constexpr std::string_view keys[] = {
-      "/Title","/Author","/Creator","/Producer","/CreationDate","/ModDate"
-    };
-    for (auto k : keys) clear_key_inplace(buf, dict_s, dict_e, k);
-  }
+  auto ir = pdf_strip_buffer(in, p, buf); // already the output's result
+  if (buf.empty()) return ir;
   // Write output
-  std::filesystem::create_directories(std::filesystem::path(out_path).parent_path());
-  std::ofstream o(out_path, std::ios::binary|std::ios::trunc);
-  o.write(buf.data(), static_cast<std::streamsize>(buf.size()));
-
-  Detected d2{out_path, FileType::PDF, {}}; return pdf_inspect(d2);
+  util::OutputFile out(out_path, in_path);
+  if (!out.write(buf.data(), buf.size()) || !out.commit()) return pdf_inspect(in);
+  ir.file = out_path;
+  return ir;
 }
 
 } // namespace backends
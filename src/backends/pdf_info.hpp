@@ -4,9 +4,10 @@
 #include "core/policy.hpp"
 
 namespace backends {
-bool pdf_can_handle(const core::Detected& d);
 core::InspectResult pdf_inspect(const core::Detected& d);
-core::InspectResult pdf_strip_to(const std::string& in_path,
+// In-memory strip: `out` receives the cleaned file (empty if the input is unreadable)
+core::InspectResult pdf_strip_buffer(const core::Detected& in, const core::Policy& p, std::string& out);
+core::InspectResult pdf_strip_to(const core::Detected& in,
                                  const std::string& out_path,
                                  const core::Policy& p);
 }
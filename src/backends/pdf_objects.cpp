@@ -0,0 +1,811 @@
+#include "pdf_objects.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <set>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace backends::pdf {
+namespace {
+
+constexpr std::size_t kWindow = 64u << 10;        // inflate output window
+constexpr std::size_t kMaxObject = 16u << 20;     // one object inside an object stream
+constexpr std::size_t kMaxXrefStream = 64u << 20; // decoded cross-reference stream
+constexpr std::uint32_t kMaxObjects = 1u << 22;
+constexpr int kMaxDepth = 256;
+
+bool is_delim(char c) {
+  switch (c) {
+    case '(': case ')': case '<': case '>': case '[': case ']':
+    case '{': case '}': case '/': case '%': return true;
+    default: return false;
+  }
+}
+
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+bool starts(std::string_view s, std::size_t p, std::string_view w) {
+  return p != npos && p <= s.size() && s.substr(p, w.size()) == w;
+}
+
+// Unsigned integer token at `p` (after whitespace); npos when there is none.
+std::size_t read_uint(std::string_view s, std::size_t p, std::uint64_t& out) {
+  p = skip_ws(s, p);
+  if (p >= s.size() || !is_digit(s[p])) return npos;
+  out = 0;
+  while (p < s.size() && is_digit(s[p])) out = out * 10 + std::uint64_t(s[p++] - '0');
+  return p;
+}
+
+std::size_t skip_object(std::string_view s, std::size_t p, int depth) {
+  p = skip_ws(s, p);
+  if (p >= s.size() || depth > kMaxDepth) return npos;
+  const char c = s[p];
+  if (c == '(') {
+    int level = 0;
+    for (; p < s.size(); ++p) {
+      if (s[p] == '\\') { ++p; continue; }
+      if (s[p] == '(') ++level;
+      else if (s[p] == ')' && --level == 0) return p + 1;
+    }
+    return npos;
+  }
+  if (c == '<' && starts(s, p, "<<")) {
+    p += 2;
+    for (;;) {
+      p = skip_ws(s, p);
+      if (p >= s.size()) return npos;
+      if (starts(s, p, ">>")) return p + 2;
+      p = skip_object(s, p, depth + 1);
+      if (p == npos) return npos;
+    }
+  }
+  if (c == '<') {
+    auto e = s.find('>', p);
+    return e == npos ? npos : e + 1;
+  }
+  if (c == '[') {
+    ++p;
+    for (;;) {
+      p = skip_ws(s, p);
+      if (p >= s.size()) return npos;
+      if (s[p] == ']') return p + 1;
+      p = skip_object(s, p, depth + 1);
+      if (p == npos) return npos;
+    }
+  }
+  if (c == '/') {
+    ++p;
+    while (p < s.size() && !is_space(s[p]) && !is_delim(s[p])) ++p;
+    return p;
+  }
+  if (is_digit(c) || c == '+' || c == '-' || c == '.') {
+    std::size_t e = p + 1;
+    while (e < s.size() && (is_digit(s[e]) || s[e] == '.')) ++e;
+    // "N G R" is one reference
+    std::uint64_t g;
+    if (is_digit(c)) {
+      auto q = read_uint(s, e, g);
+      if (q != npos) {
+        q = skip_ws(s, q);
+        if (q < s.size() && s[q] == 'R' && (q + 1 == s.size() || is_space(s[q + 1]) || is_delim(s[q + 1]))) {
+          return q + 1;
+        }
+      }
+    }
+    return e;
+  }
+  std::size_t e = p;
+  while (e < s.size() && !is_space(s[e]) && !is_delim(s[e])) ++e;
+  return e == p ? npos : e;
+}
+
+// Key and value of `key` in the dictionary at `dict`: [key start, value end).
+Span entry_get(std::string_view s, std::size_t dict, std::string_view key, Span* value) {
+  Span entry;
+  for_each_entry(s, dict, [&](Span k, Span v) {
+    if (k.in(s) != key) return true;
+    if (value) *value = v;
+    entry = {k.b, v.e};
+    return false;
+  });
+  return entry;
+}
+
+// PNG predictors (10-15) over rows of `columns` bytes, as used by xref streams.
+bool unpredict(std::string& d, std::size_t columns) {
+  if (!columns) return false;
+  const std::size_t row = columns + 1;
+  std::string out;
+  out.reserve(d.size() / row * columns);
+  std::string prev(columns, '\0');
+  for (std::size_t r = 0; r + row <= d.size(); r += row) {
+    const auto type = static_cast<unsigned char>(d[r]);
+    std::string cur(d, r + 1, columns);
+    for (std::size_t i = 0; i < columns; ++i) {
+      const unsigned a = i ? static_cast<unsigned char>(cur[i - 1]) : 0;
+      const unsigned b = static_cast<unsigned char>(prev[i]);
+      const unsigned c = i ? static_cast<unsigned char>(prev[i - 1]) : 0;
+      unsigned x = static_cast<unsigned char>(cur[i]);
+      switch (type) {
+        case 0: break;
+        case 1: x += a; break;
+        case 2: x += b; break;
+        case 3: x += (a + b) / 2; break;
+        case 4: {
+          const int pa = std::abs(int(b) - int(c)), pb = std::abs(int(a) - int(c));
+          const int pc = std::abs(int(a) + int(b) - 2 * int(c));
+          x += (pa <= pb && pa <= pc) ? a : pb <= pc ? b : c;
+          break;
+        }
+        default: return false;
+      }
+      cur[i] = char(x & 0xFF);
+    }
+    out += cur;
+    prev.swap(cur);
+  }
+  d.swap(out);
+  return true;
+}
+
+// Streams the decoded content of `st` through fn(bytes, decoded offset).
+bool decode(std::string_view pdf, const Stream& st,
+            const std::function<bool(std::string_view, std::size_t)>& fn) {
+  const auto data = pdf.substr(st.data, st.len);
+  switch (stream_filter(pdf, st)) {
+    case Filter::None: {
+      for (std::size_t at = 0; at < data.size(); at += kWindow) {
+        if (!fn(data.substr(at, kWindow), at)) break;
+      }
+      return true;
+    }
+    case Filter::Flate: {
+      std::size_t at = 0;
+      return inflate(data, [&](std::string_view w) {
+        const bool more = fn(w, at);
+        at += w.size();
+        return more;
+      });
+    }
+    default:
+      return false;
+  }
+}
+
+// Header of object stream `st`: /N pairs "num offset" in the first /First bytes.
+struct ObjStm {
+  std::uint64_t n = 0, first = 0;
+  std::string header;
+  std::size_t b = npos, e = npos; // decoded range of the wanted object (e = npos: to the end)
+  bool located = false;
+
+  bool locate(std::uint32_t idx) {
+    std::uint64_t num, off, next = 0, target = 0;
+    std::size_t p = 0;
+    bool found = false;
+    for (std::uint64_t k = 0; k < n; ++k) {
+      if ((p = read_uint(header, p, num)) == npos || (p = read_uint(header, p, off)) == npos) return false;
+      if (found) { next = off; break; }
+      if (k == idx) { target = off; found = true; }
+    }
+    if (!found) return false;
+    b = first + target;
+    e = next > target ? first + next : npos;
+    located = true;
+    return true;
+  }
+};
+
+bool open_objstm(std::string_view pdf, const Xref& xref, std::uint32_t stm, Stream& st, ObjStm& os) {
+  const auto* ent = xref.find(stm);
+  if (!ent || ent->type != 1 || !stream_at(pdf, xref, ent->off, st)) return false;
+  auto n = dict_get(pdf, st.dict, "/N");
+  auto f = dict_get(pdf, st.dict, "/First");
+  if (!n.ok() || !f.ok() || !parse_uint(n.in(pdf), os.n) || !parse_uint(f.in(pdf), os.first)) return false;
+  return os.first < kMaxObject;
+}
+
+// Feeds the decoded object stream to `take(bytes, in_target)` in order, with the header
+// located first so the wanted object's bytes can be told apart.
+bool walk_objstm(std::string_view pdf, const Stream& st, ObjStm& os, std::uint32_t idx,
+                 const std::function<bool(std::string_view, bool)>& take) {
+  bool ok = true;
+  const bool decoded = decode(pdf, st, [&](std::string_view w, std::size_t at) {
+    if (!os.located) {
+      if (at < os.first) os.header.append(w.substr(0, std::min<std::size_t>(w.size(), os.first - at)));
+      if (os.header.size() >= os.first && !os.locate(idx)) { ok = false; return false; }
+    }
+    if (!os.located) return take(w, false);
+    const std::size_t end = at + w.size();
+    const std::size_t tb = std::clamp(os.b, at, end);
+    const std::size_t te = os.e == npos ? end : std::clamp(os.e, at, end);
+    if (tb > at && !take(w.substr(0, tb - at), false)) return false;
+    if (te > tb && !take(w.substr(tb - at, te - tb), true)) return false;
+    if (end > te && !take(w.substr(te - at), false)) return false;
+    return true;
+  });
+  return decoded && ok && os.located;
+}
+
+std::string pad10(std::uint64_t v) {
+  auto s = std::to_string(v);
+  return std::string(s.size() < 10 ? 10 - s.size() : 0, '0') + s;
+}
+
+} // namespace
+
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\0';
+}
+
+std::size_t skip_ws(std::string_view s, std::size_t p) {
+  while (p < s.size()) {
+    if (is_space(s[p])) { ++p; continue; }
+    if (s[p] != '%') break;
+    while (p < s.size() && s[p] != '\n' && s[p] != '\r') ++p;
+  }
+  return p;
+}
+
+std::size_t skip_object(std::string_view s, std::size_t p) { return skip_object(s, p, 0); }
+
+void for_each_entry(std::string_view s, std::size_t dict,
+                    const std::function<bool(Span, Span)>& fn) {
+  std::size_t p = skip_ws(s, dict);
+  if (!starts(s, p, "<<")) return;
+  p += 2;
+  for (;;) {
+    p = skip_ws(s, p);
+    if (p >= s.size() || s[p] != '/') return;
+    const auto ne = skip_object(s, p, 1);
+    if (ne == npos) return;
+    const auto vb = skip_ws(s, ne);
+    const auto ve = skip_object(s, vb, 1);
+    if (ve == npos || !fn({p, ne}, {vb, ve})) return;
+    p = ve;
+  }
+}
+
+Span dict_get(std::string_view s, std::size_t dict, std::string_view key) {
+  Span v;
+  entry_get(s, dict, key, &v);
+  return v;
+}
+
+bool parse_uint(std::string_view v, std::uint64_t& out) {
+  if (v.empty() || v.size() > 19) return false;
+  out = 0;
+  for (char c : v) {
+    if (!is_digit(c)) return false;
+    out = out * 10 + std::uint64_t(c - '0');
+  }
+  return true;
+}
+
+bool parse_ref(std::string_view v, Ref& out) {
+  std::uint64_t n, g;
+  auto p = read_uint(v, 0, n);
+  if (p == npos || (p = read_uint(v, p, g)) == npos) return false;
+  p = skip_ws(v, p);
+  if (p >= v.size() || v[p] != 'R' || n >= kMaxObjects || g > 65535) return false;
+  out = {static_cast<std::uint32_t>(n), static_cast<std::uint32_t>(g)};
+  return true;
+}
+
+void blank_entry(std::string& s, std::size_t dict, std::string_view key) {
+  auto e = entry_get(s, dict, key, nullptr);
+  if (e.ok()) std::fill(s.begin() + e.b, s.begin() + e.e, ' ');
+}
+
+// ---------- recovery index ----------
+
+void ObjectIndex::build(std::string_view s, std::span<const std::string_view> names) {
+  objects_.clear();
+  trailer_ = {};
+  // bytes that can start or end a token the index cares about; everything else is text
+  static constexpr auto kStop = [] {
+    std::array<bool, 256> t{};
+    for (unsigned char c : std::string_view("()<>%/jrm")) t[c] = true;
+    return t;
+  }();
+  constexpr std::size_t none = npos;
+  std::size_t cur = none; // open object
+  bool trailer = false;   // inside the dictionary after "trailer"
+  int depth = 0;          // dictionary nesting within the open object or trailer
+  const std::size_t n = s.size();
+  auto word_end = [&](std::size_t p) { return p >= n || is_space(s[p]) || is_delim(s[p]); };
+  auto close = [&](std::size_t at) {
+    if (cur != none) objects_[cur].end = at;
+    cur = none;
+    trailer = false;
+    depth = 0;
+  };
+
+  for (std::size_t p = 0; p < n; ++p) {
+    while (p < n && !kStop[static_cast<unsigned char>(s[p])]) ++p;
+    if (p >= n) break;
+    switch (s[p]) {
+      case '%':
+        while (p + 1 < n && s[p + 1] != '\n' && s[p + 1] != '\r') ++p;
+        break;
+      case '(': {
+        // an unterminated string is damage, not the rest of the file
+        const auto e = skip_object(s, p, 0);
+        if (e != npos) p = e - 1;
+        break;
+      }
+      case '<':
+        if (p + 1 < n && s[p + 1] == '<') {
+          if (++depth == 1) {
+            if (cur != none && !objects_[cur].dict.ok()) objects_[cur].dict.b = p;
+            else if (trailer && !trailer_.ok()) trailer_.b = p;
+          }
+          ++p;
+        } else if (const auto e = s.find('>', p); e != npos) {
+          p = e; // hex string
+        }
+        break;
+      case '>':
+        if (p + 1 < n && s[p + 1] == '>' && depth > 0) {
+          if (--depth == 0) {
+            if (cur != none && objects_[cur].dict.ok() && objects_[cur].dict.e == npos) objects_[cur].dict.e = p + 2;
+            else if (trailer && trailer_.ok() && trailer_.e == npos) { trailer_.e = p + 2; trailer = false; }
+          }
+          ++p;
+        }
+        break;
+      case '/': {
+        std::size_t e = p + 1;
+        while (!word_end(e)) ++e;
+        if (depth == 1 && cur != none) {
+          const auto name = s.substr(p, e - p);
+          for (std::size_t i = 0; i < names.size() && i < 32; ++i) {
+            if (name == names[i]) objects_[cur].names |= 1u << i;
+          }
+        }
+        p = e - 1;
+        break;
+      }
+      case 'j': // "obj" / "endobj"
+        if (p < 2 || s[p - 1] != 'b' || s[p - 2] != 'o' || !word_end(p + 1)) break;
+        if (p >= 5 && s.compare(p - 5, 3, "end") == 0) { close(p - 5); break; }
+        {
+          // "N G obj", read backwards
+          std::size_t q = p - 2, ge = q;
+          while (q > 0 && is_space(s[q - 1])) --q;
+          if (q == ge) break;
+          ge = q;
+          while (q > 0 && is_digit(s[q - 1])) --q;
+          const std::size_t gb = q;
+          if (gb == ge) break;
+          while (q > 0 && is_space(s[q - 1])) --q;
+          if (q == gb) break;
+          const std::size_t ne = q;
+          while (q > 0 && is_digit(s[q - 1])) --q;
+          if (q == ne || ne - q > 10 || ge - gb > 5 || (q > 0 && !is_space(s[q - 1]) && !is_delim(s[q - 1]))) break;
+          std::uint64_t num = 0, gen = 0;
+          read_uint(s, q, num);
+          read_uint(s, gb, gen);
+          if (num >= kMaxObjects) break;
+          close(q);
+          IndexedObject o;
+          o.num = static_cast<std::uint32_t>(num);
+          o.gen = static_cast<std::uint32_t>(gen);
+          o.hdr = q;
+          cur = objects_.size();
+          objects_.push_back(o);
+        }
+        break;
+      case 'r': // "trailer"
+        if (p >= 6 && s.compare(p - 6, 7, "trailer") == 0 && word_end(p + 1)) {
+          close(p - 6);
+          trailer = true;
+          trailer_ = {};
+        }
+        break;
+      case 'm': // "stream": its data is opaque, cross it in one search
+        if (p >= 5 && s.compare(p - 5, 6, "stream") == 0 && p + 1 < n && (s[p + 1] == '\r' || s[p + 1] == '\n') &&
+            !(p >= 8 && s.compare(p - 8, 3, "end") == 0)) {
+          const auto e = s.find("endstream", p + 1);
+          p = e == npos ? n : e + 8;
+          depth = 0;
+        }
+        break;
+    }
+  }
+  close(n);
+}
+
+const IndexedObject* ObjectIndex::find(std::uint32_t num) const {
+  for (auto it = objects_.rbegin(); it != objects_.rend(); ++it) {
+    if (it->num == num) return &*it;
+  }
+  return nullptr;
+}
+
+// ---------- cross-reference chain ----------
+
+void Xref::set(std::uint32_t num, const Entry& e) {
+  if (num >= kMaxObjects) return;
+  if (num >= entries_.size()) entries_.resize(num + 1);
+  if (!entries_[num].type) entries_[num] = e; // newer sections were read first
+}
+
+const Entry* Xref::find(std::uint32_t num) const {
+  return num < entries_.size() && entries_[num].type ? &entries_[num] : nullptr;
+}
+
+bool Xref::table_at(std::string_view pdf, std::size_t p, std::uint64_t& prev, std::uint64_t& xstm) {
+  p += 4; // "xref"
+  for (;;) {
+    p = skip_ws(pdf, p);
+    if (starts(pdf, p, "trailer")) break;
+    std::uint64_t start, count;
+    if ((p = read_uint(pdf, p, start)) == npos || (p = read_uint(pdf, p, count)) == npos) return false;
+    if (start + count > kMaxObjects) return false;
+    for (std::uint64_t i = 0; i < count; ++i) {
+      std::uint64_t off, gen;
+      if ((p = read_uint(pdf, p, off)) == npos || (p = read_uint(pdf, p, gen)) == npos) return false;
+      p = skip_ws(pdf, p);
+      if (p >= pdf.size()) return false;
+      if (pdf[p] == 'n' && off) set(static_cast<std::uint32_t>(start + i), {1, off, 0});
+      ++p;
+    }
+  }
+  const auto d = skip_ws(pdf, p + 7);
+  const auto e = skip_object(pdf, d);
+  if (e == npos) return false;
+  const auto dict = pdf.substr(d, e - d);
+  if (trailer_.empty()) trailer_.assign(dict);
+  std::uint64_t v;
+  auto pv = dict_get(dict, 0, "/Prev");
+  if (pv.ok() && parse_uint(pv.in(dict), v)) prev = v;
+  auto xs = dict_get(dict, 0, "/XRefStm");
+  if (xs.ok() && parse_uint(xs.in(dict), v)) xstm = v;
+  if (!size_) {
+    auto sz = dict_get(dict, 0, "/Size");
+    if (sz.ok() && parse_uint(sz.in(dict), v)) size_ = static_cast<std::uint32_t>(std::min<std::uint64_t>(v, kMaxObjects));
+  }
+  return true;
+}
+
+bool Xref::stream_at(std::string_view pdf, std::size_t p, std::uint64_t& prev) {
+  Stream st;
+  if (!backends::pdf::stream_at(pdf, *this, p, st)) return false;
+  auto type = dict_get(pdf, st.dict, "/Type");
+  if (!type.ok() || type.in(pdf) != "/XRef") return false;
+  std::uint64_t w[3] = {0, 0, 0}, v;
+  auto wa = dict_get(pdf, st.dict, "/W");
+  if (!wa.ok()) return false;
+  {
+    std::size_t q = wa.b + 1;
+    for (auto& x : w) if ((q = read_uint(pdf, q, x)) == npos || x > 8) return false;
+  }
+  const std::size_t row = w[0] + w[1] + w[2];
+  if (!row) return false;
+  std::uint64_t size = 0;
+  auto sz = dict_get(pdf, st.dict, "/Size");
+  if (!sz.ok() || !parse_uint(sz.in(pdf), size)) return false;
+  std::vector<std::uint64_t> index;
+  auto ix = dict_get(pdf, st.dict, "/Index");
+  if (ix.ok()) {
+    std::size_t q = ix.b + 1;
+    while ((q = read_uint(pdf, q, v)) != npos && q <= ix.e) index.push_back(v);
+  }
+  if (index.size() < 2) index = {0, size};
+
+  std::string d;
+  bool fits = true;
+  if (!decode(pdf, st, [&](std::string_view w, std::size_t) {
+        if (d.size() + w.size() > kMaxXrefStream) { fits = false; return false; }
+        d.append(w);
+        return true;
+      }) || !fits) {
+    return false;
+  }
+  auto parms = dict_get(pdf, st.dict, "/DecodeParms");
+  if (parms.ok() && pdf[parms.b] == '<') {
+    auto pred = dict_get(pdf, parms.b, "/Predictor");
+    std::uint64_t predictor = 1, columns = 1;
+    if (pred.ok()) parse_uint(pred.in(pdf), predictor);
+    auto cols = dict_get(pdf, parms.b, "/Columns");
+    if (cols.ok()) parse_uint(cols.in(pdf), columns);
+    if (predictor >= 10 && !unpredict(d, columns)) return false;
+    if (predictor > 1 && predictor < 10) return false; // TIFF predictor: not used for xref streams
+  }
+
+  if (trailer_.empty()) trailer_.assign(pdf.substr(st.dict, skip_object(pdf, st.dict) - st.dict));
+  if (!size_) size_ = static_cast<std::uint32_t>(std::min<std::uint64_t>(size, kMaxObjects));
+  auto field = [&](std::size_t at, std::uint64_t n) {
+    std::uint64_t x = 0;
+    for (std::uint64_t k = 0; k < n; ++k) x = x << 8 | static_cast<unsigned char>(d[at + k]);
+    return x;
+  };
+  std::size_t at = 0;
+  for (std::size_t k = 0; k + 1 < index.size(); k += 2) {
+    for (std::uint64_t i = 0; i < index[k + 1] && at + row <= d.size(); ++i, at += row) {
+      const auto type = w[0] ? field(at, w[0]) : 1;
+      const auto f2 = field(at + w[0], w[1]);
+      const auto f3 = field(at + w[0] + w[1], w[2]);
+      const auto num = index[k] + i;
+      if (num >= kMaxObjects) break;
+      if (type == 1 && f2) set(static_cast<std::uint32_t>(num), {1, f2, 0});
+      else if (type == 2) set(static_cast<std::uint32_t>(num), {2, f2, static_cast<std::uint32_t>(f3)});
+    }
+  }
+  auto pv = dict_get(pdf, st.dict, "/Prev");
+  if (pv.ok() && parse_uint(pv.in(pdf), v)) prev = v;
+  return true;
+}
+
+bool Xref::load(std::string_view pdf) {
+  const auto tail = pdf.size() > 4096 ? pdf.size() - 4096 : 0;
+  const auto sx = pdf.rfind("startxref");
+  if (sx == npos || sx < tail) return false;
+  std::uint64_t off;
+  if (read_uint(pdf, sx + 9, off) == npos) return false;
+  std::set<std::uint64_t> seen;
+  bool any = false;
+  std::vector<std::uint64_t> pending{off};
+  while (!pending.empty() && seen.size() < 64) {
+    const auto at = pending.back();
+    pending.pop_back();
+    if (at >= pdf.size() || !seen.insert(at).second) continue;
+    std::uint64_t prev = 0, xstm = 0;
+    const auto p = skip_ws(pdf, static_cast<std::size_t>(at));
+    bool ok;
+    if (starts(pdf, p, "xref")) {
+      ok = table_at(pdf, p, prev, xstm);
+    } else {
+      ok = stream_at(pdf, p, prev);
+      if (ok && !any) stream_ = true;
+    }
+    if (!ok) break; // keep what the newer sections gave
+    if (!any) last_ = at;
+    any = true;
+    if (prev) pending.push_back(prev);
+    if (xstm) pending.push_back(xstm); // hybrid file: its stream goes before /Prev
+  }
+  return any && trailer_get("/Root").ok();
+}
+
+// ---------- objects and streams ----------
+
+Span object_at(std::string_view pdf, std::uint64_t off, std::uint32_t* num) {
+  std::uint64_t n, g;
+  auto p = read_uint(pdf, static_cast<std::size_t>(off), n);
+  if (p == npos || (p = read_uint(pdf, p, g)) == npos) return {};
+  p = skip_ws(pdf, p);
+  if (!starts(pdf, p, "obj")) return {};
+  const auto b = skip_ws(pdf, p + 3);
+  const auto e = skip_object(pdf, b);
+  if (e == npos) return {};
+  if (num) *num = static_cast<std::uint32_t>(n);
+  return {b, e};
+}
+
+bool stream_at(std::string_view pdf, const Xref& xref, std::uint64_t off, Stream& out) {
+  const auto body = object_at(pdf, off);
+  if (!body.ok() || !starts(pdf, body.b, "<<")) return false;
+  auto p = skip_ws(pdf, body.e);
+  if (!starts(pdf, p, "stream")) return false;
+  p += 6;
+  if (p < pdf.size() && pdf[p] == '\r') ++p;
+  if (p < pdf.size() && pdf[p] == '\n') ++p;
+  out.dict = body.b;
+  out.data = p;
+
+  std::uint64_t len = 0;
+  bool have = false;
+  auto lv = dict_get(pdf, body.b, "/Length");
+  if (lv.ok()) {
+    Ref r;
+    if (parse_uint(lv.in(pdf), len)) have = true;
+    else if (parse_ref(lv.in(pdf), r)) {
+      const auto* e = xref.find(r.num);
+      if (e && e->type == 1) {
+        auto v = object_at(pdf, e->off);
+        have = v.ok() && parse_uint(v.in(pdf), len);
+      }
+    }
+  }
+  if (have && p + len <= pdf.size() && starts(pdf, skip_ws(pdf, p + len), "endstream")) {
+    out.len = static_cast<std::size_t>(len);
+    return true;
+  }
+  // wrong or missing /Length: up to the end-of-line before "endstream"
+  auto end = pdf.find("endstream", p);
+  if (end == npos) return false;
+  if (end > p && pdf[end - 1] == '\n') --end;
+  if (end > p && pdf[end - 1] == '\r') --end;
+  out.len = end - p;
+  return true;
+}
+
+Filter stream_filter(std::string_view pdf, const Stream& s) {
+  auto f = dict_get(pdf, s.dict, "/Filter");
+  if (!f.ok()) return Filter::None;
+  auto v = f.in(pdf);
+  if (v.front() == '[') {
+    const auto b = skip_ws(v, 1);
+    const auto e = skip_object(v, b);
+    if (e == npos || skip_ws(v, e) != v.size() - 1) return b == v.size() - 1 ? Filter::None : Filter::Other;
+    v = v.substr(b, e - b);
+  }
+  return v == "/FlateDecode" || v == "/Fl" ? Filter::Flate : Filter::Other;
+}
+
+bool inflate(std::string_view data, const std::function<bool(std::string_view)>& sink) {
+#ifdef HAVE_ZLIB
+  z_stream zs{};
+  if (inflateInit(&zs) != Z_OK) return false;
+  std::string window(kWindow, '\0');
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  zs.avail_in = static_cast<uInt>(data.size());
+  bool ok = true;
+  for (;;) {
+    zs.next_out = reinterpret_cast<Bytef*>(window.data());
+    zs.avail_out = static_cast<uInt>(window.size());
+    const int rc = ::inflate(&zs, Z_NO_FLUSH);
+    const std::size_t got = window.size() - zs.avail_out;
+    if (got && !sink(std::string_view(window.data(), got))) break;
+    if (rc == Z_STREAM_END) break;
+    if (rc == Z_BUF_ERROR && !got) break; // truncated input: keep what was decoded
+    if (rc != Z_OK) { ok = zs.total_out > 0; break; }
+  }
+  inflateEnd(&zs);
+  return ok;
+#else
+  (void)data;
+  (void)sink;
+  return false;
+#endif
+}
+
+bool load_object(std::string_view pdf, const Xref& xref, std::uint32_t num,
+                 std::string& scratch, std::string_view& body, Entry& where) {
+  const auto* e = xref.find(num);
+  if (!e) return false;
+  where = *e;
+  if (e->type == 1) {
+    auto s = object_at(pdf, e->off);
+    if (!s.ok()) return false;
+    body = s.in(pdf);
+    return true;
+  }
+  if (e->off >= kMaxObjects) return false;
+  Stream st;
+  ObjStm os;
+  if (!open_objstm(pdf, xref, static_cast<std::uint32_t>(e->off), st, os)) return false;
+  scratch.clear();
+  bool fits = true;
+  const bool ok = walk_objstm(pdf, st, os, e->idx, [&](std::string_view w, bool target) {
+    if (!target) return !os.located || scratch.empty(); // past the object: stop
+    if (scratch.size() + w.size() > kMaxObject) { fits = false; return false; }
+    scratch.append(w);
+    return true;
+  });
+  if (!ok || !fits || scratch.empty()) return false;
+  const auto b = skip_ws(scratch, 0);
+  const auto end = skip_object(scratch, b);
+  if (end == npos) return false;
+  body = std::string_view(scratch).substr(b, end - b);
+  return true;
+}
+
+#ifdef HAVE_ZLIB
+namespace {
+class Deflater {
+public:
+  explicit Deflater(std::string& out) : out_(out) { ok_ = deflateInit(&zs_, Z_DEFAULT_COMPRESSION) == Z_OK; }
+  ~Deflater() { if (ok_) deflateEnd(&zs_); }
+  Deflater(const Deflater&) = delete;
+  Deflater& operator=(const Deflater&) = delete;
+
+  bool add(std::string_view in, bool last = false) {
+    if (!ok_) return false;
+    zs_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs_.avail_in = static_cast<uInt>(in.size());
+    const int flush = last ? Z_FINISH : Z_NO_FLUSH;
+    char buf[16 * 1024];
+    for (;;) {
+      zs_.next_out = reinterpret_cast<Bytef*>(buf);
+      zs_.avail_out = sizeof buf;
+      const int rc = deflate(&zs_, flush);
+      if (rc == Z_STREAM_ERROR) return ok_ = false;
+      out_.append(buf, sizeof buf - zs_.avail_out);
+      if (last ? rc == Z_STREAM_END : zs_.avail_out != 0) return true;
+    }
+  }
+
+private:
+  z_stream zs_{};
+  std::string& out_;
+  bool ok_ = false;
+};
+} // namespace
+#endif
+
+bool rewrite_objstm(std::string_view pdf, const Xref& xref, std::uint32_t stm, std::uint32_t idx,
+                    const std::function<void(std::string&)>& edit, std::string& dict, std::string& data) {
+#ifdef HAVE_ZLIB
+  Stream st;
+  ObjStm os;
+  if (!open_objstm(pdf, xref, stm, st, os)) return false;
+  data.clear();
+  Deflater z(data);
+  std::string target;
+  bool ok = true, flushed = false;
+  auto flush_target = [&] {
+    const auto n = target.size();
+    edit(target);
+    flushed = true;
+    return target.size() == n && z.add(target);
+  };
+  const bool walked = walk_objstm(pdf, st, os, idx, [&](std::string_view w, bool in) {
+    if (in) {
+      if (target.size() + w.size() > kMaxObject) { ok = false; return false; }
+      target.append(w);
+      if (os.e != npos && os.b + target.size() == os.e && !flush_target()) { ok = false; return false; }
+      return true;
+    }
+    if (os.located && !flushed && !target.empty() && !flush_target()) { ok = false; return false; }
+    if (!z.add(w)) { ok = false; return false; }
+    return true;
+  });
+  if (!walked || !ok) return false;
+  if (!flushed && (target.empty() || !flush_target())) return false; // last object, or never found
+  if (!z.add({}, true)) return false;
+
+  dict = "/Type /ObjStm /N " + std::to_string(os.n) + " /First " + std::to_string(os.first) +
+         " /Filter /FlateDecode";
+  auto ext = dict_get(pdf, st.dict, "/Extends");
+  if (ext.ok()) dict.append(" /Extends ").append(ext.in(pdf));
+  return true;
+#else
+  (void)pdf; (void)xref; (void)stm; (void)idx; (void)edit; (void)dict; (void)data;
+  return false;
+#endif
+}
+
+void append_update(std::string& pdf, const Xref& xref, std::uint32_t num,
+                   std::string_view dict, std::string_view data) {
+  if (!pdf.empty() && pdf.back() != '\n') pdf += '\n';
+  const auto off = pdf.size();
+  pdf.append(std::to_string(num)).append(" 0 obj\n<< ").append(dict);
+  pdf.append(" /Length ").append(std::to_string(data.size())).append(" >>\nstream\n");
+  pdf.append(data).append("\nendstream\nendobj\n");
+
+  std::string keep; // trailer entries carried into the new section
+  for (auto key : {"/Root", "/Info", "/ID", "/Encrypt"}) {
+    auto v = xref.trailer_get(key);
+    if (v.ok()) keep.append(" ").append(key).append(" ").append(v.in(xref.trailer()));
+  }
+  const auto prev = std::to_string(xref.last_section());
+  const auto xoff = pdf.size();
+  if (xref.stream_sections()) {
+    // an xref stream of two entries: the replaced object and the stream itself
+    const auto xnum = std::max<std::uint32_t>(xref.size(), num + 1);
+    std::string rows;
+    for (std::uint64_t o : {std::uint64_t(off), std::uint64_t(xoff)}) {
+      rows += '\x01';
+      for (int k = 3; k >= 0; --k) rows += char(o >> (8 * k) & 0xFF);
+      rows.append(2, '\0');
+    }
+    pdf.append(std::to_string(xnum)).append(" 0 obj\n<< /Type /XRef /Size ").append(std::to_string(xnum + 1));
+    pdf.append(" /W [1 4 2] /Index [").append(std::to_string(num)).append(" 1 ").append(std::to_string(xnum));
+    pdf.append(" 1] /Prev ").append(prev).append(keep);
+    pdf.append(" /Length ").append(std::to_string(rows.size())).append(" >>\nstream\n");
+    pdf.append(rows).append("\nendstream\nendobj\n");
+  } else {
+    pdf.append("xref\n").append(std::to_string(num)).append(" 1\n").append(pad10(off)).append(" 00000 n \n");
+    pdf.append("trailer\n<< /Size ").append(std::to_string(std::max<std::uint32_t>(xref.size(), num + 1)));
+    pdf.append(" /Prev ").append(prev).append(keep).append(" >>\n");
+  }
+  pdf.append("startxref\n").append(std::to_string(xoff)).append("\n%%EOF\n");
+}
+
+} // namespace backends::pdf
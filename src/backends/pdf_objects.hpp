@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Object-level access to a PDF held in memory: a small lexer, the cross-reference chain
+// (classic tables and xref streams), indirect-object lookup including compressed object
+// streams, and zlib through a fixed-size window. Nothing here decompresses more than the
+// one stream it is asked for, and object streams are never held decompressed as a whole.
+namespace backends::pdf {
+
+inline constexpr std::size_t npos = std::string_view::npos;
+
+struct Span {
+  std::size_t b = npos, e = npos;
+  bool ok() const { return b != npos; }
+  std::size_t size() const { return e - b; }
+  std::string_view in(std::string_view s) const { return s.substr(b, e - b); }
+};
+
+struct Ref { std::uint32_t num = 0, gen = 0; };
+
+// --- lexer ---
+bool is_space(char c);
+// Skips whitespace and comments.
+std::size_t skip_ws(std::string_view s, std::size_t p);
+// One past the object starting at `p` (a reference "N G R" counts as one); npos if malformed.
+std::size_t skip_object(std::string_view s, std::size_t p);
+// Calls fn(key, value) for each top-level entry of the dictionary at `dict`, in order,
+// until it returns false; the key span includes its '/'.
+void for_each_entry(std::string_view s, std::size_t dict, const std::function<bool(Span, Span)>& fn);
+// Value of `key` ("/Info") at the top level of the dictionary starting at `dict` ("<<").
+Span dict_get(std::string_view s, std::size_t dict, std::string_view key);
+bool parse_uint(std::string_view v, std::uint64_t& out);
+bool parse_ref(std::string_view v, Ref& out);
+// Overwrite the dictionary entry `key` and its value with spaces (length-preserving).
+void blank_entry(std::string& s, std::size_t dict, std::string_view key);
+
+// --- cross-reference chain ---
+struct Entry {
+  std::uint8_t type = 0; // 0 free/unknown, 1 at byte `off`, 2 in object stream `off` at `idx`
+  std::uint64_t off = 0;
+  std::uint32_t idx = 0;
+};
+
+class Xref {
+public:
+  // Follows startxref and every /Prev (and hybrid /XRefStm) section, newest entry wins.
+  bool load(std::string_view pdf);
+  const Entry* find(std::uint32_t num) const;
+  // Newest trailer dictionary (for xref streams, the stream's dictionary)
+  const std::string& trailer() const { return trailer_; }
+  Span trailer_get(std::string_view key) const { return dict_get(trailer_, 0, key); }
+  std::uint64_t last_section() const { return last_; }
+  bool stream_sections() const { return stream_; }
+  std::uint32_t size() const { return size_; }
+
+private:
+  bool table_at(std::string_view pdf, std::size_t p, std::uint64_t& prev, std::uint64_t& xstm);
+  bool stream_at(std::string_view pdf, std::size_t p, std::uint64_t& prev);
+  void set(std::uint32_t num, const Entry& e);
+
+  std::vector<Entry> entries_;
+  std::string trailer_;
+  std::uint64_t last_ = 0;
+  std::uint32_t size_ = 0;
+  bool stream_ = false;
+};
+
+// --- recovery index (no usable cross-reference chain) ---
+struct IndexedObject {
+  std::uint32_t num = 0, gen = 0;
+  std::size_t hdr = npos;  // "N G obj"
+  std::size_t end = npos;  // "endobj", or the next header / end of file when it is missing
+  Span dict;               // top-level dictionary, when the object has one
+  std::uint32_t names = 0; // bit i set when names[i] occurs directly inside `dict`
+};
+
+// Every "N G obj" ... "endobj" of the file with its top-level dictionary, found in one
+// linear pass. Strings, comments and stream data are skipped, so their bytes never look
+// like structure; stream data, the bulk of a large file, is crossed with a single search.
+class ObjectIndex {
+public:
+  void build(std::string_view pdf, std::span<const std::string_view> names = {});
+  const std::vector<IndexedObject>& objects() const { return objects_; }
+  // Last definition of `num` (a later one replaces it, as in an incremental update)
+  const IndexedObject* find(std::uint32_t num) const;
+  // Dictionary following the last "trailer" keyword
+  Span trailer() const { return trailer_; }
+
+private:
+  std::vector<IndexedObject> objects_;
+  Span trailer_;
+};
+
+// --- objects and streams ---
+// Body of a top-level object at `off` ("N G obj <body>"); `num` is set from the header.
+Span object_at(std::string_view pdf, std::uint64_t off, std::uint32_t* num = nullptr);
+
+struct Stream {
+  std::size_t dict = npos; // "<<" of the stream dictionary
+  std::size_t data = npos; // first byte after the "stream" line
+  std::size_t len = 0;
+};
+// Stream object at `off`; an indirect /Length is resolved through `xref`.
+bool stream_at(std::string_view pdf, const Xref& xref, std::uint64_t off, Stream& out);
+
+enum class Filter { None, Flate, Other };
+Filter stream_filter(std::string_view pdf, const Stream& s);
+
+// Inflates `data` through a fixed 64 KiB window, handing each filled window to `sink`.
+// The sink returns false to stop early. False on a zlib error, or without zlib.
+bool inflate(std::string_view data, const std::function<bool(std::string_view)>& sink);
+
+// Object `num` as text: a view into `pdf` for plain objects, or its bytes inside an object
+// stream copied to `scratch` (only that object is kept). `where` receives the entry.
+bool load_object(std::string_view pdf, const Xref& xref, std::uint32_t num,
+                 std::string& scratch, std::string_view& body, Entry& where);
+
+// Re-encodes object stream `stm` with `edit` applied to object `idx`'s bytes, streaming
+// through the inflate window into a deflater. `edit` must keep the length. On success
+// `data` holds the new compressed stream and `dict` a dictionary for it.
+bool rewrite_objstm(std::string_view pdf, const Xref& xref, std::uint32_t stm, std::uint32_t idx,
+                    const std::function<void(std::string&)>& edit, std::string& dict, std::string& data);
+
+// Appends an incremental update replacing object `num` with a stream (`dict` without
+// /Length, and `data`), plus a cross-reference section in the document's own style.
+void append_update(std::string& pdf, const Xref& xref, std::uint32_t num,
+                   std::string_view dict, std::string_view data);
+
+} // namespace backends::pdf
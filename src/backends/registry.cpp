@@ -0,0 +1,99 @@
+#include "registry.hpp"
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#ifdef HAVE_EXIV2
+#include "image_exiv2.hpp"
+#endif
+#ifdef HAVE_POPPLER
+#include "pdf_info.hpp"
+#endif
+#ifdef HAVE_TAGLIB
+#include "audio_taglib.hpp"
+#endif
+#ifdef HAVE_MINIZIP
+#include "zip_minizip.hpp"
+#endif
+
+namespace backends {
+namespace {
+
+using core::FileType;
+
+#ifdef HAVE_EXIV2
+// Exiv2 is reentrant per image once its XMP toolkit has a lock (image_init)
+constexpr Backend kImage{"exiv2", FileType::Image, true, 0, image_init,
+                         image_inspect, image_strip_buffer, image_strip_to};
+#endif
+#ifdef HAVE_POPPLER
+constexpr Backend kPdf{"pdf-info", FileType::PDF, true, 0, nullptr,
+                       pdf_inspect, pdf_strip_buffer, pdf_strip_to};
+#endif
+#ifdef HAVE_TAGLIB
+// TagLib shares unsynchronized frame factories and reference counts between files
+constexpr Backend kAudio{"taglib", FileType::Audio, false, 1, nullptr,
+                         audio_inspect, audio_strip_buffer, audio_strip_to};
+#endif
+#ifdef HAVE_MINIZIP
+constexpr Backend kZip{"zip", FileType::ZIP, true, 0, nullptr,
+                       zip_inspect, zip_strip_buffer, zip_strip_to};
+#endif
+
+constexpr auto kTable = [] {
+  std::array<const Backend*, kTypes> t{};
+  auto put = [&](const Backend& b) { t[static_cast<std::size_t>(b.type)] = &b; };
+#ifdef HAVE_EXIV2
+  put(kImage);
+#endif
+#ifdef HAVE_POPPLER
+  put(kPdf);
+#endif
+#ifdef HAVE_TAGLIB
+  put(kAudio);
+#endif
+#ifdef HAVE_MINIZIP
+  put(kZip);
+#endif
+  (void)put;
+  return t;
+}();
+
+struct Gate {
+  std::mutex mu;
+  std::condition_variable cv;
+  unsigned busy = 0;
+};
+std::array<Gate, kTypes> g_gates;
+
+} // namespace
+
+const Backend* find(FileType t) {
+  static const bool ready = [] {
+    for (auto* b : kTable) if (b && b->init) b->init();
+    return true;
+  }();
+  (void)ready;
+  const auto i = static_cast<std::size_t>(t);
+  return i < kTypes ? kTable[i] : nullptr;
+}
+
+Slot::Slot(const Backend& b) : b_(b) {
+  const auto cap = b_.limit();
+  if (!cap) return;
+  auto& g = g_gates[static_cast<std::size_t>(b_.type)];
+  std::unique_lock<std::mutex> lk(g.mu);
+  g.cv.wait(lk, [&] { return g.busy < cap; });
+  ++g.busy;
+}
+
+Slot::~Slot() {
+  if (!b_.limit()) return;
+  auto& g = g_gates[static_cast<std::size_t>(b_.type)];
+  {
+    std::lock_guard<std::mutex> lk(g.mu);
+    --g.busy;
+  }
+  g.cv.notify_one();
+}
+
+} // namespace backends
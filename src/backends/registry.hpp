@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "core/detect.hpp"
+#include "core/policy.hpp"
+
+// Backend table, filled at compile time from the CMake backend options (HAVE_*). Each
+// compiled-in backend owns the slot of the FileType it handles, so dispatch is one
+// array index and adding a format never touches core.
+namespace backends {
+
+inline constexpr std::size_t kTypes = static_cast<std::size_t>(core::FileType::ZIP) + 1;
+
+struct Backend {
+  const char* name;
+  core::FileType type;
+  // False when the library keeps unguarded global state: one file at a time.
+  bool thread_safe;
+  // Most files of this backend in flight at once; 0 = no cap beyond --jobs.
+  unsigned max_concurrency;
+  void (*init)(); // once, before first use; may be null
+  core::InspectResult (*inspect)(const core::Detected&);
+  core::InspectResult (*strip_buffer)(const core::Detected&, const core::Policy&, std::string&);
+  core::InspectResult (*strip_to)(const core::Detected&, const std::string&, const core::Policy&);
+
+  // Effective cap, 0 = unlimited
+  constexpr unsigned limit() const { return thread_safe ? max_concurrency : 1; }
+};
+
+// Backend for `t`, or nullptr when none is compiled in.
+const Backend* find(core::FileType t);
+
+// Holds one of the backend's concurrency slots, waiting for a free one. The scheduler
+// already keeps capped backends under their limit, so this only blocks callers that
+// bypass it (serve workers, files whose extension hid their type).
+class Slot {
+public:
+  explicit Slot(const Backend& b);
+  ~Slot();
+  Slot(const Slot&) = delete;
+  Slot& operator=(const Slot&) = delete;
+
+private:
+  const Backend& b_;
+};
+
+} // namespace backends
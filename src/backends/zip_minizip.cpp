@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <span>
 #include <fstream>
 #include <vector>
 #include <string>
@@ -10,6 +11,8 @@
 #include "../core/detect.hpp"
 #include "../core/sanitize.hpp"
 #include "../core/policy.hpp"
+#include "util/commit.hpp"
+#include "util/stats.hpp"
 
 namespace fs = std::filesystem;
 
@@ -21,6 +24,7 @@ static constexpr uint32_t SIG_CEN   = 0x02014b50; // Central directory file head
 
 // helper: read whole file
 static bool read_file(const std::string& path, std::vector<unsigned char>& buf) {
+  util::stats::Timer t(util::stats::Phase::Open, path);
   std::ifstream f(path, std::ios::binary);
   if (!f) return false;
   f.seekg(0, std::ios::end);
@@ -29,6 +33,7 @@ static bool read_file(const std::string& path, std::vector<unsigned char>& buf)
   buf.resize(static_cast<size_t>(len));
   f.seekg(0, std::ios::beg);
   f.read(reinterpret_cast<char*>(buf.data()), len);
+  util::stats::bytes_read(static_cast<std::uint64_t>(f.gcount()));
   return f.good();
 }
 
@@ -46,7 +51,7 @@ struct EOCD {
   uint32_t cd_size=0, cd_offset=0, comment_len=0;
   bool ok=false;
 };
-static EOCD find_eocd(const std::vector<unsigned char>& b) {
+static EOCD find_eocd(std::span<const unsigned char> b) {
   EOCD e{};
   size_t max_back = std::min<size_t>(b.size(), 0x10000 + 22); // EOCD min size is 22
   for (size_t i = 0; i < max_back; ++i) {
@@ -77,7 +82,7 @@ struct ZipAgg {
 };
 
 // Walk central directory to count per-file extras/comments
-static void scan_central_dir(const std::vector<unsigned char>& b, const EOCD& e, ZipAgg& z) {
+static void scan_central_dir(std::span<const unsigned char> b, const EOCD& e, ZipAgg& z) {
   if (!e.ok) return;
   size_t p = e.cd_offset;
   size_t end = e.cd_offset + e.cd_size;
@@ -98,61 +103,18 @@ static void scan_central_dir(const std::vector<unsigned char>& b, const EOCD& e,
   }
 }
 
-// strip: clear archive comment by patching EOCD and truncating file
-static bool clear_archive_comment(const std::string& in, const std::string& out) {
-  std::vector<unsigned char> b;
-  if (!read_file(in, b)) return false;
+// strip: clear archive comment by patching EOCD; returns the size to truncate to
+static size_t clear_archive_comment(std::span<unsigned char> b) {
   auto e = find_eocd(b);
-  if (!e.ok) {
-    // just copy if no EOCD
-    std::ifstream src(in, std::ios::binary);
-    std::ofstream dst(out, std::ios::binary|std::ios::trunc);
-    dst << src.rdbuf();
-    return true;
-  }
-
-  // write out copy first
-  {
-    std::ofstream dst(out, std::ios::binary|std::ios::trunc);
-    dst.write(reinterpret_cast<const char*>(b.data()), b.size());
-    if (!dst) return false;
-  }
-
-  if (e.comment_len == 0) return true; // nothing to do
-
-  // patch comment length to 0 and truncate bytes after EOCD header
-  try {
-    // set 2 bytes at EOCD+20 to 0
-    {
-      std::fstream f(out, std::ios::in|std::ios::out|std::ios::binary);
-      if (!f) return false;
-      f.seekp(static_cast<std::streamoff>(e.off + 20), std::ios::beg);
-      unsigned char zero[2]{0,0};
-      f.write(reinterpret_cast<const char*>(zero), 2);
-      f.flush();
-    }
-    // truncate file to EOCD start + 22 (minimum EOCD size)
-    fs::resize_file(out, static_cast<uintmax_t>(e.off + 22));
-    return true;
-  } catch (...) {
-    return false;
-  }
-}
-
-} // anon
-
-namespace backends {
-
-bool zip_can_handle(const core::Detected& d) {
-  return d.type == core::FileType::ZIP;
+  if (!e.ok || e.comment_len == 0) return b.size(); // nothing to do
+  b[e.off + 20] = 0;
+  b[e.off + 21] = 0;
+  return e.off + 22; // minimum EOCD size
 }
 
-core::InspectResult zip_inspect(const core::Detected& d) {
-  core::InspectResult ir; ir.file = d.path; ir.type = core::FileType::ZIP;
-
-  std::vector<unsigned char> b;
-  if (!read_file(d.path, b)) return ir;
-
+static core::InspectResult inspect_buffer(const std::string& path, std::span<const unsigned char> b) {
+  util::stats::Timer timer(util::stats::Phase::Parse, path);
+  core::InspectResult ir; ir.file = path; ir.type = core::FileType::ZIP;
   auto e = find_eocd(b);
   ZipAgg z{};
   if (e.ok) {
@@ -160,15 +122,15 @@ core::InspectResult zip_inspect(const core::Detected& d) {
     scan_central_dir(b, e, z);
 
     if (z.archive_comment > 0) {
-      ir.fields.push_back({"ZIP.Comment", "<archive comment>", "LOW", "ZIP", (size_t)z.archive_comment});
+      ir.fields.push_back(core::make_field("ZIP.", "ArchiveComment", "<archive comment>", "ZIP", (size_t)z.archive_comment));
       ir.meta_bytes += z.archive_comment;
     }
     if (z.files_with_extra > 0) {
-      ir.fields.push_back({"ZIP.ExtraFields", std::to_string(z.files_with_extra) + " files", "LOW", "ZIP", (size_t)z.sum_extra});
+      ir.fields.push_back(core::make_field("ZIP.", "ExtraFields", std::to_string(z.files_with_extra) + " files", "ZIP", (size_t)z.sum_extra));
       ir.meta_bytes += (size_t)z.sum_extra;
     }
     if (z.files_with_comment > 0) {
-      ir.fields.push_back({"ZIP.FileComments", std::to_string(z.files_with_comment) + " files", "LOW", "ZIP", (size_t)z.sum_file_comments});
+      ir.fields.push_back(core::make_field("ZIP.", "FileComments", std::to_string(z.files_with_comment) + " files", "ZIP", (size_t)z.sum_file_comments));
       ir.meta_bytes += (size_t)z.sum_file_comments;
     }
   }
@@ -179,18 +141,50 @@ core::InspectResult zip_inspect(const core::Detected& d) {
   return ir;
 }
 
-core::InspectResult zip_strip_to(const std::string& in_path,
-                                 const std::string& out_path,
-                                 const core::Policy& /*policy*/) {
-  // MVP: clear only the archive comment (safe, lossless)
-  // If that fails, fallback to a plain copy.
-  if (!clear_archive_comment(in_path, out_path)) {
-    std::ifstream src(in_path, std::ios::binary);
-    std::ofstream dst(out_path, std::ios::binary|std::ios::trunc);
-    dst << src.rdbuf();
+} // anon
+
+namespace backends {
+
+core::InspectResult zip_inspect(const core::Detected& d) {
+  if (!d.bytes.empty())
+    return inspect_buffer(d.path, {reinterpret_cast<const unsigned char*>(d.bytes.data()), d.bytes.size()});
+  std::vector<unsigned char> b;
+  if (!read_file(d.path, b)) {
+    core::InspectResult ir; ir.file = d.path; ir.type = core::FileType::ZIP; return ir;
   }
-  core::Detected d2{out_path, core::FileType::ZIP, {}};
-  return zip_inspect(d2);
+  return inspect_buffer(d.path, b);
+}
+
+core::InspectResult zip_strip_buffer(const core::Detected& in,
+                                     const core::Policy& policy,
+                                     std::string& out) {
+  // MVP: clear only the archive comment (safe, lossless), unless every ZIP field is kept
+  out.clear();
+  if (!in.bytes.empty()) out.assign(in.bytes);
+  else {
+    std::vector<unsigned char> b;
+    if (!read_file(in.path, b)) return zip_inspect(in);
+    out.assign(b.begin(), b.end());
+  }
+  if (core::block_action(policy, "ZIP.") != core::BlockAction::KeepAll) {
+    std::span<unsigned char> b(reinterpret_cast<unsigned char*>(out.data()), out.size());
+    out.resize(clear_archive_comment(b));
+  }
+  return inspect_buffer(in.path, {reinterpret_cast<const unsigned char*>(out.data()), out.size()});
+}
+
+core::InspectResult zip_strip_to(const core::Detected& in,
+                                 const std::string& out_path,
+                                 const core::Policy& policy) {
+  const std::string& in_path = in.path;
+  std::string b;
+  auto ir = zip_strip_buffer(in, policy, b); // already the output's result
+  if (b.empty()) return ir;
+
+  util::OutputFile out(out_path, in_path);
+  if (!out.write(b.data(), b.size()) || !out.commit()) return zip_inspect(in);
+  ir.file = out_path;
+  return ir;
 }
 
 } // namespace backends
@@ -1,12 +1,34 @@
 #include "commands.hpp"
 #include <fmt/format.h>
+#include <algorithm>
+#include <cstdio>
+#include <deque>
 #include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
 #include "core/detect.hpp"
 #include "core/report.hpp"
 #include "core/sanitize.hpp"
 #include "core/policy.hpp"
+#include "core/quick.hpp"
+#include "util/commit.hpp"
+#include "util/dedup.hpp"
 #include "util/fs.hpp"
+#include "util/hash.hpp"
+#include "util/io.hpp"
+#include "util/journal.hpp"
+#include "util/sched.hpp"
+#include "util/stats.hpp"
+#include "util/trace.hpp"
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 using namespace std;
 
@@ -15,15 +37,205 @@ namespace {
   bool has_wildcards(const std::string& s){
     return s.find('*') != std::string::npos || s.find('?') != std::string::npos;
   }
+  // How files are fed to the per-file work: I/O engine, worker threads, memory budget.
+  struct Dispatch {
+    util::io::Engine engine = util::io::Engine::Sync;
+    unsigned depth = 32;
+    unsigned jobs = 1;
+    std::uint64_t max_memory = 0;
+    bool strip = false;
+    std::size_t max_value = core::kAllValues; // Detected::max_value
+  };
+  template <class Opts>
+  bool make_dispatch(const Opts& o, bool strip, Dispatch& d) {
+    if (!util::io::parse_engine(o.io, d.engine)) {
+      fmt::print(stderr, "Unknown --io '{}' (expected sync or uring)\n", o.io);
+      return false;
+    }
+    if (!o.max_memory.empty() && !util::parse_memory(o.max_memory, d.max_memory)) {
+      fmt::print(stderr, "Bad --max-memory '{}' (e.g. 512M, 4G)\n", o.max_memory);
+      return false;
+    }
+    d.depth = o.io_depth;
+    d.jobs = o.jobs ? o.jobs : std::max(1u, std::thread::hardware_concurrency());
+    if (d.engine == util::io::Engine::Uring && d.jobs > 1) {
+      fmt::print(stderr, "Warning: --io uring parses every file on one thread; ignoring --jobs {}\n", d.jobs);
+      d.jobs = 1;
+    }
+    d.strip = strip;
+    return true;
+  }
+  // Field values are rendered only when this run prints them (`wanted`), cut to
+  // --max-value-bytes.
+  template <class Opts>
+  std::size_t value_limit(const Opts& o, bool wanted) {
+    if (!wanted) return 0;
+    return o.max_value_bytes ? o.max_value_bytes : core::kAllValues;
+  }
+  // Detects every file and hands it to fn(index, detected), from several worker threads
+  // and out of order. One Feeder serves a whole run: its pool and memory budget outlive
+  // the chunks of a long file list, which are queued as they are read (submit) and
+  // collected in order (wait), so the next chunk starts while the previous one's last
+  // files finish. Backends with a concurrency cap get no more workers than that. Under
+  // --max-memory each file first reserves its estimated footprint.
+  // With --io uring the files are preloaded through the I/O engine and parsed on the
+  // waiting thread as they complete; make_dispatch has already dropped --jobs to 1.
+  class Feeder {
+  public:
+    using Fn = std::function<void(std::size_t, const core::Detected&)>;
+
+    explicit Feeder(const Dispatch& dp)
+        : dp_(dp), preload_(dp.engine == util::io::Engine::Uring), budget_(dp.max_memory),
+          pool_(preload_ ? 1 : dp.jobs, budget_) {
+      if (!budget_.unlimited()) util::bound_heap_retention();
+    }
+
+    // Queues `files`, which must stay alive until wait() for the returned batch.
+    std::size_t submit(const std::vector<std::string>& files, const char* span_name, Fn fn) {
+      auto& j = jobs_.emplace_back();
+      j.files = &files;
+      j.span_name = span_name;
+      j.fn = std::move(fn);
+      if (!budget_.unlimited()) {
+        j.sizes.resize(files.size());
+        for (std::size_t i = 0; i < files.size(); ++i) {
+          std::error_code ec;
+          auto sz = std::filesystem::file_size(files[i], ec);
+          j.sizes[i] = ec ? 0 : sz;
+        }
+      }
+      const auto id = first_ + jobs_.size() - 1;
+      if (preload_) return id; // loaded and parsed in wait()
+      j.lanes = core::backend_lanes(files);
+      j.batch = pool_.submit(files.size(), [this, &j](std::size_t i) { return cost(j, i); }, [this, &j](std::size_t i) {
+        util::trace::Span span(j.span_name, (*j.files)[i]);
+        core::Detected d;
+        {
+          util::stats::Timer t(util::stats::Phase::Detect, (*j.files)[i]);
+          d = core::detect_file((*j.files)[i]);
+        }
+        d.max_value = dp_.max_value;
+        j.fn(i, d);
+      }, &j.lanes);
+      return id;
+    }
+
+    // Returns once batch `id` and every one before it were handed out in full. `tick`
+    // runs on this thread as files finish (see util::run_budgeted).
+    void wait(std::size_t id, const std::function<void()>& tick = {}) {
+      for (; !jobs_.empty() && first_ <= id; jobs_.pop_front(), ++first_) {
+        auto& j = jobs_.front();
+        if (!preload_) { pool_.wait(j.batch, tick); continue; }
+        const auto& files = *j.files;
+        util::io::LoadOpts lo;
+        lo.engine = dp_.engine;
+        lo.depth = dp_.depth;
+        if (!budget_.unlimited()) { lo.budget = &budget_; lo.cost = [&](std::size_t i) { return cost(j, i); }; }
+        util::io::load_files(files, lo, [&](std::size_t i, util::io::Loaded& l) {
+          util::trace::Span span(j.span_name, files[i]);
+          core::Detected d;
+          {
+            util::stats::Timer t(util::stats::Phase::Detect, files[i]);
+            d = l.err ? core::detect_file(files[i]) : core::detect_buffer(files[i], l.data);
+          }
+          d.max_value = dp_.max_value;
+          j.fn(i, d);
+          if (tick) tick();
+        });
+      }
+    }
+
+  private:
+    struct Job {
+      const std::vector<std::string>* files = nullptr;
+      const char* span_name = "";
+      Fn fn;
+      std::vector<std::uint64_t> sizes; // under --max-memory
+      util::Lanes lanes;
+      util::WorkerPool::Batch batch = 0;
+    };
+    std::uint64_t cost(const Job& j, std::size_t i) const {
+      if (budget_.unlimited()) return 0;
+      return core::estimate_footprint((*j.files)[i], j.sizes[i], dp_.strip, preload_);
+    }
+
+    const Dispatch& dp_;
+    bool preload_;
+    util::MemBudget budget_;
+    std::deque<Job> jobs_; // from first_ on; outlives pool_, whose batches point into it
+    std::size_t first_ = 0;
+    util::WorkerPool pool_;
+  };
+  void write_trace(const std::string& path) {
+    if (path.empty()) return;
+    if (util::trace::write(path)) fmt::print(stderr, "Wrote trace: {}\n", path);
+    else fmt::print(stderr, "Failed to write trace: {}\n", path);
+  }
+  // --shard i/N: this run handles the targets whose key hashes to shard i. The key is the
+  // path, or with --shard-by dir the name of the top-level entry: the entry directly
+  // inside a walked directory, or a file named as a target itself. A subtree thus stays on
+  // one shard and the others skip it without descending. Every shard must be given the
+  // same targets.
+  struct Shard {
+    unsigned index = 0, count = 0; // count 0: not sharded
+    bool by_dir = false;
+    bool owns(const std::filesystem::path& top) const {
+      if (count < 2) return true;
+      const auto key = by_dir ? top.filename().string() : top.string();
+      return util::xxh64(key.data(), key.size()) % count == index;
+    }
+    // An entry met while walking a directory; `depth` 0 is directly inside it. Deeper
+    // entries under --shard-by dir were settled by their top-level entry.
+    bool owns_entry(const std::filesystem::path& p, int depth) const {
+      return (by_dir && depth > 0) || owns(p);
+    }
+    // A file named as a target (argument, --files-from entry or wildcard match at the top)
+    bool owns_file(const std::filesystem::path& p) const { return owns(p); }
+    // Shard reports are ordered by file as `report merge` compares it, so merging them
+    // keeps the order.
+    void order(std::vector<core::InspectResult>& results) const {
+      if (count < 2) return;
+      std::vector<std::pair<std::string, std::size_t>> keys(results.size());
+      for (std::size_t i = 0; i < results.size(); ++i) keys[i] = {core::report_order_key(results[i].file), i};
+      std::sort(keys.begin(), keys.end());
+      std::vector<core::InspectResult> sorted;
+      sorted.reserve(results.size());
+      for (auto& k : keys) sorted.push_back(std::move(results[k.second]));
+      results.swap(sorted);
+    }
+  };
+  template <class Opts>
+  bool parse_shard(const Opts& o, Shard& out) {
+    if (o.shard_by != "path" && o.shard_by != "dir") {
+      fmt::print(stderr, "Unknown --shard-by '{}' (expected path or dir)\n", o.shard_by);
+      return false;
+    }
+    out.by_dir = o.shard_by == "dir";
+    if (o.shard.empty()) return true;
+    unsigned i = 0, n = 0;
+    char extra;
+    if (std::sscanf(o.shard.c_str(), "%u/%u%c", &i, &n, &extra) != 2 || n == 0 || i == 0 || i > n) {
+      fmt::print(stderr, "Bad --shard '{}' (expected i/N with 1 <= i <= N)\n", o.shard);
+      return false;
+    }
+    out.index = i - 1;
+    out.count = n;
+    return true;
+  }
   void expand_pattern_into(const std::filesystem::path& base_dir,
                            const std::string& pattern,
                            bool recursive,
+                           const Shard& shard,
                            std::vector<std::string>& out) {
     namespace fs = std::filesystem;
     auto match = [&](const std::string& name){ return core::glob_match(pattern, name); };
     if (recursive) {
       for (auto it = fs::recursive_directory_iterator(base_dir, fs::directory_options::skip_permission_denied);
            it != fs::recursive_directory_iterator(); ++it) {
+        if (!shard.owns_entry(it->path(), it.depth())) {
+          if (shard.by_dir) it.disable_recursion_pending();
+          continue;
+        }
         if (!it->is_regular_file()) continue;
         auto name = it->path().filename().string();
         if (match(name)) out.push_back(it->path().string());
@@ -31,29 +243,37 @@ namespace {
     } else {
       if (!fs::exists(base_dir)) return;
       for (auto& e : fs::directory_iterator(base_dir, fs::directory_options::skip_permission_denied)) {
-        if (!e.is_regular_file()) continue;
+        if (!shard.owns_entry(e.path(), 0) || !e.is_regular_file()) continue;
         auto name = e.path().filename().string();
         if (match(name)) out.push_back(e.path().string());
       }
     }
   }
-  std::vector<std::string> collect_files(const std::vector<std::string>& targets, bool recursive){
+  std::vector<std::string> collect_files(const std::vector<std::string>& targets, bool recursive,
+                                         const Shard& shard){
     namespace fs = std::filesystem;
     std::vector<std::string> files;
     for (const auto& t : targets) {
       fs::path p(t);
       std::error_code ec;
       if (fs::exists(p, ec)) {
-        if (fs::is_regular_file(p, ec)) { files.push_back(p.string()); continue; }
+        if (fs::is_regular_file(p, ec)) {
+          if (shard.owns_file(p)) files.push_back(p.string());
+          continue;
+        }
         if (fs::is_directory(p, ec)) {
           if (recursive) {
             for (auto it = fs::recursive_directory_iterator(p, fs::directory_options::skip_permission_denied);
                  it != fs::recursive_directory_iterator(); ++it) {
+              if (!shard.owns_entry(it->path(), it.depth())) {
+                if (shard.by_dir) it.disable_recursion_pending();
+                continue;
+              }
               if (it->is_regular_file()) files.push_back(it->path().string());
             }
           } else {
             for (auto& e : fs::directory_iterator(p, fs::directory_options::skip_permission_denied)) {
-              if (e.is_regular_file()) files.push_back(e.path().string());
+              if (shard.owns_entry(e.path(), 0) && e.is_regular_file()) files.push_back(e.path().string());
             }
           }
           continue;
@@ -63,59 +283,514 @@ namespace {
         auto slash = t.find_last_of("/\\");
         fs::path dir = (slash==std::string::npos) ? fs::path(".") : fs::path(t.substr(0, slash));
         std::string pat = (slash==std::string::npos) ? t : t.substr(slash+1);
-        expand_pattern_into(dir, pat, recursive, files);
+        expand_pattern_into(dir, pat, recursive, shard, files);
       }
     }
     return files;
   }
+  // --files-from entries taken per chunk. A chunk is fully processed before the next one
+  // is read, so memory stays flat however long the list is.
+  constexpr std::size_t kListChunk = 4096;
+  // Hands out the files to process: the positional targets first, then the --files-from
+  // list chunk by chunk.
+  struct Targets {
+    const std::vector<std::string>& positional;
+    bool recursive = false;
+    util::PathList list{};
+    bool started = false;
+    Shard shard{};
+
+    template <class Opts>
+    bool open(const Opts& o) {
+      if (!parse_shard(o, shard)) return false;
+      if (o.files_from.empty()) return true;
+      if (list.open(o.files_from, o.null_sep)) return true;
+      fmt::print(stderr, "Cannot read --files-from '{}'\n", o.files_from);
+      return false;
+    }
+    // Next non-empty batch into `files`; false once everything was handed out.
+    bool next(std::vector<std::string>& files) {
+      util::stats::Timer t(util::stats::Phase::Walk);
+      files.clear();
+      if (!started) {
+        started = true;
+        files = collect_files(positional, recursive, shard);
+        if (!files.empty()) return true;
+      }
+      std::vector<std::string> entries;
+      while (list.next(entries, kListChunk)) {
+        files = collect_files(entries, recursive, shard);
+        entries.clear();
+        if (!files.empty()) return true;
+      }
+      return false;
+    }
+  };
+  // A chunk split for --dedup: `first[i]` is the earlier file with the same content as
+  // files[i] (null when it is new), and unique/unique_files list the files to process.
+  // `base` is the chunk's offset in the whole run, which indexes the DedupIndex entries.
+  struct DedupSplit {
+    std::vector<const util::DedupIndex::Entry*> first;
+    std::vector<std::size_t> unique;
+    std::vector<std::string> unique_files;
+  };
+  void split_duplicates(util::DedupIndex* ix, const std::vector<std::string>& files,
+                        std::size_t base, DedupSplit& out) {
+    util::stats::Timer t(util::stats::Phase::Walk);
+    out.first.assign(files.size(), nullptr);
+    out.unique.clear();
+    out.unique_files.clear();
+    for (std::size_t i = 0; i < files.size(); ++i) {
+      if (ix) out.first[i] = ix->find_or_add(files[i], base + i);
+      if (out.first[i]) continue;
+      out.unique.push_back(i);
+      out.unique_files.push_back(files[i]);
+    }
+  }
+  // A duplicate's output is a copy of the first file's (reflinked where supported).
+  bool copy_output(const std::string& from, const std::string& to, const std::string& like) {
+    util::OutputFile out(to, like);
+    return out.ok() && out.copy_from(from) && out.commit();
+  }
+  bool parse_type(const std::string& s, core::FileType& out) {
+    if (s == "auto")  { out = core::FileType::Unknown; return true; }
+    if (s == "image") { out = core::FileType::Image; return true; }
+    if (s == "pdf")   { out = core::FileType::PDF; return true; }
+    if (s == "audio") { out = core::FileType::Audio; return true; }
+    if (s == "zip")   { out = core::FileType::ZIP; return true; }
+    return false;
+  }
+  // Reads `f` to the end; false with `too_big` set once more than `limit` bytes arrive.
+  bool read_all(std::FILE* f, std::string& out, std::uint64_t limit, bool& too_big) {
+    char chunk[64 * 1024];
+    std::size_t n;
+    too_big = false;
+    while ((n = std::fread(chunk, 1, sizeof chunk, f)) > 0) {
+      if (out.size() + n > limit) { too_big = true; std::string().swap(out); return false; }
+      out.append(chunk, n);
+    }
+    return !std::ferror(f);
+  }
+  // `strip -`: stdin to stdout. Every backend edits a complete in-memory image of the
+  // file, so the input is buffered once and the cleaned bytes are written in one go;
+  // nothing touches the disk. Status goes to stderr to keep stdout clean. The input is
+  // capped at --max-memory, or 256 MiB (the PDF reader's limit) without it.
+  int strip_pipe(const core::Policy& policy, const StripOpts& o) {
+    core::FileType forced;
+    if (!parse_type(o.type, forced)) {
+      fmt::print(stderr, "Unknown --type '{}' (expected auto, image, pdf, audio or zip)\n", o.type);
+      return 1;
+    }
+    if (!o.out_dir.empty() && o.out_dir != "-") {
+      fmt::print(stderr, "Reading from stdin writes to stdout; use -o - or leave -o out\n");
+      return 1;
+    }
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    std::uint64_t limit = std::uint64_t{1} << 28;
+    if (!o.max_memory.empty() && !util::parse_memory(o.max_memory, limit)) {
+      fmt::print(stderr, "Bad --max-memory '{}' (e.g. 512M, 4G)\n", o.max_memory);
+      return 1;
+    }
+    if (limit == 0) limit = std::uint64_t{1} << 28;
+    std::string in;
+    bool too_big = false;
+    if (!read_all(stdin, in, limit, too_big)) {
+      if (too_big) fmt::print(stderr, "stdin is larger than {} bytes (raise --max-memory)\n", limit);
+      else fmt::print(stderr, "Failed to read stdin\n");
+      return 1;
+    }
+    auto d = core::detect_buffer("<stdin>", in);
+    d.max_value = 0; // only names and counts are printed
+    if (forced != core::FileType::Unknown) {
+      if (d.type != core::FileType::Unknown && d.type != forced) {
+        fmt::print(stderr, "stdin does not look like --type {}\n", o.type);
+        return 1;
+      }
+      d.type = forced;
+    }
+    if (d.type == core::FileType::Unknown) {
+      fmt::print(stderr, "Unrecognized input on stdin (pass --type)\n");
+      return 1;
+    }
+    const auto before = core::inspect(d);
+    if (o.dry_run) { core::print_plan(before, policy); return 0; }
+    std::string out;
+    const auto after = core::strip_buffer(d, policy, out);
+    if (out.empty()) { fmt::print(stderr, "Could not strip stdin\n"); return 1; }
+    if (std::fwrite(out.data(), 1, out.size(), stdout) != out.size() || std::fflush(stdout) != 0) {
+      fmt::print(stderr, "Failed to write stdout\n");
+      return 1;
+    }
+    fmt::print(stderr, "Stripped <stdin>: before fields: {} | after fields: {}\n",
+               before.fields.size(), after.fields.size());
+    return 0;
+  }
 }
 int run_inspect(const std::vector<std::string>& targets, const InspectOpts& o) {
-  auto files = collect_files(targets, o.recursive);
-  if (files.empty()) { fmt::print("No files matched.\n"); return 1; }
-  std::vector<core::InspectResult> all;
-  all.reserve(files.size());
-  for (auto& f : files) {
-    auto info = core::detect_file(f);
-    auto r = core::inspect(info);
-    all.push_back(std::move(r));
-  }
-  if (o.format == std::string("json")) {
-    core::write_json_report_stream(std::cout, all);
+  if (o.summary && (o.format == "json" || o.format == "stream")) {
+    fmt::print(stderr, "--summary prints its own report; use --report for JSON\n");
+    return 1;
+  }
+  if (o.quick && o.io == "uring") {
+    fmt::print(stderr, "--quick reads two windows per file and does not combine with --io uring\n");
+    return 1;
+  }
+  Dispatch dp;
+  if (!make_dispatch(o, false, dp)) return 1;
+  dp.max_value = value_limit(o, o.format == "json" || !o.report.empty() ||
+                                    (o.verbose > 0 && !o.summary && o.format != "stream"));
+  if (o.stats) util::stats::enable();
+  if (!o.trace.empty()) util::trace::enable();
+  Targets src{targets, o.recursive};
+  if (!src.open(o)) return 1;
+  // --summary and --format stream fold each chunk in as it completes; only the full
+  // table, JSON and --report need every result at the end.
+  std::optional<core::FleetSummary> summary;
+  std::optional<core::TableStream> table;
+  if (o.summary) summary.emplace();
+  else if (o.format == "stream") table.emplace(!o.no_color);
+  const bool keep_all = !(summary || table) || !o.report.empty();
+  std::vector<std::string> files;
+  std::vector<core::InspectResult> all; // every result (keep_all)
+  // --dedup while streaming: the first of each content, without field values, for its
+  // duplicates in later chunks (the dedup index already grows with the run)
+  std::unordered_map<std::size_t, core::InspectResult> briefs;
+  util::DedupIndex dedup;
+  std::size_t total = 0, partial = 0;
+  struct Chunk {
+    std::vector<std::string> files;
+    std::size_t base = 0; // run-wide index of files[0]
+    DedupSplit split;
+    std::vector<core::InspectResult> results;
+    std::size_t batch = 0;
+  };
+  std::deque<Chunk> chunks; // at most two: one finishing while the next one starts
+  Feeder feed(dp);          // after `chunks`: its pool may still run their tasks on unwind
+  // Waits for the oldest chunk and folds its results in, in input order
+  auto finish = [&] {
+    auto& c = chunks.front();
+    feed.wait(c.batch);
+    for (std::size_t i = 0; i < c.files.size(); ++i) {
+      auto& r = c.results[i];
+      if (const auto* first = c.split.first[i]) {
+        if (first->index >= c.base) r = c.results[first->index - c.base];
+        else if (keep_all) r = all[first->index];
+        else r = briefs.at(first->index);
+        r.file = c.files[i];
+        r.duplicate_of = first->path;
+      } else if (o.dedup && !keep_all) {
+        auto& b = briefs[c.base + i];
+        b = r;
+        for (auto& f : b.fields) std::string().swap(f.value);
+      }
+      if (r.confidence == "partial") ++partial;
+      if (summary) summary->add(r);
+      else if (table) table->row(r);
+    }
+    if (keep_all) all.insert(all.end(), std::make_move_iterator(c.results.begin()), std::make_move_iterator(c.results.end()));
+    chunks.pop_front();
+  };
+  while (src.next(files)) {
+    for (std::size_t at = 0; at < files.size(); at += kListChunk) {
+      auto& c = chunks.emplace_back();
+      c.files.assign(files.begin() + static_cast<std::ptrdiff_t>(at),
+                     files.begin() + static_cast<std::ptrdiff_t>(std::min(files.size(), at + kListChunk)));
+      c.base = total;
+      total += c.files.size();
+      c.results.resize(c.files.size());
+      split_duplicates(o.dedup ? &dedup : nullptr, c.files, c.base, c.split);
+      c.batch = feed.submit(c.split.unique_files, "inspect", [&o, &c = c](std::size_t k, const core::Detected& info) {
+        c.results[c.split.unique[k]] = o.quick ? core::quick_inspect(info) : core::inspect(info);
+      });
+      if (chunks.size() > 1) finish();
+    }
+  }
+  while (!chunks.empty()) finish();
+  if (total == 0) { fmt::print("No files matched.\n"); return 1; }
+  src.shard.order(all);
+  util::stats::Totals totals;
+  if (o.stats) totals = util::stats::snapshot();
+  const util::stats::Totals* st = o.stats ? &totals : nullptr;
+  if (summary) {
+    summary->print(!o.no_color);
+  } else if (table) {
+    table->finish();
+  } else if (o.format == std::string("json")) {
+    core::write_json_report_stream(std::cout, all, st);
     std::cout << std::endl;
   } else {
     core::print_inspection_batch(all, o.verbose, !o.no_color);
   }
   if (!o.report.empty()) {
-    core::write_json_report(all, o.report);
+    core::write_json_report(all, o.report, st);
     fmt::print("Wrote report: {}\n", o.report);
   }
+  if (partial) {
+    fmt::print(stderr, "Quick scan: {} of {} file(s) only partly read; inspect them without --quick for a full answer\n",
+               partial, total);
+  }
+  if (st) core::print_stats(*st);
+  write_trace(o.trace);
   return 0;
 }
 
 
 int run_strip(const vector<string>& targets, const core::Policy& policy, const StripOpts& o) {
-  auto files = collect_files(targets, o.recursive);
-  if (files.empty()) { fmt::print("No files matched.\n"); return 1; }
+  if (std::find(targets.begin(), targets.end(), "-") != targets.end()) {
+    if (targets.size() != 1 || !o.files_from.empty() || o.in_place) {
+      fmt::print(stderr, "'-' (stdin) must be the only target and cannot be combined with --files-from or --in-place\n");
+      return 1;
+    }
+    return strip_pipe(policy, o);
+  }
+  Dispatch dp;
+  if (!make_dispatch(o, true, dp)) return 1;
+  dp.max_value = value_limit(o, o.format == "json" || !o.report.empty());
+  util::DurabilityOpts dur;
+  if (!util::parse_durability(o.durability, dur.mode)) {
+    fmt::print(stderr, "Unknown --durability '{}' (expected none, file or batch)\n", o.durability);
+    return 1;
+  }
+  dur.batch_files = o.batch_files;
+  dur.batch_ms = o.batch_ms;
+  util::set_durability(dur);
+  if (o.stats) util::stats::enable();
+  if (!o.trace.empty()) util::trace::enable();
+  if (o.resume && o.journal.empty()) {
+    fmt::print(stderr, "--resume needs --journal FILE\n");
+    return 1;
+  }
+  util::Journal journal;
+  if (!o.journal.empty() && !o.dry_run) {
+    if (!journal.open(o.journal, o.resume)) {
+      fmt::print(stderr, "Cannot open journal {}\n", o.journal);
+      return 1;
+    }
+    if (o.resume) fmt::print(stderr, "Resuming: {} file(s) already done in {}\n", journal.loaded(), o.journal);
+  }
+  Targets src{targets, o.recursive};
+  if (!src.open(o)) return 1;
+  if (o.in_place && !o.yes && o.files_from == "-") {
+    fmt::print(stderr, "--in-place with --files-from - needs --yes (stdin carries the file list)\n");
+    return 1;
+  }
+  std::vector<std::string> files;
+  if (!src.next(files)) { fmt::print("No files matched.\n"); return 1; }
   if (o.in_place && !o.yes) {
-    fmt::print("About to overwrite {} file(s) in-place. Type 'yes' to continue: ", files.size());
+    if (o.files_from.empty()) fmt::print("About to overwrite {} file(s) in-place. Type 'yes' to continue: ", files.size());
+    else fmt::print("About to overwrite the files listed in {} in-place. Type 'yes' to continue: ", o.files_from);
     std::string line; std::getline(std::cin, line);
     if (!(line == "yes" || line == "y")) {
       fmt::print("Aborted.\n");
       return 1;
     }
   }
-  for (auto& f : files) {
-    auto out = util::derive_output_path(f, o.out_dir, o.in_place);
-    auto d_before = core::detect_file(f);
-    auto r_before = core::inspect(d_before);
-    if (o.dry_run) {
-      core::print_plan(r_before, policy);
-      continue;
+  // Results are printed in input order as soon as every earlier file is done.
+  struct Row {
+    core::InspectResult before, after;
+    std::string out;
+    const util::DedupIndex::Entry* first = nullptr; // --dedup: output copied from this file's
+    bool unchanged = false; // the plan drops nothing: no rewrite
+    bool done = false;
+  };
+  enum : std::uint8_t { kNoOutput, kWritten, kUnchanged };
+  const bool json = o.format == "json";
+  const bool keep_results = json || !o.report.empty();
+  std::vector<core::InspectResult> results; // --report / --format json
+  std::mutex print_mu;
+  util::DedupIndex dedup;
+  std::vector<std::uint8_t> state; // per file of the run, what its output is (--dedup only)
+  std::size_t base = 0;
+  std::uint64_t skipped = 0; // --resume: finished by an earlier run
+  std::vector<std::string> lost; // --durability batch: committed outputs whose rename failed
+  auto note_lost = [&](std::vector<std::string> failed) {
+    lost.insert(lost.end(), std::make_move_iterator(failed.begin()), std::make_move_iterator(failed.end()));
+  };
+  // Journal checkpoints flush and fsync, so they run on this thread between files rather
+  // than on a worker holding print_mu.
+  auto checkpoint_due = [&] {
+    if (journal.is_open() && journal.due()) note_lost(journal.checkpoint());
+  };
+  // Leaves a file the plan does not touch as it is: nothing to do in place, otherwise a
+  // hard link (or a copy across filesystems) at `out`.
+  auto keep_unchanged = [&](Row& row, const std::string& in) {
+    if (!o.dry_run && row.out != in && !util::link_output(in, row.out) && !copy_output(in, row.out, in)) {
+      return false;
+    }
+    row.unchanged = true;
+    row.after = row.before;
+    if (!o.dry_run) row.after.file = row.out;
+    return true;
+  };
+  // A chunk of the run. Its rows print once every row of the chunk before it printed
+  // (`open`), so output keeps input order while the two chunks overlap.
+  struct Chunk {
+    std::vector<std::string> files;
+    std::size_t base = 0; // run-wide index of files[0]
+    DedupSplit split;
+    std::vector<Row> rows;
+    std::size_t printed = 0;
+    bool open = false;
+    std::size_t batch = 0;
+  };
+  std::deque<Chunk> chunks; // at most two: one finishing while the next one starts
+  Feeder feed(dp);          // after `chunks`: its pool may still run their tasks on unwind
+  // Called with print_mu held
+  auto print_ready = [&](Chunk& c) {
+    if (!c.open) return;
+    for (; c.printed < c.rows.size() && c.rows[c.printed].done; ++c.printed) {
+      auto& r = c.rows[c.printed];
+      const auto& file = c.files[c.printed];
+      if (journal.is_open()) {
+        // provisional: checkpoint() turns it into Failed if the output's rename fails
+        using Outcome = util::Journal::Outcome;
+        journal.add(file, r.out, r.first ? Outcome::Duplicate
+                               : r.unchanged ? Outcome::Unchanged
+                               : r.after.file == r.out ? Outcome::Stripped : Outcome::Failed);
+      }
+      if (keep_results) {
+        core::InspectResult e;
+        if (r.first) {
+          e.file = o.dry_run ? file : r.out;
+          e.duplicate_of = r.first->path;
+          e.status = "duplicate";
+        } else {
+          e = std::move(o.dry_run ? r.before : r.after);
+          e.status = r.unchanged ? "unchanged" : o.dry_run ? "planned" : "stripped";
+        }
+        results.push_back(std::move(e));
+      }
+      if (json) {
+        // the whole run goes out as one JSON document at the end
+      } else if (r.first) {
+        core::print_duplicate(file, r.first->path, r.out);
+      } else if (o.dry_run) {
+        util::stats::Timer t(util::stats::Phase::Policy, file);
+        core::print_plan(r.before, policy);
+      } else if (r.unchanged) {
+        core::print_unchanged(r.before, r.out);
+      } else {
+        core::print_summary(r.before, r.after, r.out);
+      }
+      r = Row{};
+      r.done = true;
     }
-    auto r_after  = core::strip_to(f, out, policy);
-    core::print_summary(r_before, r_after, out);
+  };
+  // Waits for the oldest chunk, adds its duplicates and lets the next chunk print
+  auto finish = [&] {
+    auto& c = chunks.front();
+    feed.wait(c.batch, checkpoint_due);
+    // Duplicates go last, once the outputs they copy are in place.
+    bool flushed = false;
+    for (std::size_t i = 0; i < c.files.size(); ++i) {
+      const auto* first = c.split.first[i];
+      if (!first) continue;
+      auto& row = c.rows[i];
+      row.first = first;
+      if (!o.dry_run) {
+        if (!flushed) { note_lost(util::flush_outputs()); flushed = true; }
+        row.out = util::derive_output_path(c.files[i], o.out_dir, o.in_place);
+        const auto from = util::derive_output_path(first->path, o.out_dir, o.in_place);
+        std::uint8_t st;
+        {
+          std::lock_guard<std::mutex> lk(print_mu); // the next chunk's workers grow `state`
+          st = state[first->index];
+        }
+        const bool ok = st == kWritten   ? !util::output_lost(from) && copy_output(from, row.out, c.files[i])
+                      : st == kUnchanged ? row.out == c.files[i] || util::link_output(c.files[i], row.out) ||
+                                           copy_output(c.files[i], row.out, c.files[i])
+                                         : false;
+        if (!ok) {
+          // nothing to copy (the first file could not be stripped): handle it on its own
+          row.first = nullptr;
+          auto d = core::detect_file(c.files[i]);
+          d.max_value = dp.max_value;
+          row.before = core::inspect(d);
+          row.after = core::strip_to(d, row.out, policy);
+        }
+      }
+      {
+        std::lock_guard<std::mutex> lk(print_mu);
+        row.done = true;
+        print_ready(c);
+      }
+      checkpoint_due();
+    }
+    std::lock_guard<std::mutex> lk(print_mu);
+    chunks.pop_front();
+    if (!chunks.empty()) {
+      chunks.front().open = true;
+      print_ready(chunks.front());
+    }
+  };
+  do {
+    if (journal.loaded()) {
+      const auto n = files.size();
+      std::erase_if(files, [&](const std::string& f) { return journal.done(f); });
+      skipped += n - files.size();
+    }
+    auto& c = chunks.emplace_back();
+    c.files = std::move(files);
+    c.base = base;
+    c.rows.assign(c.files.size(), Row{});
+    split_duplicates(o.dedup ? &dedup : nullptr, c.files, c.base, c.split);
+    {
+      std::lock_guard<std::mutex> lk(print_mu); // the previous chunk's workers write `state`
+      if (o.dedup) state.resize(base + c.files.size());
+      c.open = chunks.size() == 1;
+    }
+    c.batch = feed.submit(c.split.unique_files, "strip", [&, &c = c](std::size_t k, const core::Detected& d_before) {
+      const auto i = c.split.unique[k];
+      auto& row = c.rows[i];
+      row.before = core::inspect(d_before);
+      if (!o.dry_run) row.out = util::derive_output_path(c.files[i], o.out_dir, o.in_place);
+      // plan first: files the policy leaves alone are not rewritten
+      const bool noop = core::can_strip(d_before) && !core::plan_drops(row.before, policy);
+      if (!(noop && keep_unchanged(row, c.files[i])) && !o.dry_run) {
+        row.after = core::strip_to(d_before, row.out, policy);
+      }
+      std::lock_guard<std::mutex> lk(print_mu);
+      if (o.dedup) {
+        state[c.base + i] = row.unchanged ? kUnchanged
+                          : !o.dry_run && row.after.file == row.out ? kWritten : kNoOutput;
+      }
+      row.done = true;
+      print_ready(c);
+    });
+    base += c.files.size();
+    if (chunks.size() > 1) finish();
+  } while (src.next(files));
+  while (!chunks.empty()) finish();
+  note_lost(util::flush_outputs());
+  note_lost(journal.checkpoint());
+  if (!lost.empty()) {
+    // printed as stripped while their rename was still queued; say so now
+    std::sort(lost.begin(), lost.end());
+    for (auto& e : results) {
+      if (std::binary_search(lost.begin(), lost.end(), e.file)) e.status = "failed";
+    }
+    fmt::print(stderr, "Failed to publish {} output(s); their batch rename did not happen:\n", lost.size());
+    for (auto& f : lost) fmt::print(stderr, "  {}\n", f);
   }
-  return 0;
+  if (skipped) fmt::print(json ? stderr : stdout, "Skipped {} file(s) already done in {}\n", skipped, o.journal);
+  src.shard.order(results);
+  util::stats::Totals totals;
+  if (o.stats) totals = util::stats::snapshot();
+  const util::stats::Totals* st = o.stats ? &totals : nullptr;
+  if (json) {
+    core::write_json_report_stream(std::cout, results, st);
+    std::cout << std::endl;
+  }
+  if (!o.report.empty()) {
+    core::write_json_report(results, o.report, st);
+    fmt::print(json ? stderr : stdout, "Wrote report: {}\n", o.report);
+  }
+  if (st) core::print_stats(*st);
+  write_trace(o.trace);
+  return lost.empty() ? 0 : 1;
 }
 
 int run_explain(const string& target, const ExplainOpts& o) {
@@ -125,6 +800,25 @@ int run_explain(const string& target, const ExplainOpts& o) {
   return 0;
 }
 
+int run_report_merge(const vector<string>& inputs, const MergeOpts& o) {
+  if (o.format != "json" && o.format != "ndjson") {
+    fmt::print(stderr, "Unknown --format '{}' (expected json or ndjson)\n", o.format);
+    return 1;
+  }
+  std::ofstream file;
+  if (!o.out.empty() && o.out != "-") {
+    file.open(o.out, std::ios::binary | std::ios::trunc);
+    if (!file) { fmt::print(stderr, "Cannot write {}\n", o.out); return 1; }
+  }
+  std::string err;
+  if (!core::merge_reports(inputs, file.is_open() ? file : std::cout, o.format == "ndjson", err)) {
+    fmt::print(stderr, "report merge: {}\n", err);
+    return 1;
+  }
+  if (file.is_open()) fmt::print(stderr, "Wrote report: {}\n", o.out);
+  return 0;
+}
+
 int run_policy(const string& action, const string& file) {
   (void)action; (void)file;
   fmt::print("Built-in policies: aggressive (default), safe. Use --safe or --keep/--drop.\n");
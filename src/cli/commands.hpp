@@ -11,6 +11,20 @@ struct InspectOpts {
   std::string report;
   int verbose = 0;
   bool no_color = false;
+  bool stats = false;
+  std::string trace;
+  std::string io = "sync";
+  unsigned io_depth = 32;
+  unsigned jobs = 1;      // 0 = one per core
+  std::string max_memory; // empty = unlimited
+  std::string files_from; // target list file, "-" = stdin
+  bool null_sep = false;  // files_from entries are NUL-separated
+  bool dedup = false;     // inspect each distinct content once
+  bool summary = false;   // aggregates and top files instead of one row per file
+  std::size_t max_value_bytes = 0; // cut field values to this many bytes, 0 = whole
+  std::string shard;      // "i/N": only the targets of shard i
+  std::string shard_by = "path"; // path|dir
+  bool quick = false;     // read only the head and tail windows (core/quick.hpp)
 };
 
 struct StripOpts {
@@ -23,6 +37,37 @@ struct StripOpts {
   bool dry_run = false;
   int verbose = 0;
   bool no_color = false;
+  bool stats = false;
+  std::string trace;
+  std::string io = "sync";
+  unsigned io_depth = 32;
+  unsigned jobs = 1;      // 0 = one per core
+  std::string max_memory; // empty = unlimited
+  std::string files_from; // target list file, "-" = stdin
+  bool null_sep = false;  // files_from entries are NUL-separated
+  std::string type = "auto"; // input type for `strip -` (stdin); auto = sniff
+  bool dedup = false;     // strip each distinct content once, copy the rest
+  std::string durability = "file";
+  unsigned batch_files = 256;
+  unsigned batch_ms = 1000;
+  std::string journal;    // --journal: record finished files here
+  bool resume = false;    // skip files the journal already records
+  std::size_t max_value_bytes = 0; // cut field values to this many bytes, 0 = whole
+  std::string shard;      // "i/N": only the targets of shard i
+  std::string shard_by = "path"; // path|dir
+};
+
+struct MergeOpts {
+  std::string out;        // empty = stdout
+  std::string format = "json"; // json|ndjson
+};
+
+struct ServeOpts {
+  std::string socket;     // Unix domain socket path
+  unsigned jobs = 0;      // 0 = one per core
+  std::string out_dir;    // used when a strip request has no "out"; confines one that has
+  bool any_out = false;   // let a request's "out" name any path
+  std::string durability = "file";
 };
 
 struct ExplainOpts {
@@ -32,6 +77,8 @@ struct ExplainOpts {
 
 int run_inspect(const std::vector<std::string>& targets, const InspectOpts&);
 int run_strip(const std::vector<std::string>& targets, const core::Policy&, const StripOpts&);
+int run_serve(const core::Policy&, const ServeOpts&);
+int run_report_merge(const std::vector<std::string>& inputs, const MergeOpts&);
 int run_explain(const std::string& target, const ExplainOpts&);
 int run_policy(const std::string& action, const std::string& file);
 
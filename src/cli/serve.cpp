@@ -0,0 +1,580 @@
+#include "commands.hpp"
+#include <fmt/format.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "core/detect.hpp"
+#include "core/report.hpp"
+#include "core/sanitize.hpp"
+#include "util/commit.hpp"
+#include "util/fs.hpp"
+#include "util/stats.hpp"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace cmd {
+
+#ifndef _WIN32
+namespace {
+
+// ---- request parsing ----
+// One flat JSON object per line: string values, arrays of strings, and an "id" of any
+// scalar type that is echoed back verbatim so clients can match pipelined replies.
+struct Request {
+  std::string id = "null"; // raw JSON token
+  std::string op, path, out, policy;
+  std::vector<std::string> keep, drop;
+};
+
+class LineParser {
+public:
+  explicit LineParser(std::string_view s) : s_(s) {}
+
+  bool parse(Request& r, std::string& err) {
+    ws();
+    if (!eat('{')) return fail(err, "expected '{'");
+    ws();
+    if (eat('}')) return true;
+    for (;;) {
+      std::string key;
+      ws();
+      if (!string(key)) return fail(err, "expected a key");
+      ws();
+      if (!eat(':')) return fail(err, "expected ':'");
+      ws();
+      if (!value(key, r)) return fail(err, "bad value for \"" + key + "\"");
+      ws();
+      if (eat(',')) continue;
+      if (eat('}')) break;
+      return fail(err, "expected ',' or '}'");
+    }
+    ws();
+    if (i_ != s_.size()) return fail(err, "trailing data");
+    return true;
+  }
+
+private:
+  bool fail(std::string& err, std::string msg) { err = std::move(msg); return false; }
+  void ws() { while (i_ < s_.size() && (s_[i_] == ' ' || s_[i_] == '\t' || s_[i_] == '\r')) ++i_; }
+  bool eat(char c) { if (i_ < s_.size() && s_[i_] == c) { ++i_; return true; } return false; }
+
+  static void put_utf8(std::string& o, unsigned cp) {
+    if (cp < 0x80) o += static_cast<char>(cp);
+    else if (cp < 0x800) { o += static_cast<char>(0xC0 | (cp >> 6)); o += static_cast<char>(0x80 | (cp & 0x3F)); }
+    else if (cp < 0x10000) {
+      o += static_cast<char>(0xE0 | (cp >> 12));
+      o += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      o += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      o += static_cast<char>(0xF0 | (cp >> 18));
+      o += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      o += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      o += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+  bool hex4(unsigned& v) {
+    if (i_ + 4 > s_.size()) return false;
+    v = 0;
+    for (int k = 0; k < 4; ++k) {
+      const char c = s_[i_++];
+      v <<= 4;
+      if (c >= '0' && c <= '9') v |= unsigned(c - '0');
+      else if (c >= 'a' && c <= 'f') v |= unsigned(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F') v |= unsigned(c - 'A' + 10);
+      else return false;
+    }
+    return true;
+  }
+  bool string(std::string& out) {
+    if (!eat('"')) return false;
+    while (i_ < s_.size()) {
+      const char c = s_[i_++];
+      if (c == '"') return true;
+      if (c != '\\') { out += c; continue; }
+      if (i_ >= s_.size()) return false;
+      switch (s_[i_++]) {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+          unsigned cp = 0;
+          if (!hex4(cp)) return false;
+          if (cp >= 0xD800 && cp < 0xDC00 && s_.substr(i_, 2) == "\\u") {
+            i_ += 2;
+            unsigned lo = 0;
+            if (!hex4(lo) || lo < 0xDC00 || lo >= 0xE000) return false;
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+          }
+          put_utf8(out, cp);
+          break;
+        }
+        default: return false;
+      }
+    }
+    return false;
+  }
+  bool scalar(std::string& raw) {
+    if (i_ < s_.size() && s_[i_] == '"') {
+      const auto start = i_;
+      std::string ignored;
+      if (!string(ignored)) return false;
+      raw.assign(s_.substr(start, i_ - start));
+      return true;
+    }
+    const auto start = i_;
+    while (i_ < s_.size() && s_[i_] != ',' && s_[i_] != '}' && s_[i_] != ' ' && s_[i_] != '\t' && s_[i_] != '\r') ++i_;
+    // echoed into the reply as is, so it has to be a JSON literal
+    const auto tok = s_.substr(start, i_ - start);
+    if (tok != "true" && tok != "false" && tok != "null" && !number(tok)) return false;
+    raw.assign(tok);
+    return true;
+  }
+  // JSON number grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+  static bool number(std::string_view t) {
+    std::size_t k = 0;
+    auto digits = [&] { const auto s = k; while (k < t.size() && t[k] >= '0' && t[k] <= '9') ++k; return k > s; };
+    if (k < t.size() && t[k] == '-') ++k;
+    if (k < t.size() && t[k] == '0') ++k;
+    else if (!digits()) return false;
+    if (k < t.size() && t[k] == '.') { ++k; if (!digits()) return false; }
+    if (k < t.size() && (t[k] == 'e' || t[k] == 'E')) {
+      ++k;
+      if (k < t.size() && (t[k] == '+' || t[k] == '-')) ++k;
+      if (!digits()) return false;
+    }
+    return k == t.size();
+  }
+  bool array(std::vector<std::string>& out) {
+    if (!eat('[')) return false;
+    ws();
+    if (eat(']')) return true;
+    for (;;) {
+      ws();
+      std::string v;
+      if (!string(v)) return false;
+      out.push_back(std::move(v));
+      ws();
+      if (eat(',')) continue;
+      return eat(']');
+    }
+  }
+  bool value(const std::string& key, Request& r) {
+    if (key == "id") return scalar(r.id);
+    if (key == "keep") return array(r.keep);
+    if (key == "drop") return array(r.drop);
+    std::string* dst = key == "op" ? &r.op : key == "path" ? &r.path : key == "out" ? &r.out
+                     : key == "policy" ? &r.policy : nullptr;
+    if (dst) return string(*dst);
+    std::string raw; // unknown keys are skipped, so clients can send extra fields
+    if (i_ < s_.size() && s_[i_] == '[') { std::vector<std::string> v; return array(v); }
+    return scalar(raw);
+  }
+
+  std::string_view s_;
+  std::size_t i_ = 0;
+};
+
+// ---- counters ----
+// Latency histogram with four linear sub-buckets per power of two, so percentiles
+// are within ~19% of the true value (util::stats' log2 buckets are for phases).
+class Latency {
+public:
+  void record(std::uint64_t ns, bool ok) {
+    std::lock_guard<std::mutex> lk(mu_);
+    ++count_;
+    if (!ok) ++errors_;
+    max_ = std::max(max_, ns);
+    ++hist_[bucket(ns)];
+  }
+  std::string json() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return fmt::format("{{\"count\":{},\"errors\":{},\"p50_us\":{},\"p90_us\":{},\"p99_us\":{},\"max_us\":{}}}",
+                       count_, errors_, pct(0.5) / 1000, pct(0.9) / 1000, pct(0.99) / 1000, max_ / 1000);
+  }
+
+private:
+  static constexpr int kSub = 4;
+  static constexpr int kBuckets = 64 * kSub;
+  static int bucket(std::uint64_t ns) {
+    if (ns < kSub) return static_cast<int>(ns);
+    const int msb = static_cast<int>(std::bit_width(ns)) - 1;
+    const int sub = static_cast<int>((ns >> (msb - 2)) & (kSub - 1));
+    return msb * kSub + sub;
+  }
+  static std::uint64_t upper_edge(int b) {
+    if (b < kSub) return static_cast<std::uint64_t>(b);
+    const int msb = b / kSub, sub = b % kSub;
+    return ((std::uint64_t{kSub} + sub + 1) << (msb - 2)) - 1;
+  }
+  std::uint64_t pct(double q) const {
+    if (!count_) return 0;
+    const auto want = static_cast<std::uint64_t>(q * static_cast<double>(count_));
+    std::uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+      seen += hist_[b];
+      if (seen > want) return std::min(max_, upper_edge(b));
+    }
+    return max_;
+  }
+
+  mutable std::mutex mu_;
+  std::uint64_t count_ = 0, errors_ = 0, max_ = 0;
+  std::array<std::uint64_t, kBuckets> hist_{};
+};
+
+// ---- connections and work queue ----
+struct Conn {
+  explicit Conn(int f) : fd(f) {}
+  ~Conn() { ::close(fd); }
+  void send_line(std::string line) {
+    line += '\n';
+    std::lock_guard<std::mutex> lk(write_mu);
+    const char* p = line.data();
+    std::size_t n = line.size();
+    while (n) {
+      const auto w = ::send(fd, p, n, MSG_NOSIGNAL);
+      if (w < 0) { if (errno == EINTR) continue; return; } // peer went away
+      p += w;
+      n -= static_cast<std::size_t>(w);
+    }
+  }
+  int fd;
+  std::mutex write_mu;
+};
+
+struct Job {
+  std::shared_ptr<Conn> conn;
+  Request req;
+  std::uint64_t t0 = 0;
+};
+
+class JobQueue {
+public:
+  explicit JobQueue(std::size_t cap) : cap_(cap) {}
+  // Blocks while the queue is full, so a flooding client is slowed at its socket.
+  void push(Job j) {
+    std::unique_lock<std::mutex> lk(mu_);
+    not_full_.wait(lk, [&] { return q_.size() < cap_ || closed_; });
+    q_.push_back(std::move(j));
+    not_empty_.notify_one();
+  }
+  bool pop(Job& out) {
+    std::unique_lock<std::mutex> lk(mu_);
+    not_empty_.wait(lk, [&] { return !q_.empty() || closed_; });
+    if (q_.empty()) return false;
+    out = std::move(q_.front());
+    q_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+  void close() {
+    std::lock_guard<std::mutex> lk(mu_);
+    closed_ = true;
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+  std::size_t size() const { std::lock_guard<std::mutex> lk(mu_); return q_.size(); }
+
+private:
+  mutable std::mutex mu_;
+  std::condition_variable not_empty_, not_full_;
+  std::deque<Job> q_;
+  std::size_t cap_;
+  bool closed_ = false;
+};
+
+std::atomic<bool> g_stop{false};
+void on_stop_signal(int) { g_stop.store(true); }
+
+class Server {
+public:
+  Server(const ServeOpts& o, const core::Policy& base)
+    : o_(o), base_(std::make_shared<const core::Policy>(base)),
+      queue_(std::size_t{std::max(1u, o.jobs)} * 64), t_start_(util::stats::now_ns()) {}
+
+  int run() {
+    listen_fd_ = open_socket();
+    if (listen_fd_ < 0) return 1;
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::max(1u, o_.jobs); ++t) workers.emplace_back([this] { work(); });
+    fmt::print(stderr, "Listening on {} ({} workers)\n", o_.socket, std::max(1u, o_.jobs));
+
+    while (!g_stop.load()) {
+      pollfd p{listen_fd_, POLLIN, 0};
+      if (::poll(&p, 1, 200) <= 0) continue;
+      const int fd = ::accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) continue;
+      auto conn = std::make_shared<Conn>(fd);
+      {
+        std::lock_guard<std::mutex> lk(conns_mu_);
+        conns_.push_back(conn);
+        ++readers_;
+      }
+      ++connections_;
+      std::thread([this, conn] { read_loop(conn); }).detach();
+    }
+
+    // stop reading, let queued work finish, then shut the workers down
+    ::close(listen_fd_);
+    std::error_code ec;
+    std::filesystem::remove(o_.socket, ec);
+    {
+      std::unique_lock<std::mutex> lk(conns_mu_);
+      for (auto& w : conns_) if (auto c = w.lock()) ::shutdown(c->fd, SHUT_RD);
+      readers_done_.wait(lk, [&] { return readers_ == 0; });
+    }
+    queue_.close();
+    for (auto& th : workers) th.join();
+    util::flush_outputs();
+    fmt::print(stderr, "Stopped.\n");
+    return 0;
+  }
+
+private:
+  int open_socket() {
+    sockaddr_un addr{};
+    if (o_.socket.size() >= sizeof(addr.sun_path)) {
+      fmt::print(stderr, "Socket path too long: {}\n", o_.socket);
+      return -1;
+    }
+    // replace a stale socket from an earlier run, but never a regular file
+    struct stat st{};
+    if (::lstat(o_.socket.c_str(), &st) == 0) {
+      if (!S_ISSOCK(st.st_mode)) {
+        fmt::print(stderr, "Refusing to replace {}: not a socket\n", o_.socket);
+        return -1;
+      }
+      ::unlink(o_.socket.c_str());
+    }
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) { fmt::print(stderr, "socket: {}\n", std::strerror(errno)); return -1; }
+    addr.sun_family = AF_UNIX;
+    std::copy(o_.socket.begin(), o_.socket.end(), addr.sun_path);
+    // owner-only socket: anyone who can connect can read and write files as this user
+    const mode_t old_mask = ::umask(0077);
+    const int bound = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::umask(old_mask);
+    if (bound != 0 || ::listen(fd, 128) != 0) {
+      fmt::print(stderr, "Cannot listen on {}: {}\n", o_.socket, std::strerror(errno));
+      ::close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  void read_loop(const std::shared_ptr<Conn>& conn) {
+    constexpr std::size_t kMaxLine = std::size_t{1} << 20;
+    std::string buf;
+    char chunk[16384];
+    for (;;) {
+      const auto n = ::recv(conn->fd, chunk, sizeof(chunk), 0);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      buf.append(chunk, static_cast<std::size_t>(n));
+      std::size_t start = 0;
+      for (auto nl = buf.find('\n'); nl != std::string::npos; nl = buf.find('\n', start)) {
+        handle_line(conn, std::string_view(buf).substr(start, nl - start));
+        start = nl + 1;
+      }
+      buf.erase(0, start);
+      if (buf.size() > kMaxLine) {
+        conn->send_line(R"({"id":null,"ok":false,"error":"request line too long"})");
+        break;
+      }
+    }
+    std::lock_guard<std::mutex> lk(conns_mu_);
+    conns_.erase(std::remove_if(conns_.begin(), conns_.end(),
+                                [&](const std::weak_ptr<Conn>& w) { auto c = w.lock(); return !c || c == conn; }),
+                 conns_.end());
+    if (--readers_ == 0) readers_done_.notify_all();
+  }
+
+  void handle_line(const std::shared_ptr<Conn>& conn, std::string_view line) {
+    if (line.find_first_not_of(" \t\r") == std::string_view::npos) return;
+    Job j;
+    j.conn = conn;
+    j.t0 = util::stats::now_ns();
+    std::string err;
+    if (!LineParser(line).parse(j.req, err)) {
+      conn->send_line(error_reply(j.req.id, "bad request: " + err));
+      return;
+    }
+    // cheap control requests are answered on the reader thread
+    if (j.req.op == "ping") { conn->send_line(fmt::format(R"({{"id":{},"ok":true}})", j.req.id)); return; }
+    if (j.req.op == "stats") { conn->send_line(stats_reply(j.req.id)); return; }
+    if (j.req.op != "inspect" && j.req.op != "strip") {
+      conn->send_line(error_reply(j.req.id, "unknown op '" + j.req.op + "' (inspect, strip, stats, ping)"));
+      return;
+    }
+    queue_.push(std::move(j));
+  }
+
+  void work() {
+    Job j;
+    while (queue_.pop(j)) {
+      ++in_flight_;
+      bool ok = false;
+      std::string reply = execute(j.req, ok);
+      // count before replying, so a client's next "stats" already includes this request
+      (j.req.op == "strip" ? strip_lat_ : inspect_lat_).record(util::stats::now_ns() - j.t0, ok);
+      --in_flight_;
+      j.conn->send_line(std::move(reply));
+      j = Job{};
+    }
+  }
+
+  std::string execute(const Request& r, bool& ok) {
+    std::error_code ec;
+    if (r.path.empty() || !std::filesystem::is_regular_file(r.path, ec)) {
+      return error_reply(r.id, "not a regular file: " + r.path);
+    }
+    auto d = core::detect_file(r.path);
+    auto before = core::inspect(d);
+    if (r.op == "inspect") {
+      ok = true;
+      return fmt::format(R"({{"id":{},"ok":true,"result":{}}})", r.id, core::to_json(before));
+    }
+    std::string out;
+    if (r.out.empty()) {
+      if (o_.out_dir.empty()) return error_reply(r.id, "strip needs \"out\" (or start the server with --out-dir)");
+      out = util::derive_output_path(r.path, o_.out_dir, false);
+    } else if (!output_allowed(r.out, out)) {
+      return error_reply(r.id, o_.out_dir.empty() ? "\"out\" needs a server started with --out-dir (or --allow-any-out)"
+                                                  : "\"out\" is outside --out-dir: " + r.out);
+    }
+    const auto pol = policy_for(r);
+    if (!pol) return error_reply(r.id, "unknown policy '" + r.policy + "' (default, safe, aggressive)");
+    auto after = core::strip_to(d, out, *pol);
+    // strip_to hands back the input's result when it wrote nothing
+    if (after.file != out) return error_reply(r.id, "no output written to " + out);
+    ok = true;
+    return fmt::format(R"({{"id":{},"ok":true,"out":"{}","before":{},"after":{}}})", r.id,
+                       core::json_escape(out), core::to_json(before), core::to_json(after));
+  }
+
+  // A request's "out" must stay under --out-dir (relative paths are taken from there),
+  // unless the server runs with --allow-any-out. Symlinks in the existing part of the
+  // path are resolved before the check.
+  bool output_allowed(const std::string& req_out, std::string& out) const {
+    namespace fs = std::filesystem;
+    if (o_.any_out) { out = req_out; return true; }
+    if (o_.out_dir.empty()) return false;
+    std::error_code ec;
+    const fs::path dir = fs::weakly_canonical(o_.out_dir, ec);
+    if (ec) return false;
+    fs::path p(req_out);
+    if (p.is_relative()) p = dir / p;
+    const fs::path parent = fs::weakly_canonical(p.parent_path(), ec);
+    if (ec || !p.has_filename() || p.filename() == "." || p.filename() == "..") return false;
+    const auto rel = parent.lexically_relative(dir);
+    if (rel.empty() || *rel.begin() == "..") return false;
+    out = (parent / p.filename()).string();
+    return true;
+  }
+
+  // Policies are built once per distinct (policy, keep, drop) and shared by all workers.
+  std::shared_ptr<const core::Policy> policy_for(const Request& r) {
+    if ((r.policy.empty() || r.policy == "default") && r.keep.empty() && r.drop.empty()) return base_;
+    if (!r.policy.empty() && r.policy != "default" && r.policy != "safe" && r.policy != "aggressive") return nullptr;
+    std::string key = r.policy;
+    for (auto& k : r.keep) { key += '\x1f'; key += k; }
+    key += '\x1e';
+    for (auto& d : r.drop) { key += '\x1f'; key += d; }
+    std::lock_guard<std::mutex> lk(policy_mu_);
+    if (auto it = policies_.find(key); it != policies_.end()) return it->second;
+    core::Policy p = r.policy == "safe" ? core::load_policy(true, "", {}, {})
+                   : r.policy == "aggressive" ? core::load_policy(false, "", {}, {}) : *base_;
+    p.keep.insert(p.keep.end(), r.keep.begin(), r.keep.end());
+    p.drop.insert(p.drop.end(), r.drop.begin(), r.drop.end());
+    if (policies_.size() >= 1024) policies_.clear(); // bound the cache; holders keep their copy alive
+    auto sp = std::make_shared<const core::Policy>(std::move(p));
+    policies_.emplace(std::move(key), sp);
+    return sp;
+  }
+
+  static std::string error_reply(const std::string& id, const std::string& msg) {
+    return fmt::format(R"({{"id":{},"ok":false,"error":"{}"}})", id, core::json_escape(msg));
+  }
+
+  std::string stats_reply(const std::string& id) const {
+    return fmt::format(R"({{"id":{},"ok":true,"stats":{{"uptime_ms":{},"connections":{},"in_flight":{},)"
+                       R"("queued":{},"workers":{},"inspect":{},"strip":{}}}}})",
+                       id, (util::stats::now_ns() - t_start_) / 1000000, connections_.load(),
+                       in_flight_.load(), queue_.size(), std::max(1u, o_.jobs), inspect_lat_.json(),
+                       strip_lat_.json());
+  }
+
+  const ServeOpts& o_;
+  std::shared_ptr<const core::Policy> base_;
+  JobQueue queue_;
+  std::uint64_t t_start_;
+  int listen_fd_ = -1;
+
+  std::mutex conns_mu_;
+  std::condition_variable readers_done_;
+  std::vector<std::weak_ptr<Conn>> conns_;
+  unsigned readers_ = 0;
+
+  std::mutex policy_mu_;
+  std::map<std::string, std::shared_ptr<const core::Policy>> policies_;
+
+  std::atomic<std::uint64_t> connections_{0};
+  std::atomic<unsigned> in_flight_{0};
+  Latency inspect_lat_, strip_lat_;
+};
+
+} // namespace
+
+int run_serve(const core::Policy& policy, const ServeOpts& o) {
+  util::DurabilityOpts dur;
+  if (!util::parse_durability(o.durability, dur.mode) || dur.mode == util::Durability::Batch) {
+    // batch defers renames, but a reply promises the output is in place
+    fmt::print(stderr, "Unknown --durability '{}' (expected none or file)\n", o.durability);
+    return 1;
+  }
+  util::set_durability(dur);
+  ServeOpts opts = o;
+  if (!opts.jobs) opts.jobs = std::max(1u, std::thread::hardware_concurrency());
+
+  struct sigaction sa{};
+  sa.sa_handler = on_stop_signal;
+  ::sigaction(SIGINT, &sa, nullptr);
+  ::sigaction(SIGTERM, &sa, nullptr);
+  return Server(opts, policy).run();
+}
+
+#else
+
+int run_serve(const core::Policy&, const ServeOpts&) {
+  fmt::print(stderr, "serve needs Unix domain sockets and is not available on this platform\n");
+  return 1;
+}
+
+#endif
+
+} // namespace cmd
@@ -1,46 +1,169 @@
 #include "detect.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <fstream>
-#include <array>
-#include <filesystem>
 
 namespace core {
 namespace {
 
-bool starts_with(const std::vector<unsigned char>& b, const std::string& s) {
-  if (b.size() < s.size()) return false;
-  for (size_t i=0;i<s.size();++i) if (b[i] != static_cast<unsigned char>(s[i])) return false;
-  return true;
+constexpr std::size_t kHead = 64; // enough for the Ogg codec id and an ftyp brand list
+// A bare MPEG stream is only taken as one when a second frame header follows the first;
+// the longest frame (MPEG-2 layer II, 160 kbit/s at 8 kHz) plus that header fits here.
+constexpr std::size_t kMpegProbe = 2881 + 4;
+
+// Length in bytes of the frame whose header is at `h`, or 0 when it is none: frame sync,
+// then no reserved version/layer, bitrate or sample-rate index.
+size_t mpeg_frame_len(const unsigned char* h, size_t got) {
+  if (got < 4 || h[0] != 0xFF || (h[1]&0xE0) != 0xE0) return 0;
+  const unsigned version = (h[1]>>3)&3, layer = (h[1]>>1)&3, rate = h[2]>>4, freq = (h[2]>>2)&3;
+  if (version == 1 || layer == 0 || rate == 0 || rate == 15 || freq == 3) return 0;
+  static constexpr unsigned short kbps[5][15] = {
+    {0,32,64,96,128,160,192,224,256,288,320,352,384,416,448}, // MPEG-1 layer I
+    {0,32,48,56,64,80,96,112,128,160,192,224,256,320,384},    // MPEG-1 layer II
+    {0,32,40,48,56,64,80,96,112,128,160,192,224,256,320},     // MPEG-1 layer III
+    {0,32,48,56,64,80,96,112,128,144,160,176,192,224,256},    // MPEG-2/2.5 layer I
+    {0,8,16,24,32,40,48,56,64,80,96,112,128,144,160},         // MPEG-2/2.5 layers II, III
+  };
+  static constexpr unsigned hz[3] = {44100, 48000, 32000};
+  const bool v1 = version == 3;
+  const size_t bitrate = size_t{1000} * kbps[v1 ? 3 - layer : layer == 3 ? 3 : 4][rate];
+  const size_t sample_rate = hz[freq] >> (v1 ? 0 : version == 2 ? 1 : 2);
+  const size_t pad = (h[2]>>1)&1;
+  if (layer == 3) return (12 * bitrate / sample_rate + pad) * 4;
+  return (layer == 1 && !v1 ? 72 : 144) * bitrate / sample_rate + pad;
 }
 
-} // anon
+// A frame header followed by another of the same version, layer and sample rate. When
+// the data ends before the second header, a lone frame counts only in a .mp3 file.
+bool mpeg_stream(const unsigned char* h, size_t got, bool mp3_name) {
+  const size_t len = mpeg_frame_len(h, got);
+  if (!len) return false;
+  if (got < len + 4) return mp3_name;
+  const unsigned char* n = h + len;
+  return mpeg_frame_len(n, got - len) && (n[1]&0xFE) == (h[1]&0xFE) && ((n[2]>>2)&3) == ((h[2]>>2)&3);
+}
 
-Detected detect_file(const std::string& path) {
-  Detected d; d.path = path;
-  std::ifstream f(path, std::ios::binary);
-  if (!f) return d;
+// Lower-cased extension without the dot; empty when there is none
+std::string extension(const std::string& path) {
+  auto dot = path.find_last_of("./\\");
+  if (dot == std::string::npos || path[dot] != '.') return {};
+  std::string ext = path.substr(dot + 1);
+  for (auto& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  return ext;
+}
 
-  std::vector<unsigned char> head(16);
-  f.read(reinterpret_cast<char*>(head.data()), static_cast<std::streamsize>(head.size()));
-  const auto got = static_cast<size_t>(f.gcount());
-  head.resize(got);
+// Byte offset just past an ID3v2 tag (header, syncsafe size, optional footer)
+size_t id3_end(const unsigned char* h) {
+  size_t size = (size_t(h[6]&0x7F)<<21) | (size_t(h[7]&0x7F)<<14) | (size_t(h[8]&0x7F)<<7) | size_t(h[9]&0x7F);
+  return 10 + size + ((h[5]&0x10) ? 10 : 0);
+}
+
+AudioKind sniff_audio(const unsigned char* head, size_t got, bool mp3_name) {
+  auto at = [&](size_t off, std::string_view s) {
+    return got >= off + s.size() && std::memcmp(head + off, s.data(), s.size()) == 0;
+  };
+  if (at(0, "ID3")) return AudioKind::MPEG; // FLAC behind the tag is told apart by the callers
+  if (at(0, "fLaC")) return AudioKind::FLAC;
+  if (at(0, "OggS") && got > 26) {
+    // first packet of the first page names the codec
+    const size_t pkt = 27 + head[26];
+    if (at(pkt, "\x01vorbis")) return AudioKind::Vorbis;
+    if (at(pkt, "OpusHead")) return AudioKind::Opus;
+    return AudioKind::Unknown;
+  }
+  if (at(4, "ftyp")) {
+    // major brand, then the compatible brands up to the end of the box
+    const size_t box = got >= 4 ? (size_t(head[0])<<24 | size_t(head[1])<<16 | size_t(head[2])<<8 | head[3]) : 0;
+    for (size_t off = 8; off + 4 <= std::min(box, got); off += off == 8 ? 8 : 4) {
+      for (std::string_view b : {"M4A ", "M4B ", "M4P ", "F4A ", "F4B "}) {
+        if (at(off, b)) return AudioKind::MP4;
+      }
+    }
+    return AudioKind::Unknown;
+  }
+  if (mpeg_stream(head, got, mp3_name)) return AudioKind::MPEG;
+  return AudioKind::Unknown;
+}
 
+FileType sniff(const unsigned char* head, size_t got, bool mp3_name) {
+  auto starts_with = [&](std::string_view s) {
+    return got >= s.size() && std::memcmp(head, s.data(), s.size()) == 0;
+  };
   // JPEG
-  if (got >= 3 && head[0]==0xFF && head[1]==0xD8 && head[2]==0xFF) { d.type = FileType::Image; return d; }
+  if (got >= 3 && head[0]==0xFF && head[1]==0xD8 && head[2]==0xFF) return FileType::Image;
   // PNG
   if (got >= 8 && head[0]==0x89 && head[1]==0x50 && head[2]==0x4E && head[3]==0x47 &&
-      head[4]==0x0D && head[5]==0x0A && head[6]==0x1A && head[7]==0x0A) { d.type = FileType::Image; return d; }
+      head[4]==0x0D && head[5]==0x0A && head[6]==0x1A && head[7]==0x0A) return FileType::Image;
   // WEBP (RIFF .... WEBP)
   if (got >= 12 && head[0]=='R'&&head[1]=='I'&&head[2]=='F'&&head[3]=='F' &&
-      head[8]=='W'&&head[9]=='E'&&head[10]=='B'&&head[11]=='P') { d.type = FileType::Image; return d; }
+      head[8]=='W'&&head[9]=='E'&&head[10]=='B'&&head[11]=='P') return FileType::Image;
   // PDF
-  if (starts_with(head, "%PDF-")) { d.type = FileType::PDF; return d; }
-  // MP3 (ID3) or FLAC
-  if (starts_with(head, "ID3") || starts_with(head, "fLaC")) { d.type = FileType::Audio; return d; }
+  if (starts_with("%PDF-")) return FileType::PDF;
   // ZIP
-  if (got >= 4 && head[0]=='P' && head[1]=='K' && (head[2]==3||head[2]==5||head[2]==7) && (head[3]==4||head[3]==6||head[3]==8)) {
-    d.type = FileType::ZIP; return d;
+  if (got >= 4 && head[0]=='P' && head[1]=='K' && (head[2]==3||head[2]==5||head[2]==7) && (head[3]==4||head[3]==6||head[3]==8))
+    return FileType::ZIP;
+  // MP3 (ID3 or a bare frame), FLAC, Ogg Vorbis/Opus, M4A
+  if (sniff_audio(head, got, mp3_name) != AudioKind::Unknown) return FileType::Audio;
+  return FileType::Unknown;
+}
+
+} // anon
+
+Detected detect_file(const std::string& path) {
+  Detected d; d.path = path;
+  std::ifstream f(path, std::ios::binary);
+  if (!f) return d;
+
+  unsigned char head[kMpegProbe];
+  f.read(reinterpret_cast<char*>(head), sizeof(head));
+  const auto got = static_cast<size_t>(f.gcount());
+  const bool mp3_name = extension(path) == "mp3";
+  d.type = sniff(head, got, mp3_name);
+  if (d.type != FileType::Audio) return d;
+  d.audio = sniff_audio(head, got, mp3_name);
+  if (d.audio == AudioKind::MPEG && got >= 10 && std::memcmp(head, "ID3", 3) == 0) {
+    // an ID3v2 tag may also front a FLAC stream
+    char magic[4];
+    f.clear();
+    f.seekg(static_cast<std::streamoff>(id3_end(head)));
+    if (f.read(magic, 4) && std::memcmp(magic, "fLaC", 4) == 0) d.audio = AudioKind::FLAC;
+  }
+  return d;
+}
+
+FileType guess_type(const std::string& path) {
+  const std::string ext = extension(path);
+  if (ext=="jpg" || ext=="jpeg" || ext=="png" || ext=="webp") return FileType::Image;
+  if (ext=="pdf") return FileType::PDF;
+  if (ext=="mp3" || ext=="flac" || ext=="ogg" || ext=="oga" || ext=="opus" || ext=="m4a") return FileType::Audio;
+  if (ext=="zip" || ext=="docx" || ext=="xlsx" || ext=="pptx" || ext=="odt" || ext=="ods" ||
+      ext=="odp" || ext=="epub" || ext=="jar") return FileType::ZIP;
+  return FileType::Unknown;
+}
+
+AudioKind guess_audio(const std::string& path) {
+  const std::string ext = extension(path);
+  if (ext=="mp3") return AudioKind::MPEG;
+  if (ext=="flac") return AudioKind::FLAC;
+  if (ext=="ogg" || ext=="oga") return AudioKind::Vorbis;
+  if (ext=="opus") return AudioKind::Opus;
+  if (ext=="m4a") return AudioKind::MP4;
+  return AudioKind::Unknown;
+}
+
+Detected detect_buffer(const std::string& path, std::string_view bytes) {
+  Detected d; d.path = path; d.bytes = bytes;
+  const auto* head = reinterpret_cast<const unsigned char*>(bytes.data());
+  const auto got = std::min(bytes.size(), kMpegProbe);
+  const bool mp3_name = extension(path) == "mp3";
+  d.type = sniff(head, got, mp3_name);
+  if (d.type != FileType::Audio) return d;
+  d.audio = sniff_audio(head, got, mp3_name);
+  if (d.audio == AudioKind::MPEG && got >= 10 && std::memcmp(head, "ID3", 3) == 0 &&
+      bytes.substr(std::min(bytes.size(), id3_end(head)), 4) == "fLaC") {
+    d.audio = AudioKind::FLAC;
   }
-  d.type = FileType::Unknown;
   return d;
 }
 
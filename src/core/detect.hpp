@@ -1,21 +1,38 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstddef>
+#include "fields.hpp"
 
 namespace core {
 
 enum class FileType { Unknown, Image, PDF, Audio, ZIP };
+// Container of an Audio file, from its header bytes; Unknown leaves it to the backend.
+enum class AudioKind { Unknown, MPEG, FLAC, Vorbis, Opus, MP4 };
 
 struct Block { std::string name; std::size_t size=0; };
 
+// Detected::max_value default: every field value rendered in full
+inline constexpr std::size_t kAllValues = static_cast<std::size_t>(-1);
+
 struct Detected {
   std::string path;
   FileType type = FileType::Unknown;
   std::vector<Block> blocks; // filled by backends during inspect
+  std::string_view bytes;    // whole file when preloaded (--io uring); empty → backends read `path`
+  AudioKind audio = AudioKind::Unknown;
+  // Longest field value to render (--max-value-bytes); 0 renders none, for callers that
+  // only print names, counts and risk. Backends may skip formatting values altogether.
+  std::size_t max_value = kAllValues;
 };
 
 Detected detect_file(const std::string& path);
+// Cheap guess from the file extension, for planning before anything is opened.
+FileType guess_type(const std::string& path);
+AudioKind guess_audio(const std::string& path);
+// Sniff a preloaded file; the returned Detected views `bytes`, which must outlive it.
+Detected detect_buffer(const std::string& path, std::string_view bytes);
 
 struct Field {
   std::string canonical; // EXIF.GPSLatitude
@@ -23,15 +40,20 @@ struct Field {
   std::string risk;      // HIGH|MEDIUM|LOW|SAFE
   std::string block;     // EXIF / XMP / IPTC
   std::size_t bytes=0;
+  std::size_t value_bytes=0;   // the whole value, also when `value` is cut or left empty
+  RiskTag tag = RiskTag::None; // report category, from the field table
 };
 
 struct InspectResult {
   std::string file;
   FileType type{FileType::Unknown};
   std::vector<std::string> detected_blocks; // ["EXIF","XMP"]
-  std::vector<std::string> risk_tags;       // ["gps","device_model"]
+  std::vector<std::string> risk_tags;       // ["GPS","Device"]
   std::vector<Field> fields;
   std::size_t meta_bytes=0;
+  std::string duplicate_of;                 // --dedup: earlier file with the same content
+  std::string status;                       // strip: stripped|unchanged|planned|duplicate
+  std::string confidence;                   // inspect --quick: complete|partial
 };
 
 // High-level API
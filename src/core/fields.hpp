@@ -0,0 +1,178 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Known metadata fields, keyed by the key each backend reads natively: the Exiv2 key
+// ("Exif.Image.Model"), the PDF Info key ("/Author"), the ID3 frame ("TPE1") or the ZIP
+// record name. One lookup yields the canonical name, risk level and report tag. Both
+// indexes are perfect hashes built at compile time, so classification is O(1) and
+// never allocates.
+namespace core {
+
+enum class Risk : std::uint8_t { Safe, Low, Medium, High };
+
+// Category shown in the report's risk column.
+enum class RiskTag : std::uint8_t {
+  None, GPS, Device, Software, Author, Producer, Timestamps, Artist, Year, Comment
+};
+
+constexpr std::string_view risk_name(Risk r) {
+  switch (r) {
+    case Risk::Safe:   return "SAFE";
+    case Risk::Low:    return "LOW";
+    case Risk::Medium: return "MEDIUM";
+    case Risk::High:   return "HIGH";
+  }
+  return "LOW";
+}
+
+constexpr std::string_view tag_name(RiskTag t) {
+  switch (t) {
+    case RiskTag::None:       return "";
+    case RiskTag::GPS:        return "GPS";
+    case RiskTag::Device:     return "Device";
+    case RiskTag::Software:   return "Software";
+    case RiskTag::Author:     return "Author";
+    case RiskTag::Producer:   return "Producer";
+    case RiskTag::Timestamps: return "Timestamps";
+    case RiskTag::Artist:     return "Artist";
+    case RiskTag::Year:       return "Year";
+    case RiskTag::Comment:    return "Comment";
+  }
+  return "";
+}
+
+struct FieldInfo {
+  std::string_view native;
+  std::string_view canonical;
+  Risk risk;
+  RiskTag tag;
+};
+
+inline constexpr std::array kFields{
+  // Exiv2 keys
+  FieldInfo{"Exif.GPSInfo.GPSLatitude",     "EXIF.GPSLatitude",  Risk::High,   RiskTag::GPS},
+  FieldInfo{"Exif.GPSInfo.GPSLatitudeRef",  "EXIF.GPSLatitude",  Risk::High,   RiskTag::GPS},
+  FieldInfo{"Exif.GPSInfo.GPSLongitude",    "EXIF.GPSLongitude", Risk::High,   RiskTag::GPS},
+  FieldInfo{"Exif.GPSInfo.GPSLongitudeRef", "EXIF.GPSLongitude", Risk::High,   RiskTag::GPS},
+  FieldInfo{"Exif.Image.Orientation",       "EXIF.Orientation",  Risk::Safe,   RiskTag::None},
+  FieldInfo{"Exif.Image.Make",              "EXIF.Make",         Risk::Medium, RiskTag::Device},
+  FieldInfo{"Exif.Image.Model",             "EXIF.Model",        Risk::Medium, RiskTag::Device},
+  FieldInfo{"Exif.Photo.BodySerialNumber",  "EXIF.SerialNumber", Risk::Medium, RiskTag::Device},
+  FieldInfo{"Exif.Image.BodySerialNumber",  "EXIF.SerialNumber", Risk::Medium, RiskTag::Device},
+  FieldInfo{"Xmp.xmp.CreatorTool",          "XMP.CreatorTool",   Risk::Low,    RiskTag::Software},
+  FieldInfo{"Xmp.xmpMM.History",            "XMP.History",       Risk::Low,    RiskTag::None},
+  // synthetic image fields (no native key of their own)
+  FieldInfo{"Image.ColorProfile",           "Image.ColorProfile", Risk::Safe,  RiskTag::None},
+  FieldInfo{"Image.DPI",                    "Image.DPI",          Risk::Safe,  RiskTag::None},
+  // PDF Info dictionary
+  FieldInfo{"/Title",                       "PDF.Title",         Risk::Medium, RiskTag::None},
+  FieldInfo{"/Author",                      "PDF.Author",        Risk::Medium, RiskTag::Author},
+  FieldInfo{"/Creator",                     "PDF.Creator",       Risk::Medium, RiskTag::Producer},
+  FieldInfo{"/Producer",                    "PDF.Producer",      Risk::Medium, RiskTag::Producer},
+  FieldInfo{"/CreationDate",                "PDF.CreationDate",  Risk::High,   RiskTag::Timestamps},
+  FieldInfo{"/ModDate",                     "PDF.ModDate",       Risk::High,   RiskTag::Timestamps},
+  // XMP properties read from a raw packet (a PDF's /Metadata, or inspect --quick), keyed
+  // by qualified name (Exiv2 keys are dotted, so image XMP keeps its own rows above and
+  // its "XMP.Xmp.*" fallback)
+  FieldInfo{"dc:title",                     "XMP.Title",         Risk::Medium, RiskTag::None},
+  FieldInfo{"dc:creator",                   "XMP.Creator",       Risk::Medium, RiskTag::Author},
+  FieldInfo{"dc:description",               "XMP.Description",   Risk::Medium, RiskTag::None},
+  FieldInfo{"xmp:CreatorTool",              "XMP.CreatorTool",   Risk::Low,    RiskTag::Software},
+  FieldInfo{"xmp:CreateDate",               "XMP.CreateDate",    Risk::High,   RiskTag::Timestamps},
+  FieldInfo{"xmp:ModifyDate",               "XMP.ModifyDate",    Risk::High,   RiskTag::Timestamps},
+  FieldInfo{"xmp:MetadataDate",             "XMP.MetadataDate",  Risk::High,   RiskTag::Timestamps},
+  FieldInfo{"pdf:Producer",                 "XMP.Producer",      Risk::Medium, RiskTag::Producer},
+  FieldInfo{"pdf:Keywords",                 "XMP.Keywords",      Risk::Low,    RiskTag::None},
+  FieldInfo{"xmpMM:DocumentID",             "XMP.DocumentID",    Risk::Low,    RiskTag::None},
+  FieldInfo{"xmpMM:InstanceID",             "XMP.InstanceID",    Risk::Low,    RiskTag::None},
+  FieldInfo{"exif:GPSLatitude",             "XMP.GPSLatitude",   Risk::High,   RiskTag::GPS},
+  FieldInfo{"exif:GPSLongitude",            "XMP.GPSLongitude",  Risk::High,   RiskTag::GPS},
+  FieldInfo{"aux:SerialNumber",             "XMP.SerialNumber",  Risk::Medium, RiskTag::Device},
+  // ID3 frames (also used for the matching Vorbis/generic tag fields)
+  FieldInfo{"TIT2",                         "ID3.TIT2",          Risk::Low,    RiskTag::None},
+  FieldInfo{"TPE1",                         "ID3.TPE1",          Risk::Medium, RiskTag::Artist},
+  FieldInfo{"TALB",                         "ID3.TALB",          Risk::Medium, RiskTag::None},
+  FieldInfo{"TDRC",                         "ID3.TDRC",          Risk::Low,    RiskTag::Year},
+  // ZIP records
+  FieldInfo{"ArchiveComment",               "ZIP.Comment",       Risk::Low,    RiskTag::Comment},
+  FieldInfo{"ExtraFields",                  "ZIP.ExtraFields",   Risk::Low,    RiskTag::None},
+  FieldInfo{"FileComments",                 "ZIP.FileComments",  Risk::Low,    RiskTag::None},
+};
+
+namespace detail {
+
+constexpr std::uint32_t fnv1a(std::string_view s, std::uint32_t seed) {
+  std::uint32_t h = 2166136261u ^ seed;
+  for (char c : s) { h ^= static_cast<unsigned char>(c); h *= 16777619u; }
+  return h;
+}
+
+constexpr unsigned kIndexBits = 8;
+constexpr std::uint32_t kIndexMask = (1u << kIndexBits) - 1;
+static_assert(kFields.size() < 255, "slot indexes are 8-bit");
+
+struct PerfectIndex {
+  std::uint32_t seed = 0;
+  std::array<std::uint8_t, 1u << kIndexBits> slot{}; // entry index + 1; 0 = empty
+};
+
+// Tries seeds until every distinct key lands in its own slot. Entries sharing a key
+// (several natives with one canonical name) resolve to the first of them. Gives up with
+// an empty index, which resolves_all() below turns into a compile error.
+template <class Key>
+constexpr PerfectIndex build_index(Key key) {
+  for (std::uint32_t seed = 0; seed < 100000; ++seed) {
+    PerfectIndex ix{seed, {}};
+    bool ok = true;
+    for (std::size_t i = 0; i < kFields.size() && ok; ++i) {
+      bool dup = false;
+      for (std::size_t j = 0; j < i && !dup; ++j) dup = key(kFields[j]) == key(kFields[i]);
+      if (dup) continue;
+      auto& s = ix.slot[fnv1a(key(kFields[i]), seed) & kIndexMask];
+      if (s) ok = false;
+      else s = static_cast<std::uint8_t>(i + 1);
+    }
+    if (ok) return ix;
+  }
+  return {};
+}
+
+inline constexpr PerfectIndex kByNative = build_index([](const FieldInfo& f) { return f.native; });
+inline constexpr PerfectIndex kByCanonical = build_index([](const FieldInfo& f) { return f.canonical; });
+
+} // namespace detail
+
+constexpr const FieldInfo* field_by_native(std::string_view native) {
+  const auto s = detail::kByNative.slot[detail::fnv1a(native, detail::kByNative.seed) & detail::kIndexMask];
+  return s && kFields[s - 1].native == native ? &kFields[s - 1] : nullptr;
+}
+
+constexpr const FieldInfo* field_by_canonical(std::string_view canonical) {
+  const auto s = detail::kByCanonical.slot[detail::fnv1a(canonical, detail::kByCanonical.seed) & detail::kIndexMask];
+  return s && kFields[s - 1].canonical == canonical ? &kFields[s - 1] : nullptr;
+}
+
+namespace detail {
+
+// Every entry is found again through both indexes (as the first entry with its key).
+constexpr bool resolves_all() {
+  for (std::size_t i = 0; i < kFields.size(); ++i) {
+    const auto* n = field_by_native(kFields[i].native);
+    const auto* c = field_by_canonical(kFields[i].canonical);
+    if (!n || n->native != kFields[i].native || n > &kFields[i]) return false;
+    if (!c || c->canonical != kFields[i].canonical || c > &kFields[i]) return false;
+  }
+  return true;
+}
+
+} // namespace detail
+
+static_assert(detail::resolves_all(), "no perfect hash found for kFields; raise kIndexBits or the seed limit");
+static_assert(field_by_native("/Author") && field_by_native("/Author")->tag == RiskTag::Author);
+static_assert(field_by_canonical("EXIF.GPSLongitude") && field_by_canonical("EXIF.GPSLongitude")->risk == Risk::High);
+static_assert(!field_by_native("Exif.Image.Artist"));
+
+} // namespace core
@@ -55,18 +55,41 @@ bool glob_match(const std::string& pat, const std::string& txt) {
   return pi == pat.size();
 }
 
-std::string risk_for(const std::string& f) {
-  // Simplified mapping. Expand as needed.
-  if (f.rfind("EXIF.GPS",0)==0 || f=="PDF.CreationDate" || f=="PDF.ModDate") return "HIGH";
-  if (f=="EXIF.SerialNumber" || f=="EXIF.Make" || f=="EXIF.Model" || f=="ID3.TPE1") return "MEDIUM";
-  if (f=="EXIF.Orientation" || f=="Image.ColorProfile" || f=="Image.DPI") return "SAFE";
-  if (f.rfind("PDF.",0)==0) return "MEDIUM";
-  if (f=="ID3.TPE1" || f=="ID3.TALB") return "MEDIUM";
-  if (f=="ID3.TDRC") return "LOW";
-  if (f=="ZIP.Comment") return "LOW";
+std::string_view risk_for(std::string_view f) {
+  if (auto* info = field_by_canonical(f)) return risk_name(info->risk);
+  // fields outside the table
+  if (f.starts_with("EXIF.GPS")) return "HIGH";
+  if (f.starts_with("PDF.")) return "MEDIUM";
   return "LOW";
 }
 
+Field make_field(std::string_view prefix, std::string_view native, std::string value,
+                 std::string block, std::size_t bytes) {
+  Field f;
+  if (auto* info = field_by_native(native)) {
+    f.canonical = info->canonical;
+    f.risk = risk_name(info->risk);
+    f.tag = info->tag;
+  } else {
+    f.canonical.reserve(prefix.size() + native.size());
+    f.canonical.append(prefix).append(native);
+    f.risk = risk_for(f.canonical);
+  }
+  f.value_bytes = value.size();
+  f.value = std::move(value);
+  f.block = std::move(block);
+  f.bytes = bytes;
+  return f;
+}
+
+void clip_value(std::string& value, std::size_t max) {
+  if (value.size() <= max) return;
+  if (max == 0) { std::string().swap(value); return; }
+  while (max > 0 && (static_cast<unsigned char>(value[max]) & 0xC0) == 0x80) --max;
+  value.resize(max);
+  value += "…";
+}
+
 bool policy_keep(const Policy& p, const std::string& canonical) {
   // If any keep matches -> keep
   for (auto& k : p.keep) if (glob_match(k, canonical)) return true;
@@ -76,4 +99,43 @@ bool policy_keep(const Policy& p, const std::string& canonical) {
   return false;
 }
 
+// Runs `pat` over `prefix` as an NFA. can_match: some name starting with `prefix`
+// matches; matches_all: every such name does (the rest of the pattern is all '*').
+static void glob_prefix(const std::string& pat, std::string_view prefix, bool& can_match, bool& matches_all) {
+  std::vector<char> on(pat.size() + 1, 0), next(pat.size() + 1, 0);
+  auto close = [&](std::vector<char>& s) {
+    for (size_t i = 0; i < pat.size(); ++i) if (s[i] && pat[i] == '*') s[i + 1] = 1;
+  };
+  on[0] = 1;
+  close(on);
+  for (char c : prefix) {
+    std::fill(next.begin(), next.end(), 0);
+    for (size_t i = 0; i < pat.size(); ++i) {
+      if (!on[i]) continue;
+      if (pat[i] == '*') next[i] = 1;
+      else if (pat[i] == c || pat[i] == '?') next[i + 1] = 1;
+    }
+    close(next);
+    on.swap(next);
+  }
+  can_match = matches_all = false;
+  for (size_t i = 0; i <= pat.size(); ++i) {
+    if (!on[i]) continue;
+    can_match = true;
+    if (i < pat.size() && pat.find_first_not_of('*', i) == std::string::npos) matches_all = true;
+  }
+}
+
+BlockAction block_action(const Policy& p, std::string_view prefix) {
+  // keep wins over drop and everything else is dropped, so only the keeps decide
+  bool any = false;
+  for (auto& k : p.keep) {
+    bool can = false, all = false;
+    glob_prefix(k, prefix, can, all);
+    if (all) return BlockAction::KeepAll;
+    any = any || can;
+  }
+  return any ? BlockAction::Mixed : BlockAction::DropAll;
+}
+
 } // namespace core
@@ -1,7 +1,10 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_set>
+#include "detect.hpp"
 
 namespace core {
 
@@ -20,9 +23,23 @@ Policy load_policy(bool safe_flag,
 bool glob_match(const std::string& pattern, const std::string& text);
 
 // risk: HIGH/MEDIUM/LOW/SAFE
-std::string risk_for(const std::string& canonical);
+std::string_view risk_for(std::string_view canonical);
+
+// Field for a backend-native key (see fields.hpp); unknown keys become `prefix + native`
+Field make_field(std::string_view prefix, std::string_view native, std::string value,
+                 std::string block, std::size_t bytes);
+
+// Cuts `value` to at most `max` bytes at a UTF-8 boundary, marking the cut with "…"
+// (see Detected::max_value); 0 empties it.
+void clip_value(std::string& value, std::size_t max);
 
 // convenience: decide if a field should be kept
 bool policy_keep(const Policy& p, const std::string& canonical);
 
+// What a policy does to every field whose canonical name starts with `prefix` ("EXIF.",
+// "PDF."), so backends can keep or clear a whole block without testing each field.
+// Mixed when it depends on the field (or the patterns are too tangled to tell).
+enum class BlockAction : std::uint8_t { KeepAll, DropAll, Mixed };
+BlockAction block_action(const Policy& p, std::string_view prefix);
+
 } // namespace core
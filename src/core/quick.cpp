@@ -0,0 +1,628 @@
+#include "quick.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include "policy.hpp"
+#include "text.hpp"
+#include "util/stats.hpp"
+
+namespace core {
+namespace {
+
+// The first and last kQuickWindow bytes of a file, or all of it when it fits in the two
+class Windows {
+public:
+  bool load(const Detected& d) {
+    if (!d.bytes.empty()) {
+      size_ = d.bytes.size();
+      if (size_ <= 2 * kQuickWindow) { head_ = d.bytes; return true; }
+      head_ = d.bytes.substr(0, kQuickWindow);
+      tail_off_ = size_ - kQuickWindow;
+      tail_ = d.bytes.substr(tail_off_);
+      return true;
+    }
+    util::stats::Timer t(util::stats::Phase::Open, d.path);
+    std::ifstream f(d.path, std::ios::binary);
+    if (!f) return false;
+    f.seekg(0, std::ios::end);
+    const auto end = f.tellg();
+    if (end < 0) return false;
+    size_ = static_cast<std::uint64_t>(end);
+    auto read = [&](std::uint64_t off, std::size_t n, std::string& out) {
+      out.resize(n);
+      f.seekg(static_cast<std::streamoff>(off));
+      f.read(out.data(), static_cast<std::streamsize>(n));
+      out.resize(static_cast<std::size_t>(f.gcount()));
+      util::stats::bytes_read(out.size());
+    };
+    if (size_ <= 2 * kQuickWindow) {
+      read(0, static_cast<std::size_t>(size_), head_buf_);
+      head_ = head_buf_;
+      return head_.size() == size_;
+    }
+    read(0, kQuickWindow, head_buf_);
+    tail_off_ = size_ - kQuickWindow;
+    read(tail_off_, kQuickWindow, tail_buf_);
+    head_ = head_buf_;
+    tail_ = tail_buf_;
+    return head_.size() == kQuickWindow && tail_.size() == kQuickWindow;
+  }
+  std::uint64_t size() const { return size_; }
+  bool whole() const { return head_.size() == size_; }
+  std::string_view head() const { return head_; }
+  std::string_view tail() const { return tail_; }
+  // Up to `max` bytes from `off`, as far as the window holding `off` goes
+  std::string_view from(std::uint64_t off, std::uint64_t max) const {
+    if (off < head_.size()) return head_.substr(static_cast<std::size_t>(off), static_cast<std::size_t>(max));
+    if (!tail_.empty() && off >= tail_off_ && off < size_) {
+      return tail_.substr(static_cast<std::size_t>(off - tail_off_), static_cast<std::size_t>(max));
+    }
+    return {};
+  }
+  // `n` bytes at `off` when one window holds them all; empty otherwise
+  std::string_view at(std::uint64_t off, std::uint64_t n) const {
+    if (off <= head_.size() && n <= head_.size() - off) return head_.substr(static_cast<std::size_t>(off), static_cast<std::size_t>(n));
+    if (!tail_.empty() && off >= tail_off_ && off <= size_ && n <= size_ - off) {
+      return tail_.substr(static_cast<std::size_t>(off - tail_off_), static_cast<std::size_t>(n));
+    }
+    return {};
+  }
+
+private:
+  std::string head_buf_, tail_buf_;
+  std::string_view head_, tail_;
+  std::uint64_t size_ = 0, tail_off_ = 0;
+};
+
+// What the scan found, in the same shape the backends report
+struct Scan {
+  InspectResult& ir;
+  std::size_t max_value;
+  bool complete = false;
+
+  void block(std::string_view name) {
+    if (std::find(ir.detected_blocks.begin(), ir.detected_blocks.end(), name) == ir.detected_blocks.end()) {
+      ir.detected_blocks.emplace_back(name);
+    }
+  }
+  void field(std::string_view prefix, std::string_view native, std::string value, std::string_view blk,
+             std::size_t bytes) {
+    const auto full = value.size();
+    clip_value(value, max_value);
+    ir.fields.push_back(make_field(prefix, native, std::move(value), std::string(blk), bytes));
+    ir.fields.back().value_bytes = full;
+    ir.meta_bytes += bytes;
+  }
+  bool has(std::string_view canonical) const {
+    return std::any_of(ir.fields.begin(), ir.fields.end(), [&](const Field& f) { return f.canonical == canonical; });
+  }
+};
+
+std::uint32_t be(std::string_view s, std::size_t off, int n) {
+  std::uint32_t v = 0;
+  for (int i = 0; i < n; ++i) v = v << 8 | static_cast<unsigned char>(s[off + i]);
+  return v;
+}
+std::uint32_t le(std::string_view s, std::size_t off, int n) {
+  std::uint32_t v = 0;
+  for (int i = n - 1; i >= 0; --i) v = v << 8 | static_cast<unsigned char>(s[off + i]);
+  return v;
+}
+bool fits(std::string_view s, std::size_t off, std::size_t n) { return off <= s.size() && n <= s.size() - off; }
+
+// Latin-1 (ID3 encoding 0, ID3v1) to UTF-8
+std::string latin1(std::string_view s) {
+  std::string o;
+  o.reserve(s.size());
+  for (unsigned char c : s) {
+    if (c < 0x80) o += static_cast<char>(c);
+    else { o += static_cast<char>(0xC0 | c >> 6); o += static_cast<char>(0x80 | (c & 0x3F)); }
+  }
+  return o;
+}
+// UTF-16 to UTF-8 for the BMP (surrogates become '?'); `big` for big-endian
+std::string utf16(std::string_view s, bool big) {
+  std::string o;
+  for (std::size_t i = 0; i + 1 < s.size(); i += 2) {
+    const unsigned c = big ? be(s, i, 2) : le(s, i, 2);
+    if (c == 0) break;
+    if (c < 0x80) o += static_cast<char>(c);
+    else if (c < 0x800) { o += static_cast<char>(0xC0 | c >> 6); o += static_cast<char>(0x80 | (c & 0x3F)); }
+    else if (c >= 0xD800 && c < 0xE000) o += '?';
+    else {
+      o += static_cast<char>(0xE0 | c >> 12);
+      o += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      o += static_cast<char>(0x80 | (c & 0x3F));
+    }
+  }
+  return o;
+}
+std::string_view until_nul(std::string_view s) { return s.substr(0, s.find('\0')); }
+
+// ---- XMP: the kXmpProps the PDF backend also reads (text.hpp) ----
+
+void scan_xmp(std::string_view x, std::string_view block, Scan& s) {
+  s.block(block);
+  for (auto qname : kXmpProps) {
+    auto v = xmp_value(x, qname);
+    if (v.empty()) continue;
+    const auto bytes = qname.size() + v.size();
+    s.field("XMP.", qname, std::move(v), block, bytes);
+  }
+}
+
+// ---- TIFF/Exif: IFD0, the Exif IFD and the GPS IFD ----
+
+struct TiffTag { std::uint16_t tag; std::string_view key; };
+constexpr TiffTag kIfd0[] = {
+  {0x010F, "Exif.Image.Make"},     {0x0110, "Exif.Image.Model"},  {0x0131, "Exif.Image.Software"},
+  {0x0132, "Exif.Image.DateTime"}, {0x013B, "Exif.Image.Artist"}, {0x8298, "Exif.Image.Copyright"},
+  {0xC62F, "Exif.Image.BodySerialNumber"},
+};
+constexpr TiffTag kExifIfd[] = {
+  {0x9003, "Exif.Photo.DateTimeOriginal"}, {0xA430, "Exif.Photo.CameraOwnerName"},
+  {0xA431, "Exif.Photo.BodySerialNumber"}, {0xA435, "Exif.Photo.LensSerialNumber"},
+};
+constexpr TiffTag kGpsIfd[] = {
+  {1, "Exif.GPSInfo.GPSLatitudeRef"},  {2, "Exif.GPSInfo.GPSLatitude"},
+  {3, "Exif.GPSInfo.GPSLongitudeRef"}, {4, "Exif.GPSInfo.GPSLongitude"},
+  {6, "Exif.GPSInfo.GPSAltitude"},     {29, "Exif.GPSInfo.GPSDateStamp"},
+};
+constexpr std::uint16_t kExifPointer = 0x8769, kGpsPointer = 0x8825;
+constexpr int kMaxEntries = 512;
+
+class Tiff {
+public:
+  Tiff(std::string_view t, Scan& s) : t_(t), s_(s) {}
+  void scan() {
+    if (t_.size() < 8) return;
+    if (t_.substr(0, 2) == "II") le_ = true;
+    else if (t_.substr(0, 2) != "MM") return;
+    if (u(2, 2) != 42) return;
+    s_.block("EXIF");
+    std::uint32_t exif = 0, gps = 0;
+    ifd(u(4, 4), kIfd0, &exif, &gps);
+    if (exif) ifd(exif, kExifIfd, nullptr, nullptr);
+    if (gps) ifd(gps, kGpsIfd, nullptr, nullptr);
+  }
+
+private:
+  std::uint32_t u(std::size_t off, int n) const { return le_ ? le(t_, off, n) : be(t_, off, n); }
+
+  template <std::size_t N>
+  void ifd(std::uint32_t off, const TiffTag (&tags)[N], std::uint32_t* exif, std::uint32_t* gps) {
+    if (!fits(t_, off, 2)) return;
+    const int count = static_cast<int>(std::min<std::uint32_t>(u(off, 2), kMaxEntries));
+    for (int i = 0; i < count; ++i) {
+      const std::size_t e = off + 2 + 12 * static_cast<std::size_t>(i);
+      if (!fits(t_, e, 12)) return;
+      const auto tag = static_cast<std::uint16_t>(u(e, 2));
+      if (exif && tag == kExifPointer) { *exif = u(e + 8, 4); continue; }
+      if (gps && tag == kGpsPointer) { *gps = u(e + 8, 4); continue; }
+      for (auto& t : tags) {
+        if (t.tag == tag) { entry(e, t.key); break; }
+      }
+    }
+  }
+
+  void entry(std::size_t e, std::string_view key) {
+    static constexpr int kSize[] = {0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8};
+    const auto type = u(e + 2, 2), count = u(e + 4, 4);
+    if (type == 0 || type > 10 || count > (1u << 20)) return;
+    const std::size_t len = static_cast<std::size_t>(count) * kSize[type];
+    const std::size_t at = len <= 4 ? e + 8 : u(e + 8, 4);
+    if (!fits(t_, at, len)) return;
+    // rendered like Exiv2's toString(): text up to the NUL, numbers and rationals
+    // separated by spaces
+    std::string v;
+    if (type == 2) {
+      v.assign(until_nul(t_.substr(at, len)));
+    } else if (type == 5 || type == 10) {
+      for (std::size_t i = 0; i < count && i < 64; ++i) {
+        if (i) v += ' ';
+        v += std::to_string(u(at + 8 * i, 4)) + '/' + std::to_string(u(at + 8 * i + 4, 4));
+      }
+    } else if (type == 1 || type == 3 || type == 4) {
+      for (std::size_t i = 0; i < count && i < 64; ++i) {
+        if (i) v += ' ';
+        v += std::to_string(u(at + i * kSize[type], kSize[type]));
+      }
+    }
+    s_.field("EXIF.", key, std::move(v), "EXIF", len + key.size());
+  }
+
+  std::string_view t_;
+  Scan& s_;
+  bool le_ = false;
+};
+
+// ---- containers ----
+
+constexpr std::string_view kExifId = std::string_view("Exif\0\0", 6);
+constexpr std::string_view kXmpId = std::string_view("http://ns.adobe.com/xap/1.0/\0", 29);
+
+void scan_jpeg(const Windows& w, Scan& s) {
+  const auto h = w.head();
+  std::size_t p = 2;
+  while (p + 4 <= h.size()) {
+    if (static_cast<unsigned char>(h[p]) != 0xFF) return; // lost sync
+    const auto m = static_cast<unsigned char>(h[p + 1]);
+    if (m == 0xFF) { ++p; continue; }                     // fill byte
+    if (m == 0xDA || m == 0xD9) { s.complete = true; return; } // image data: no more APPn
+    if ((m >= 0xD0 && m <= 0xD7) || m == 0x01) { p += 2; continue; }
+    const std::size_t len = be(h, p + 2, 2);
+    if (len < 2 || !fits(h, p + 4, len - 2)) return;      // segment runs past the window
+    const auto seg = h.substr(p + 4, len - 2);
+    if (m == 0xE1 && seg.starts_with(kExifId)) Tiff(seg.substr(kExifId.size()), s).scan();
+    else if (m == 0xE1 && seg.starts_with(kXmpId)) scan_xmp(seg.substr(kXmpId.size()), "XMP", s);
+    else if (m == 0xED && seg.starts_with("Photoshop 3.0")) s.block("IPTC");
+    p += 2 + len;
+  }
+}
+
+void scan_png(const Windows& w, Scan& s) {
+  const auto h = w.head();
+  for (std::size_t p = 8; fits(h, p, 8);) {
+    const std::size_t len = be(h, p, 4);
+    const auto type = h.substr(p + 4, 4);
+    if (type == "IDAT" || type == "IEND") { s.complete = true; return; }
+    if (!fits(h, p + 8, len)) return;
+    const auto data = h.substr(p + 8, len);
+    if (type == "eXIf") Tiff(data, s).scan();
+    else if (type == "iTXt" && data.starts_with(std::string_view("XML:com.adobe.xmp\0", 18))) scan_xmp(data, "XMP", s);
+    else if ((type == "tEXt" || type == "zTXt" || type == "iTXt") && data.starts_with("Raw profile type iptc")) s.block("IPTC");
+    p += 12 + len;
+  }
+}
+
+void scan_webp(const Windows& w, Scan& s) {
+  // RIFF chunks; EXIF and XMP usually follow the image data, so the walk hops to the tail
+  if (w.head().size() < 12) return;
+  const std::uint64_t end = std::min<std::uint64_t>(w.size(), 8ull + le(w.head(), 4, 4));
+  for (std::uint64_t p = 12; p < end;) {
+    const auto hdr = w.at(p, 8);
+    if (hdr.size() != 8) return;
+    const std::uint64_t len = le(hdr, 4, 4);
+    const auto fourcc = hdr.substr(0, 4);
+    if (fourcc == "EXIF" || fourcc == "XMP ") {
+      const auto data = w.at(p + 8, len);
+      if (data.size() != len) return;
+      if (fourcc == "XMP ") scan_xmp(data, "XMP", s);
+      else Tiff(data.starts_with(kExifId) ? data.substr(kExifId.size()) : data, s).scan();
+    }
+    p += 8 + len + (len & 1);
+  }
+  s.complete = true;
+}
+
+// PDF Info: through the trailer and a classic xref table when both sit in the windows,
+// else whatever Info-looking entries the windows show.
+constexpr std::string_view kInfoKeys[] = {"/Title", "/Author", "/Creator", "/Producer", "/CreationDate", "/ModDate"};
+
+bool pdf_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\0'; }
+
+// End of the object starting at `i`: a string, dict or array with what it holds, else a
+// name, number or keyword. Anything cut off by the window ends at the window's end.
+std::size_t pdf_skip(std::string_view d, std::size_t i, int nest = 0) {
+  if (i >= d.size() || nest > 32) return d.size();
+  if (d[i] == '(') {
+    int depth = 0;
+    for (; i < d.size(); ++i) {
+      if (d[i] == '\\') ++i;
+      else if (d[i] == '(') ++depth;
+      else if (d[i] == ')' && --depth == 0) return i + 1;
+    }
+    return d.size();
+  }
+  if (d[i] == '[' || d.compare(i, 2, "<<") == 0) {
+    const std::string_view close = d[i] == '[' ? "]" : ">>";
+    for (i += close.size(); i < d.size();) {
+      if (d.compare(i, close.size(), close) == 0) return i + close.size();
+      if (pdf_space(d[i])) ++i;
+      else i = pdf_skip(d, i, nest + 1);
+    }
+    return d.size();
+  }
+  if (d[i] == '<') {
+    const auto e = d.find('>', i);
+    return e == std::string_view::npos ? d.size() : e + 1;
+  }
+  for (++i; i < d.size() && !pdf_space(d[i]) && !std::strchr("()<>[]{}/%", d[i]); ++i) {}
+  return i;
+}
+
+// Each top-level key and raw value of the dict `d` ("<<" first)
+template <class Fn>
+void pdf_entries(std::string_view d, Fn fn) {
+  if (!d.starts_with("<<")) return;
+  for (std::size_t i = 2;;) {
+    while (i < d.size() && pdf_space(d[i])) ++i;
+    if (i >= d.size() || d.compare(i, 2, ">>") == 0) return;
+    if (d[i] != '/') { i = pdf_skip(d, i); continue; } // the "0 R" of a reference
+    const auto key_end = pdf_skip(d, i);
+    const auto key = d.substr(i, key_end - i);
+    for (i = key_end; i < d.size() && pdf_space(d[i]); ++i) {}
+    if (i >= d.size()) return;
+    const auto value_end = pdf_skip(d, i);
+    fn(key, d.substr(i, value_end - i));
+    i = value_end;
+  }
+}
+
+void pdf_info_keys(std::string_view dict, Scan& s) {
+  s.block("Info");
+  pdf_entries(dict, [&](std::string_view key, std::string_view v) {
+    std::string text;
+    if (std::find(std::begin(kInfoKeys), std::end(kInfoKeys), key) == std::end(kInfoKeys) || !pdf_string(v, text)) return;
+    s.field("PDF.", key, std::move(text), "PDF.Info", key.size() + v.size());
+  });
+}
+
+// Offset of object `num` from the classic xref table at `xref`; 0 when not readable here
+std::uint64_t xref_offset(const Windows& w, std::uint64_t xref, std::uint32_t num) {
+  const auto sec = w.from(xref, kQuickWindow);
+  if (!sec.starts_with("xref")) return 0;
+  std::size_t p = 4;
+  for (;;) {
+    while (p < sec.size() && std::isspace(static_cast<unsigned char>(sec[p]))) ++p;
+    if (p >= sec.size() || !std::isdigit(static_cast<unsigned char>(sec[p]))) return 0; // "trailer"
+    char* e = nullptr;
+    const std::string line(sec.substr(p, std::min<std::size_t>(32, sec.size() - p)));
+    const auto first = std::strtoul(line.c_str(), &e, 10);
+    const auto count = std::strtoul(e, &e, 10);
+    p += static_cast<std::size_t>(e - line.c_str());
+    while (p < sec.size() && sec[p] != '\n' && sec[p] != '\r') ++p;
+    while (p < sec.size() && (sec[p] == '\n' || sec[p] == '\r')) ++p;
+    if (num >= first && num < first + count) {
+      const auto entry = p + 20 * (num - first);
+      if (!fits(sec, entry, 18) || sec[entry + 17] != 'n') return 0;
+      return std::strtoull(std::string(sec.substr(entry, 10)).c_str(), nullptr, 10);
+    }
+    if (count > (sec.size() - p) / 20) return 0;
+    p += 20 * count;
+  }
+}
+
+void scan_pdf(const Windows& w, Scan& s) {
+  const auto end = w.whole() ? w.head() : w.tail();
+  // the last trailer is the newest; an xref stream has none (its dict is compressed away)
+  const auto tr = end.rfind("trailer"), sx = end.rfind("startxref");
+  std::uint32_t info = 0;
+  std::uint64_t xref = 0;
+  if (tr != std::string_view::npos) {
+    auto dict = end.substr(tr + 7, sx != std::string_view::npos && sx > tr ? sx - tr - 7 : std::string_view::npos);
+    dict.remove_prefix(std::min(dict.size(), dict.find("<<")));
+    pdf_entries(dict, [&](std::string_view key, std::string_view v) {
+      if (key == "/Info") info = static_cast<std::uint32_t>(std::strtoul(std::string(v).c_str(), nullptr, 10));
+    });
+  }
+  if (sx != std::string_view::npos) xref = std::strtoull(std::string(end.substr(sx + 9, 24)).c_str(), nullptr, 10);
+  bool found = false;
+  auto info_at = [&](std::string_view obj) {
+    const auto open = obj.find("<<");
+    if (open == std::string_view::npos || found) return;
+    pdf_info_keys(obj.substr(open), s);
+    found = true;
+  };
+  if (const auto off = info && xref < w.size() ? xref_offset(w, xref, info) : 0) info_at(w.from(off, 4096));
+  if (!found && info) {
+    // no usable xref table: the last definition of the object, as a rebuild would find it
+    const auto head = std::to_string(info) + " 0 obj";
+    for (auto win : {w.tail(), w.head()}) {
+      for (auto at = win.rfind(head); at != std::string_view::npos; at = at ? win.rfind(head, at - 1) : std::string_view::npos) {
+        if (at == 0 || pdf_space(win[at - 1])) { info_at(win.substr(at + head.size(), 4096)); break; }
+      }
+      if (found) break;
+    }
+  }
+  if (!found) {
+    // an xref stream, or an Info dict out of reach: whatever Info dict the windows show
+    for (auto win : {w.head(), w.tail()}) {
+      const auto at = win.find("/Producer");
+      const auto open = at == std::string_view::npos ? at : win.rfind("<<", at);
+      if (open == std::string_view::npos) continue;
+      pdf_info_keys(win.substr(open, 4096), s);
+      found = true;
+      break;
+    }
+  }
+  bool xmp = false;
+  for (auto win : {w.head(), w.tail()}) {
+    const auto at = win.find("<x:xmpmeta");
+    if (at == std::string_view::npos) continue;
+    const auto stop = win.find("</x:xmpmeta>", at);
+    scan_xmp(win.substr(at, stop == std::string_view::npos ? std::string_view::npos : stop - at), "XMP", s);
+    xmp = true;
+    break;
+  }
+  // Without the whole file the catalog's /Metadata stream can be anywhere; with it, a
+  // compressed packet or an Info dict inside an object stream still goes unread.
+  const auto has = [&](std::string_view what) { return w.head().find(what) != std::string_view::npos; };
+  s.complete = w.whole() && !has("/ObjStm") && (xmp || !has("/Metadata")) && (found || !info);
+}
+
+void scan_zip(const Windows& w, Scan& s) {
+  const auto t = w.whole() ? w.head() : w.tail();
+  if (t.size() < 22) return;
+  for (std::size_t p = t.size() - 22;; --p) {
+    if (t.compare(p, 4, "PK\x05\x06") == 0) {
+      const std::uint32_t comment = le(t, p + 20, 2), cd_size = le(t, p + 12, 4), cd_off = le(t, p + 16, 4);
+      const std::uint32_t entries = le(t, p + 10, 2);
+      s.block("central-directory");
+      if (comment) s.field("ZIP.", "ArchiveComment", "<archive comment>", "ZIP", comment);
+      const auto cd = w.at(cd_off, cd_size);
+      if (cd.size() != cd_size) return; // directory out of reach: per-file extras unknown
+      std::uint64_t extra = 0, with_extra = 0, comments = 0, with_comment = 0;
+      std::size_t q = 0;
+      for (std::uint32_t i = 0; i < entries && fits(cd, q, 46) && cd.compare(q, 4, "PK\x01\x02") == 0; ++i) {
+        const auto name = le(cd, q + 28, 2), ex = le(cd, q + 30, 2), cm = le(cd, q + 32, 2);
+        if (ex) { extra += ex; ++with_extra; }
+        if (cm) { comments += cm; ++with_comment; }
+        q += 46u + name + ex + cm;
+      }
+      if (with_extra) s.field("ZIP.", "ExtraFields", std::to_string(with_extra) + " files", "ZIP", extra);
+      if (with_comment) s.field("ZIP.", "FileComments", std::to_string(with_comment) + " files", "ZIP", comments);
+      s.complete = true;
+      return;
+    }
+    if (p == 0) return;
+  }
+}
+
+// ID3 frame or Vorbis comment name → the ID3 frame the audio backend reports it as
+std::string_view basic_frame(std::string_view id) {
+  if (id == "TIT2" || id == "TT2" || id == "TITLE") return "TIT2";
+  if (id == "TPE1" || id == "TP1" || id == "ARTIST") return "TPE1";
+  if (id == "TALB" || id == "TAL" || id == "ALBUM") return "TALB";
+  if (id == "TDRC" || id == "TYER" || id == "TYE" || id == "DATE") return "TDRC";
+  return {};
+}
+
+void audio_field(std::string_view frame, std::string v, std::string_view block, Scan& s) {
+  if (frame == "TDRC") v = v.substr(0, 4); // the backend reports the year
+  if (v.empty() || s.has(std::string("ID3.") + std::string(frame))) return;
+  const auto bytes = v.size();
+  s.field("ID3.", frame, std::move(v), block, bytes);
+}
+
+std::string id3_text(std::string_view f) {
+  if (f.empty()) return {};
+  const auto body = f.substr(1);
+  switch (f[0]) {
+    case 0: return latin1(until_nul(body));
+    case 1: return body.starts_with("\xFE\xFF") ? utf16(body.substr(2), true) : utf16(body.substr(body.starts_with("\xFF\xFE") ? 2 : 0), false);
+    case 2: return utf16(body, true);
+    default: return std::string(until_nul(body));
+  }
+}
+
+// Returns where the ID3v2 tag ends; the frames inside the window are read
+std::size_t scan_id3v2(std::string_view h, Scan& s) {
+  if (h.size() < 10 || !h.starts_with("ID3")) return 0;
+  const int ver = static_cast<unsigned char>(h[3]);
+  auto syncsafe = [&](std::size_t o) {
+    return std::size_t(h[o] & 0x7F) << 21 | std::size_t(h[o + 1] & 0x7F) << 14 | std::size_t(h[o + 2] & 0x7F) << 7 | std::size_t(h[o + 3] & 0x7F);
+  };
+  const std::size_t end = 10 + syncsafe(6) + ((h[5] & 0x10) ? 10 : 0);
+  s.block("ID3");
+  std::size_t p = 10;
+  if ((h[5] & 0x40) && fits(h, p, 4)) p += ver == 4 ? syncsafe(p) : 4 + be(h, p, 4);
+  const std::size_t id_len = ver == 2 ? 3 : 4, hdr = ver == 2 ? 6 : 10;
+  while (p + hdr <= std::min(end, h.size())) {
+    const auto id = h.substr(p, id_len);
+    if (id[0] == '\0') break; // padding
+    const std::size_t len = ver == 2 ? be(h, p + 3, 3) : ver == 4 ? syncsafe(p + 4) : be(h, p + 4, 4);
+    if (!fits(h, p + hdr, len)) break;
+    if (const auto frame = basic_frame(id); !frame.empty()) audio_field(frame, id3_text(h.substr(p + hdr, len)), "ID3", s);
+    p += hdr + len;
+  }
+  return end;
+}
+
+// Vorbis comment block (FLAC block 4, Ogg comment header); false when it runs past `c`
+bool scan_vorbis_comments(std::string_view c, Scan& s) {
+  s.block("Vorbis");
+  if (!fits(c, 0, 4)) return false;
+  std::size_t p = 4 + le(c, 0, 4);
+  if (!fits(c, p, 4)) return false;
+  const auto n = le(c, p, 4);
+  p += 4;
+  for (std::uint32_t i = 0; i < n; ++i) {
+    if (!fits(c, p, 4)) return false;
+    const std::size_t len = le(c, p, 4);
+    if (!fits(c, p + 4, len)) return false;
+    const auto entry = c.substr(p + 4, len);
+    p += 4 + len;
+    const auto eq = entry.find('=');
+    if (eq == std::string_view::npos) continue;
+    std::string name(entry.substr(0, eq));
+    for (auto& ch : name) ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+    if (const auto frame = basic_frame(name); !frame.empty()) audio_field(frame, std::string(entry.substr(eq + 1)), "Vorbis", s);
+  }
+  return true;
+}
+
+void scan_audio(const Windows& w, AudioKind kind, Scan& s) {
+  const auto h = w.head();
+  switch (kind) {
+    case AudioKind::MPEG: {
+      const auto end = scan_id3v2(h, s);
+      const auto v1 = w.at(w.size() >= 128 ? w.size() - 128 : 0, 128);
+      if (v1.size() == 128 && v1.starts_with("TAG")) {
+        s.block("ID3");
+        auto text = [&](std::size_t o, std::size_t n) {
+          auto t = until_nul(v1.substr(o, n));
+          return latin1(t.substr(0, t.find_last_not_of(' ') + 1));
+        };
+        audio_field("TIT2", text(3, 30), "ID3", s);
+        audio_field("TPE1", text(33, 30), "ID3", s);
+        audio_field("TALB", text(63, 30), "ID3", s);
+        audio_field("TDRC", text(93, 4), "ID3", s);
+      }
+      s.complete = end <= h.size();
+      return;
+    }
+    case AudioKind::FLAC: {
+      std::size_t p = h.starts_with("ID3") ? scan_id3v2(h, s) : 0;
+      if (!fits(h, p, 4) || h.compare(p, 4, "fLaC") != 0) return;
+      for (p += 4; fits(h, p, 4);) {
+        const bool last = (h[p] & 0x80) != 0;
+        const std::size_t len = be(h, p + 1, 3);
+        if (!fits(h, p + 4, len)) return;
+        if ((h[p] & 0x7F) == 4 && !scan_vorbis_comments(h.substr(p + 4, len), s)) return;
+        p += 4 + len;
+        if (last) { s.complete = true; return; }
+      }
+      return;
+    }
+    case AudioKind::Vorbis:
+    case AudioKind::Opus: {
+      const std::string_view magic = kind == AudioKind::Opus ? "OpusTags" : "\x03vorbis";
+      const auto at = h.find(magic);
+      if (at != std::string_view::npos) s.complete = scan_vorbis_comments(h.substr(at + magic.size()), s);
+      return;
+    }
+    default:
+      return; // MP4 keeps its tags in the moov box, which may be anywhere
+  }
+}
+
+} // anon
+
+InspectResult quick_inspect(const Detected& d) {
+  util::stats::inspected(static_cast<int>(d.type));
+  InspectResult ir;
+  ir.file = d.path;
+  ir.type = d.type;
+  Windows w;
+  Scan s{ir, d.max_value};
+  if (w.load(d)) {
+    util::stats::Timer t(util::stats::Phase::Parse, d.path);
+    const auto h = w.head();
+    switch (d.type) {
+      case FileType::Image:
+        if (h.starts_with("\xFF\xD8")) scan_jpeg(w, s);
+        else if (h.starts_with("\x89PNG")) scan_png(w, s);
+        else if (h.starts_with("RIFF")) scan_webp(w, s);
+        break;
+      case FileType::PDF:   scan_pdf(w, s); break;
+      case FileType::ZIP:   scan_zip(w, s); break;
+      case FileType::Audio: scan_audio(w, d.audio, s); break;
+      default: s.complete = true; break; // nothing to look for
+    }
+  }
+  for (auto& f : ir.fields) {
+    if (f.tag == RiskTag::None) continue;
+    std::string tag(tag_name(f.tag));
+    if (std::find(ir.risk_tags.begin(), ir.risk_tags.end(), tag) == ir.risk_tags.end()) ir.risk_tags.push_back(std::move(tag));
+  }
+  ir.confidence = s.complete ? "complete" : "partial";
+  return ir;
+}
+
+} // namespace core
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include "detect.hpp"
+
+// `inspect --quick`: first-pass triage that reads at most kQuickWindow bytes at each end
+// of a file and parses them without the backends' libraries. It finds what containers
+// keep near their start or end: JPEG APP segments, PNG chunks before IDAT, WebP chunks,
+// ID3v2/ID3v1, FLAC and Ogg comments, the ZIP end record and central directory, and the
+// PDF trailer's /Info dictionary. InspectResult::confidence says whether every place
+// the format can hold metadata was inside the windows ("complete") or not ("partial").
+namespace core {
+
+inline constexpr std::size_t kQuickWindow = 64u << 10;
+
+InspectResult quick_inspect(const Detected& d);
+
+}
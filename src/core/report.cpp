@@ -1,8 +1,9 @@
 #include "report.hpp"
 #include <fmt/format.h>
 #include <algorithm>
-#include <unordered_set>
 #include <cctype>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <string>
 #include <vector>
@@ -102,32 +103,28 @@ static int term_columns() {
 }
 
 // ---------- risk aggregation ----------
-struct RiskAgg { std::string verdict; std::vector<std::string> tags; };
-static RiskAgg aggregate(const InspectResult& r){
+std::string_view verdict(const InspectResult& r){
   bool any_high=false, any_med=false, any_low=false;
-  std::unordered_set<std::string> tags;
   for (auto& f : r.fields) {
     if (f.risk=="HIGH") any_high=true;
     else if (f.risk=="MEDIUM") any_med=true;
     else if (f.risk=="LOW") any_low=true;
-
-    const auto& c = f.canonical;
-    if (c.rfind("EXIF.GPS",0)==0) tags.insert("GPS");
-    else if (c=="EXIF.Model" || c=="EXIF.Make") tags.insert("Device");
-    else if (c=="XMP.CreatorTool") tags.insert("Software");
-    else if (c=="PDF.Author") tags.insert("Author");
-    else if (c=="PDF.Creator" || c=="PDF.Producer") tags.insert("Producer");
-    else if (c=="PDF.CreationDate" || c=="PDF.ModDate") tags.insert("Timestamps");
-    else if (c=="ID3.TPE1") tags.insert("Artist");
-    else if (c=="ID3.TDRC") tags.insert("Year");
-    else if (c=="ZIP.Comment") tags.insert("Comment");
   }
+  if (any_high) return "HIGH";
+  if (any_med) return "MEDIUM";
+  if (any_low) return "LOW";
+  return "NONE";
+}
+
+struct RiskAgg { std::string verdict; std::vector<std::string> tags; };
+static RiskAgg aggregate(const InspectResult& r){
+  std::uint32_t tags = 0; // bit per RiskTag
+  for (auto& f : r.fields) tags |= 1u << static_cast<unsigned>(f.tag);
   RiskAgg ra;
-  if (any_high) ra.verdict="HIGH";
-  else if (any_med) ra.verdict="MEDIUM";
-  else if (any_low) ra.verdict="LOW";
-  else ra.verdict="NONE";
-  ra.tags.assign(tags.begin(), tags.end());
+  ra.verdict = verdict(r);
+  for (unsigned t = 1; t <= static_cast<unsigned>(RiskTag::Comment); ++t) {
+    if (tags & (1u << t)) ra.tags.emplace_back(tag_name(static_cast<RiskTag>(t)));
+  }
   std::sort(ra.tags.begin(), ra.tags.end());
   return ra;
 }
@@ -167,19 +164,55 @@ static void print_border(const ColSpec& A,const ColSpec& B,const ColSpec& C,cons
   fmt::print("{}", line);
 }
 
+static void print_details(const InspectResult& r) {
+  fmt::print("{}\n", r.file);
+  for (auto& f : r.fields) {
+    fmt::print("  • {} = {} ({}) [{}]\n", f.canonical, f.value, f.risk, f.block);
+  }
+  auto ra = aggregate(r);
+  if (r.type==FileType::Image && (ra.verdict=="HIGH" || ra.verdict=="MEDIUM"))
+    fmt::print("Suggestion: `metasweep strip {} --safe`\n\n", r.file);
+  else if (r.type==FileType::PDF && !r.fields.empty())
+    fmt::print("Suggestion: `metasweep strip {}`\n\n", r.file);
+  else
+    fmt::print("\n");
+}
+
+static Row make_row(const InspectResult& r) {
+  auto ra = aggregate(r);
+  return {base_name(r.file), ftype(r.type), human_size(r.meta_bytes), join_csv(ra.tags), ra.verdict};
+}
+
+static void print_header(const ColSpec& A,const ColSpec& B,const ColSpec& C,const ColSpec& D,const ColSpec& E) {
+  print_border(A,B,C,D,E, TL, TM, TR);
+  fmt::print("│ {} │ {} │ {} │ {} │ {} │\n",
+    fit_left("File",    A.width),
+    fit_left("Type",    B.width),
+    fit_left("Meta size", C.width),
+    fit_left("Risk",    D.width),
+    fit_left("Verdict", E.width)
+  );
+  print_border(A,B,C,D,E, ML, MM, MR);
+}
+
+static void print_row(const Row& r, const ColSpec& A,const ColSpec& B,const ColSpec& C,const ColSpec& D,const ColSpec& E,
+                      bool enable_color) {
+  auto file_cell = fit_left(r.file,  A.width);
+  auto type_cell = fit_left(r.type,  B.width);
+  auto size_cell = (C.right ? fit_right(r.size, C.width) : fit_left(r.size, C.width));
+  auto risk_cell = fit_left(r.risk,  D.width);
+  auto verd_cell = fit_left(r.verd,  E.width);
+  verd_cell = colorize(enable_color, verd_cell, ansi_for_verdict(r.verd));
+
+  fmt::print("│ {} │ {} │ {} │ {} │ {} │\n",
+    file_cell, type_cell, size_cell, risk_cell, verd_cell
+  );
+}
+
 void print_inspection_batch(const std::vector<InspectResult>& results, int verbose, bool enable_color) {
   // Build rows from data
   std::vector<Row> rows; rows.reserve(results.size());
-  for (auto& r : results) {
-    auto ra = aggregate(r);
-    rows.push_back({
-      base_name(r.file),
-      ftype(r.type),
-      human_size(r.meta_bytes),
-      join_csv(ra.tags),
-      ra.verdict
-    });
-  }
+  for (auto& r : results) rows.push_back(make_row(r));
 
   // Natural widths from header + content
   ColSpec A,B,C,D,E; // File, Type, Size, Risk, Verdict
@@ -238,48 +271,131 @@ sized:
   // Draw table
   fmt::print("▶ Inspecting: {} file{}\n", results.size(), results.size()==1?"":"s");
 
-  print_border(A,B,C,D,E, TL, TM, TR);
-  fmt::print("│ {} │ {} │ {} │ {} │ {} │\n",
-    fit_left("File",    A.width),
-    fit_left("Type",    B.width),
-    fit_left("Meta size", C.width),
-    fit_left("Risk",    D.width),
-    fit_left("Verdict", E.width)
-  );
-  print_border(A,B,C,D,E, ML, MM, MR);
-
-  for (auto& r : rows) {
-    auto file_cell = fit_left(r.file,  A.width);
-    auto type_cell = fit_left(r.type,  B.width);
-    auto size_cell = (C.right ? fit_right(r.size, C.width) : fit_left(r.size, C.width));
-    auto risk_cell = fit_left(r.risk,  D.width);
-    auto verd_cell = fit_left(r.verd,  E.width);
-    verd_cell = colorize(enable_color, verd_cell, ansi_for_verdict(r.verd));
-
-    fmt::print("│ {} │ {} │ {} │ {} │ {} │\n",
-      file_cell, type_cell, size_cell, risk_cell, verd_cell
-    );
-  }
+  print_header(A,B,C,D,E);
+  for (auto& r : rows) print_row(r, A,B,C,D,E, enable_color);
   print_border(A,B,C,D,E, BL, BM, BR);
   fmt::print("\n");
 
   // Verbose per-file details
   if (verbose > 0) {
-    for (size_t i=0;i<results.size();++i) {
-      const auto& r = results[i];
-      fmt::print("{}\n", r.file);
-      for (auto& f : r.fields) {
-        fmt::print("  • {} = {} ({}) [{}]\n", f.canonical, f.value, f.risk, f.block);
-      }
-      auto ra = aggregate(r);
-      if (r.type==FileType::Image && (ra.verdict=="HIGH" || ra.verdict=="MEDIUM"))
-        fmt::print("Suggestion: `metasweep strip {} --safe`\n\n", r.file);
-      else if (r.type==FileType::PDF && !r.fields.empty())
-        fmt::print("Suggestion: `metasweep strip {}`\n\n", r.file);
-      else
-        fmt::print("\n");
+    for (auto& r : results) print_details(r);
+  }
+}
+
+// ---------- streaming table (--format stream) ----------
+TableStream::TableStream(bool color) : color_(color) {
+  // fixed widths: only the file column follows the terminal
+  const int tw = term_columns();
+  w_[1] = 7; w_[2] = 10; w_[3] = 24; w_[4] = 7;
+  const int rest = tw - (6 + (w_[1]+2) + (w_[2]+2) + (w_[3]+2) + (w_[4]+2)) - 2;
+  w_[0] = std::clamp(rest, 8, 64);
+}
+
+static void stream_specs(const int* w, ColSpec* c) {
+  for (int i = 0; i < 5; ++i) c[i].width = w[i];
+  c[2].right = true;
+}
+
+void TableStream::row(const InspectResult& r) {
+  ColSpec c[5];
+  stream_specs(w_, c);
+  if (!rows_++) print_header(c[0],c[1],c[2],c[3],c[4]);
+  print_row(make_row(r), c[0],c[1],c[2],c[3],c[4], color_);
+}
+
+void TableStream::finish() {
+  if (!rows_) return;
+  ColSpec c[5];
+  stream_specs(w_, c);
+  print_border(c[0],c[1],c[2],c[3],c[4], BL, BM, BR);
+  fmt::print("{} file{}\n\n", rows_, rows_==1?"":"s");
+}
+
+// ---------- fleet summary (--summary) ----------
+static unsigned verdict_rank(std::string_view v) {
+  return v == "HIGH" ? 3 : v == "MEDIUM" ? 2 : v == "LOW" ? 1 : 0;
+}
+
+// Keeps the `k` largest keys in a min-heap, so the smallest kept entry is evicted first
+static void keep_top(std::vector<FleetSummary::Ranked>& heap, std::size_t k, std::uint64_t key, const std::string& file) {
+  auto greater = [](const FleetSummary::Ranked& a, const FleetSummary::Ranked& b) { return a.key > b.key; };
+  if (heap.size() < k) {
+    heap.push_back({key, file});
+    std::push_heap(heap.begin(), heap.end(), greater);
+  } else if (k && key > heap.front().key) {
+    std::pop_heap(heap.begin(), heap.end(), greater);
+    heap.back() = {key, file};
+    std::push_heap(heap.begin(), heap.end(), greater);
+  }
+}
+
+void FleetSummary::add(const InspectResult& r) {
+  ++files_;
+  bytes_ += r.meta_bytes;
+  if (!r.duplicate_of.empty()) ++duplicates_;
+  auto& t = types_[static_cast<std::size_t>(r.type)];
+  ++t.files; t.bytes += r.meta_bytes;
+  const auto v = verdict_rank(verdict(r));
+  ++verdicts_[v].files; verdicts_[v].bytes += r.meta_bytes;
+  std::uint32_t tags = 0;
+  std::uint64_t at_verdict = 0; // fields as risky as the file's verdict
+  for (auto& f : r.fields) {
+    tags |= 1u << static_cast<unsigned>(f.tag);
+    if (verdict_rank(f.risk) == v) ++at_verdict;
+  }
+  for (unsigned i = 1; i < kTags; ++i) {
+    if (tags & (1u << i)) { ++tags_[i].files; tags_[i].bytes += r.meta_bytes; }
+  }
+  keep_top(by_size_, top_, r.meta_bytes, r.file);
+  // verdict first, then how many fields carry it, then size
+  if (v) keep_top(by_risk_, top_, std::uint64_t{v} << 56 | std::min<std::uint64_t>(at_verdict, 0xFFFF) << 40 |
+                                  std::min<std::uint64_t>(r.meta_bytes, (std::uint64_t{1} << 40) - 1), r.file);
+}
+
+static std::vector<FleetSummary::Ranked> sorted_desc(std::vector<FleetSummary::Ranked> v) {
+  std::sort(v.begin(), v.end(), [](auto& a, auto& b) { return a.key != b.key ? a.key > b.key : a.file < b.file; });
+  return v;
+}
+
+void FleetSummary::print(bool color) const {
+  fmt::print("▶ Summary: {} file{}, {} of metadata", files_, files_==1?"":"s", human_size(bytes_));
+  if (duplicates_) fmt::print(" ({} duplicate{})", duplicates_, duplicates_==1?"":"s");
+  fmt::print("\n\n");
+  auto line = [](const std::string& label, const Tally& t) {
+    fmt::print("  {:<12} {:>10} files {:>12}\n", label, t.files, human_size(t.bytes));
+  };
+  fmt::print("By type\n");
+  for (std::size_t i = 0; i < types_.size(); ++i) {
+    if (types_[i].files) line(ftype(static_cast<FileType>(i)), types_[i]);
+  }
+  fmt::print("\nBy verdict\n");
+  static constexpr const char* kVerdicts[] = {"NONE", "LOW", "MEDIUM", "HIGH"};
+  for (int i = 3; i >= 0; --i) {
+    if (!verdicts_[i].files) continue;
+    const auto label = fit_left(kVerdicts[i], 12);
+    fmt::print("  {} {:>10} files {:>12}\n", colorize(color, label, ansi_for_verdict(kVerdicts[i])),
+               verdicts_[i].files, human_size(verdicts_[i].bytes));
+  }
+  bool any_tag = false;
+  for (unsigned i = 1; i < kTags; ++i) {
+    if (!tags_[i].files) continue;
+    if (!any_tag) fmt::print("\nBy risk tag\n");
+    any_tag = true;
+    line(std::string(tag_name(static_cast<RiskTag>(i))), tags_[i]);
+  }
+  if (!by_size_.empty()) {
+    fmt::print("\nTop {} by metadata size\n", by_size_.size());
+    for (auto& e : sorted_desc(by_size_)) fmt::print("  {:>10}  {}\n", human_size(e.key), e.file);
+  }
+  if (!by_risk_.empty()) {
+    fmt::print("\nTop {} by risk\n", by_risk_.size());
+    for (auto& e : sorted_desc(by_risk_)) {
+      const auto v = kVerdicts[e.key >> 56];
+      fmt::print("  {}  {} field{}  {}\n", colorize(color, fit_left(v, 6), ansi_for_verdict(v)),
+                 (e.key >> 40) & 0xFFFF, ((e.key >> 40) & 0xFFFF)==1?"":"s", e.file);
     }
   }
+  fmt::print("\n");
 }
 
 
@@ -296,6 +412,17 @@ void print_summary(const InspectResult& before, const InspectResult& after, cons
   fmt::print("  before fields: {} | after fields: {}\n", before.fields.size(), after.fields.size());
 }
 
+void print_unchanged(const InspectResult& r, const std::string& out_path) {
+  if (out_path.empty() || out_path == r.file) fmt::print("Unchanged {}: nothing to drop\n", r.file);
+  else fmt::print("Linked {} → {} (nothing to drop)\n", r.file, out_path);
+  fmt::print("  fields: {}\n", r.fields.size());
+}
+
+void print_duplicate(const std::string& file, const std::string& of, const std::string& out_path) {
+  if (out_path.empty()) fmt::print("{}: duplicate of {}, same plan\n", file, of);
+  else fmt::print("Copied {} → {} (duplicate of {})\n", file, out_path, of);
+}
+
 void print_risks(const InspectResult& r, int /*verbose*/) {
   auto ra = aggregate(r);
   std::string tags = join_csv(ra.tags);
@@ -303,7 +430,7 @@ void print_risks(const InspectResult& r, int /*verbose*/) {
   fmt::print("Risks for {}: {} [{}]\n", r.file, vcol, tags);
 }
 
-static std::string json_escape(const std::string& s){
+std::string json_escape(const std::string& s){
   std::string o; o.reserve(s.size()+8);
   for(char c: s){
     switch(c){
@@ -318,7 +445,75 @@ static std::string json_escape(const std::string& s){
   return o;
 }
 
-static void json_write(std::ostream& f, const std::vector<InspectResult>& results){
+std::string report_order_key(const std::string& file) { return json_escape(file); }
+
+static std::string human_ns(std::uint64_t ns){
+  if (ns < 1000) return fmt::format("{} ns", ns);
+  if (ns < 1000000) return fmt::format("{:.1f} µs", ns / 1e3);
+  if (ns < 1000000000) return fmt::format("{:.1f} ms", ns / 1e6);
+  return fmt::format("{:.2f} s", ns / 1e9);
+}
+
+void print_stats(const util::stats::Totals& t) {
+  using util::stats::Phase;
+  fmt::print(stderr, "\n{:<8} {:>9} {:>10} {:>6} {:>10} {:>10} {:>10} {:>10}\n",
+             "Phase", "calls", "total", "%wall", "mean", "p50", "p99", "max");
+  for (int i = 0; i < util::stats::kPhases; ++i) {
+    auto p = static_cast<Phase>(i);
+    if (!t.calls[i]) continue;
+    double pct = t.wall_ns ? 100.0 * t.ns[i] / t.wall_ns : 0;
+    fmt::print(stderr, "{:<8} {:>9} {:>10} {:>5.1f}% {:>10} {:>10} {:>10} {:>10}\n",
+               util::stats::phase_name(p), t.calls[i], human_ns(t.ns[i]), pct,
+               human_ns(t.ns[i] / t.calls[i]), human_ns(util::stats::percentile(t, p, 0.5)),
+               human_ns(util::stats::percentile(t, p, 0.99)), human_ns(t.max_ns[i]));
+  }
+  fmt::print(stderr, "wall {} | read {} | written {}\n",
+             human_ns(t.wall_ns), human_size(t.bytes_read), human_size(t.bytes_written));
+  std::string per;
+  for (int k = 0; k < util::stats::kSlots; ++k) {
+    if (!t.inspected[k] && !t.stripped[k]) continue;
+    if (!per.empty()) per += ", ";
+    per += fmt::format("{} {}", ftype(static_cast<FileType>(k)), t.inspected[k]);
+    if (t.stripped[k]) per += fmt::format(" ({} stripped)", t.stripped[k]);
+  }
+  fmt::print(stderr, "files: {}\n", per.empty() ? "-" : per);
+}
+
+static void stats_json(std::ostream& f, const util::stats::Totals& t){
+  f << "  \"stats\": {\n";
+  f << "    \"wall_ns\": " << t.wall_ns << ",\n";
+  f << "    \"bytes_read\": " << t.bytes_read << ",\n";
+  f << "    \"bytes_written\": " << t.bytes_written << ",\n";
+  f << "    \"files\": {";
+  bool first = true;
+  for (int k = 0; k < util::stats::kSlots; ++k) {
+    if (!t.inspected[k] && !t.stripped[k]) continue;
+    f << (first ? "" : ", ") << "\"" << ftype(static_cast<FileType>(k)) << "\": {\"inspected\": "
+      << t.inspected[k] << ", \"stripped\": " << t.stripped[k] << "}";
+    first = false;
+  }
+  f << "},\n";
+  f << "    \"phases\": {\n";
+  first = true;
+  for (int i = 0; i < util::stats::kPhases; ++i) {
+    if (!t.calls[i]) continue;
+    auto p = static_cast<util::stats::Phase>(i);
+    if (!first) f << ",\n";
+    first = false;
+    f << "      \"" << util::stats::phase_name(p) << "\": {\"calls\": " << t.calls[i]
+      << ", \"total_ns\": " << t.ns[i] << ", \"max_ns\": " << t.max_ns[i]
+      << ", \"p50_ns\": " << util::stats::percentile(t, p, 0.5)
+      << ", \"p99_ns\": " << util::stats::percentile(t, p, 0.99) << ", \"log2_ns_hist\": [";
+    int last = util::stats::kBuckets - 1;
+    while (last > 0 && !t.hist[i][last]) --last;
+    for (int b = 0; b <= last; ++b) f << (b ? "," : "") << t.hist[i][b];
+    f << "]}";
+  }
+  f << "\n    }\n  }";
+}
+
+static void json_write(std::ostream& f, const std::vector<InspectResult>& results,
+                       const util::stats::Totals* stats){
   f << "{\n  \"files\": [\n";
   for (size_t i=0;i<results.size();++i){
     const auto& r = results[i];
@@ -332,6 +527,9 @@ static void json_write(std::ostream& f, const std::vector<InspectResult>& result
     }
     f << "],\n";
     f << "      \"meta_bytes\": " << r.meta_bytes << ",\n";
+    if (!r.duplicate_of.empty()) f << "      \"duplicate_of\": \"" << json_escape(r.duplicate_of) << "\",\n";
+    if (!r.status.empty()) f << "      \"status\": \"" << r.status << "\",\n";
+    if (!r.confidence.empty()) f << "      \"confidence\": \"" << r.confidence << "\",\n";
     f << "      \"fields\": [\n";
     for (size_t k=0;k<r.fields.size();++k) {
       const auto& fld = r.fields[k];
@@ -348,21 +546,262 @@ static void json_write(std::ostream& f, const std::vector<InspectResult>& result
     if (i+1<results.size()) f << ",";
     f << "\n";
   }
-  f << "  ]\n}\n";
+  f << "  ]";
+  if (stats) { f << ",\n"; stats_json(f, *stats); }
+  f << "\n}\n";
 }
 
-void write_json_report(const std::vector<InspectResult>& results, const std::string& path){
+void write_json_report(const std::vector<InspectResult>& results, const std::string& path,
+                       const util::stats::Totals* stats){
   std::ofstream f(path, std::ios::binary|std::ios::trunc);
-  json_write(f, results);
+  json_write(f, results, stats);
 }
 
-void write_json_report_stream(std::ostream& os, const std::vector<InspectResult>& results){
-  json_write(os, results);
+void write_json_report_stream(std::ostream& os, const std::vector<InspectResult>& results,
+                              const util::stats::Totals* stats){
+  json_write(os, results, stats);
 }
 
 
-// simple placeholders
-std::string to_json(const InspectResult&) { return "{}"; }
+std::string to_json(const InspectResult& r) {
+  std::string o;
+  o.reserve(128 + r.fields.size() * 96);
+  o += "{\"file\":\""; o += json_escape(r.file);
+  o += "\",\"type\":\""; o += ftype(r.type);
+  o += "\",\"detected\":[";
+  for (size_t j=0;j<r.detected_blocks.size();++j) {
+    if (j) o += ',';
+    o += '"'; o += json_escape(r.detected_blocks[j]); o += '"';
+  }
+  o += "],\"meta_bytes\":"; o += std::to_string(r.meta_bytes);
+  if (!r.duplicate_of.empty()) { o += ",\"duplicate_of\":\""; o += json_escape(r.duplicate_of); o += '"'; }
+  if (!r.status.empty()) { o += ",\"status\":\""; o += r.status; o += '"'; }
+  if (!r.confidence.empty()) { o += ",\"confidence\":\""; o += r.confidence; o += '"'; }
+  o += ",\"fields\":[";
+  for (size_t k=0;k<r.fields.size();++k) {
+    const auto& fld = r.fields[k];
+    if (k) o += ',';
+    o += "{\"name\":\""; o += json_escape(fld.canonical);
+    o += "\",\"value\":\""; o += json_escape(fld.value);
+    o += "\",\"risk\":\""; o += json_escape(fld.risk);
+    o += "\",\"block\":\""; o += json_escape(fld.block);
+    o += "\",\"bytes\":"; o += std::to_string(fld.bytes);
+    o += '}';
+  }
+  o += "]}";
+  return o;
+}
+
+// ---- report merge ----
+
+// Reads the file entries of a JSON report (`{"files": [...], ...}`) or of NDJSON (one
+// entry object per line) one at a time. Entries come back compacted to a single line;
+// the report's other keys ("stats") are skipped.
+namespace {
+class ReportReader {
+public:
+  ReportReader() = default;
+  ~ReportReader() { if (f_) std::fclose(f_); }
+  ReportReader(const ReportReader&) = delete;
+  ReportReader& operator=(const ReportReader&) = delete;
+  bool open(const std::string& path) {
+    f_ = std::fopen(path.c_str(), "rb");
+    buf_.resize(64 * 1024);
+    return f_ != nullptr;
+  }
+  bool bad() const { return bad_; }
+  std::uint64_t offset() const { return read_ - (len_ - pos_); }
+  // Next entry and its "file" value, still escaped but unquoted: report_order_key(file).
+  bool next(std::string& entry, std::string& file) {
+    entry.clear();
+    file.clear();
+    for (;;) {
+      ws();
+      if (in_files_) {
+        if (peek() == ']') {
+          get();
+          in_files_ = false;
+          if (!skip_tail()) return fail();
+          continue;
+        }
+        if (!first_ && get() != ',') return fail();
+        first_ = false;
+        ws();
+        if (get() != '{') return fail();
+        return object(entry, file, false);
+      }
+      const int c = get();
+      if (c == EOF) return false;
+      if (c != '{') return fail();
+      // a report document or an NDJSON entry: the first key tells
+      ws();
+      if (peek() == '}') { get(); continue; }
+      std::string key;
+      if (!member_key(key)) return fail();
+      if (key == "\"files\"") {
+        if (get() != '[') return fail();
+        in_files_ = first_ = true;
+        continue;
+      }
+      return object(entry, file, true, key);
+    }
+  }
+
+private:
+  int peek() {
+    if (pos_ == len_) {
+      len_ = std::fread(buf_.data(), 1, buf_.size(), f_);
+      read_ += len_;
+      pos_ = 0;
+      if (!len_) return EOF;
+    }
+    return static_cast<unsigned char>(buf_[pos_]);
+  }
+  int get() {
+    const int c = peek();
+    if (c != EOF) ++pos_;
+    return c;
+  }
+  void ws() {
+    for (int c = peek(); c == ' ' || c == '\n' || c == '\r' || c == '\t'; c = peek()) get();
+  }
+  bool fail() { bad_ = true; return false; }
+  // A string, quotes and escapes kept as they are
+  bool string(std::string* out) {
+    if (get() != '"') return false;
+    if (out) *out += '"';
+    for (;;) {
+      int c = get();
+      if (c == EOF) return false;
+      if (out) *out += static_cast<char>(c);
+      if (c == '"') return true;
+      if (c == '\\') {
+        if ((c = get()) == EOF) return false;
+        if (out) *out += static_cast<char>(c);
+      }
+    }
+  }
+  // Any value, with the whitespace outside strings dropped
+  bool value(std::string* out) {
+    int depth = 0;
+    do {
+      ws();
+      const int c = peek();
+      if (c == EOF) return false;
+      if (c == '"') { if (!string(out)) return false; continue; }
+      if (depth == 0 && c != '{' && c != '[') {
+        // a bare scalar (number, true, false, null)
+        for (int d = peek(); d != EOF && d != ',' && d != '}' && d != ']' && !std::isspace(d); d = peek()) {
+          if (out) *out += static_cast<char>(get());
+          else get();
+        }
+        return true;
+      }
+      get();
+      if (c == '{' || c == '[') ++depth;
+      else if (c == '}' || c == ']') --depth;
+      if (out) *out += static_cast<char>(c);
+    } while (depth > 0);
+    return true;
+  }
+  bool member_key(std::string& key) {
+    if (!string(&key)) return false;
+    ws();
+    if (get() != ':') return false;
+    ws();
+    return true;
+  }
+  // The members of an entry object whose '{' was read; `have_key`: its first key too
+  bool object(std::string& entry, std::string& file, bool have_key, std::string key = {}) {
+    entry += '{';
+    if (!have_key) {
+      ws();
+      if (peek() == '}') { get(); entry += '}'; return true; }
+      if (!member_key(key)) return fail();
+    }
+    for (;;) {
+      entry += key;
+      entry += ':';
+      if (key == "\"file\"" && peek() == '"') {
+        const auto at = entry.size();
+        if (!string(&entry)) return fail();
+        file.assign(entry, at + 1, entry.size() - at - 2);
+      } else if (!value(&entry)) {
+        return fail();
+      }
+      ws();
+      const int c = get();
+      if (c == '}') { entry += '}'; return true; }
+      if (c != ',') return fail();
+      entry += ',';
+      ws();
+      key.clear();
+      if (!member_key(key)) return fail();
+    }
+  }
+  // The report's keys after "files", up to its closing brace
+  bool skip_tail() {
+    for (;;) {
+      ws();
+      const int c = get();
+      if (c == '}') return true;
+      if (c != ',') return false;
+      ws();
+      std::string key;
+      if (!member_key(key) || !value(nullptr)) return false;
+    }
+  }
+
+  std::FILE* f_ = nullptr;
+  std::vector<char> buf_;
+  std::size_t pos_ = 0, len_ = 0;
+  std::uint64_t read_ = 0;
+  bool in_files_ = false, first_ = false, bad_ = false;
+};
+} // namespace
+
+bool merge_reports(const std::vector<std::string>& inputs, std::ostream& os, bool ndjson, std::string& err) {
+  struct Head { std::string file, entry; std::size_t input; };
+  std::vector<ReportReader> readers(inputs.size());
+  std::vector<Head> heap;
+  auto later = [](const Head& a, const Head& b) {
+    return a.file != b.file ? a.file > b.file : a.input > b.input;
+  };
+  auto pull = [&](std::size_t i, Head h) {
+    h.input = i;
+    if (readers[i].next(h.entry, h.file)) {
+      heap.push_back(std::move(h));
+      std::push_heap(heap.begin(), heap.end(), later);
+      return true;
+    }
+    if (!readers[i].bad()) return true;
+    err = fmt::format("{}: malformed report near byte {}", inputs[i], readers[i].offset());
+    return false;
+  };
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    if (!readers[i].open(inputs[i])) { err = fmt::format("{}: cannot open", inputs[i]); return false; }
+    if (!pull(i, {})) return false;
+  }
+  // Sharded runs write their reports sorted by report_order_key; taking the smallest head
+  // each time keeps that order, and gives the same output for the same inputs.
+  if (!ndjson) os << "{\n  \"files\": [\n";
+  bool first = true;
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), later);
+    Head h = std::move(heap.back());
+    heap.pop_back();
+    if (ndjson) os << h.entry << '\n';
+    else os << (first ? "    " : ",\n    ") << h.entry;
+    first = false;
+    if (!pull(h.input, std::move(h))) return false;
+  }
+  if (!ndjson) os << (first ? "" : "\n") << "  ]\n}\n";
+  os.flush();
+  if (!os) { err = "write failed"; return false; }
+  return true;
+}
+
+// simple placeholder
 std::string to_html(const InspectResult&) { return "<!-- TODO -->"; }
 
 } // namespace core
@@ -1,30 +1,96 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <ostream>
 #include <vector>
 #include "detect.hpp"
 #include "policy.hpp"
+#include "util/stats.hpp"
 
 namespace core {
 
 // Pretty batch table like the sample, then per-file details if verbose > 0
 void print_inspection_batch(const std::vector<InspectResult>& results, int verbose, bool color);
 
+// `--format stream`: the same table with fixed column widths, printed a row at a time as
+// results arrive, so nothing is buffered for the layout.
+class TableStream {
+public:
+  explicit TableStream(bool color);
+  void row(const InspectResult&);
+  void finish(); // bottom border and file count
+private:
+  int w_[5]{};
+  std::uint64_t rows_ = 0;
+  bool color_;
+};
+
+// `--summary`: results are folded into counts and bytes by type, verdict and risk tag,
+// plus the top files by metadata size and by risk; memory stays constant over the run.
+class FleetSummary {
+public:
+  struct Ranked { std::uint64_t key; std::string file; };
+  explicit FleetSummary(std::size_t top = 10) : top_(top) {}
+  void add(const InspectResult&);
+  void print(bool color) const;
+private:
+  static constexpr unsigned kTags = static_cast<unsigned>(RiskTag::Comment) + 1;
+  struct Tally { std::uint64_t files = 0, bytes = 0; };
+  std::size_t top_;
+  std::uint64_t files_ = 0, bytes_ = 0, duplicates_ = 0;
+  std::array<Tally, static_cast<std::size_t>(FileType::ZIP) + 1> types_{};
+  std::array<Tally, 4> verdicts_{}; // NONE, LOW, MEDIUM, HIGH
+  std::array<Tally, kTags> tags_{};
+  std::vector<Ranked> by_size_, by_risk_; // min-heaps of at most `top_` entries
+};
+
 // Dry-run plan
 void print_plan(const InspectResult&, const Policy&);
 
 // Strip summary
 void print_summary(const InspectResult& before, const InspectResult& after, const std::string& out_path);
 
+// The plan dropped nothing: `out_path` is the input (in place) or a link to it
+void print_unchanged(const InspectResult&, const std::string& out_path);
+
+// --dedup: `file` has the same content as `of`; `out_path` empty for a dry run
+void print_duplicate(const std::string& file, const std::string& of, const std::string& out_path);
+
+// Highest field risk: HIGH|MEDIUM|LOW, or NONE without fields
+std::string_view verdict(const InspectResult&);
+
 // Risks for a single file (used by `explain`)
 void print_risks(const InspectResult&, int verbose);
 
-// JSON report helpers
-void write_json_report(const std::vector<InspectResult>& results, const std::string& path);
-void write_json_report_stream(std::ostream& os, const std::vector<InspectResult>& results);
+// `--stats` summary table (stderr)
+void print_stats(const util::stats::Totals&);
+
+// JSON report helpers; `stats` adds a top-level "stats" object when non-null
+void write_json_report(const std::vector<InspectResult>& results, const std::string& path,
+                       const util::stats::Totals* stats = nullptr);
+void write_json_report_stream(std::ostream& os, const std::vector<InspectResult>& results,
+                              const util::stats::Totals* stats = nullptr);
+
+// `report merge`: folds per-shard reports (JSON reports or NDJSON, one entry per line) into
+// one JSON report, or NDJSON with `ndjson`, by repeatedly taking the smallest file among
+// the inputs' next entries. The result is ordered by file when every input is, as shard
+// reports are. Each input is read an entry at a time, so memory is bounded by the number
+// of inputs. Per-shard "stats" are dropped.
+// False with `err` set on an unreadable or malformed input.
+bool merge_reports(const std::vector<std::string>& inputs, std::ostream& os, bool ndjson, std::string& err);
+
+// Escape for a JSON string body (no surrounding quotes)
+std::string json_escape(const std::string&);
+
+// What shard reports are sorted by and `report merge` compares: the file as its "file"
+// value is written (JSON-escaped, without the quotes), so merging needs no decoding.
+std::string report_order_key(const std::string& file);
 
-// (stubs for later)
+// One file as a single-line JSON object (same keys as a report entry)
 std::string to_json(const InspectResult&);
+// (stub for later)
 std::string to_html(const InspectResult&);
 
 }
@@ -1,24 +1,24 @@
 #include "sanitize.hpp"
-#ifdef HAVE_EXIV2
-#include "../backends/image_exiv2.hpp"
-#endif
-#include "../backends/pdf_info.hpp"
-#ifdef HAVE_TAGLIB
-#include "../backends/audio_taglib.hpp"
-#endif
-#include "../backends/zip_minizip.hpp"
+#include <algorithm>
+#include "../backends/registry.hpp"
+#include "util/stats.hpp"
 
 namespace core {
 
+// Backends that format values cheaply fill them whole; the limit is applied here
+static InspectResult clip_values(InspectResult&& r, std::size_t max) {
+  if (max != kAllValues) {
+    for (auto& f : r.fields) clip_value(f.value, max);
+  }
+  return std::move(r);
+}
+
 InspectResult inspect(const Detected& d) {
-#ifdef HAVE_EXIV2
-  if (backends::image_can_handle(d)) return backends::image_inspect(d);
-#endif
-  if (backends::pdf_can_handle(d))   return backends::pdf_inspect(d);
-#ifdef HAVE_TAGLIB
-  if (backends::audio_can_handle(d)) return backends::audio_inspect(d);
-#endif
-  if (backends::zip_can_handle(d))   return backends::zip_inspect(d);
+  util::stats::inspected(static_cast<int>(d.type));
+  if (auto* b = backends::find(d.type)) {
+    backends::Slot slot(*b);
+    return clip_values(b->inspect(d), d.max_value);
+  }
 
   InspectResult ir; ir.file=d.path; ir.type=d.type; return ir;
 }
@@ -26,18 +26,105 @@ InspectResult inspect(const Detected& d) {
 InspectResult strip_to(const std::string& in_path,
                        const std::string& out_path,
                        const Policy& policy) {
-  Detected d = detect_file(in_path);
-#ifdef HAVE_EXIV2
-  if (backends::image_can_handle(d)) return backends::image_strip_to(in_path, out_path, policy);
-#endif
-  if (backends::pdf_can_handle(d))   return backends::pdf_strip_to(in_path, out_path, policy);
-#ifdef HAVE_TAGLIB
-  if (backends::audio_can_handle(d)) return backends::audio_strip_to(in_path, out_path, policy);
-#endif
-  if (backends::zip_can_handle(d))   return backends::zip_strip_to(in_path, out_path, policy);
-
-  (void)policy;
-  Detected just{in_path, d.type, {}}; return inspect(just);
+  Detected d;
+  {
+    util::stats::Timer t(util::stats::Phase::Detect, in_path);
+    d = detect_file(in_path);
+  }
+  return strip_to(d, out_path, policy);
+}
+
+std::uint64_t estimate_footprint(const std::string& path, std::uint64_t size, bool strip, bool preloaded) {
+  constexpr std::uint64_t kBase = 256u << 10;   // result, fields, stream buffers
+  constexpr std::uint64_t kPdfMax = 1ull << 28; // pdf read_all refuses larger files
+  const std::uint64_t pre = preloaded ? size : 0;
+  switch (guess_type(path)) {
+    case FileType::PDF:
+      if (size > kPdfMax) return kBase + pre;
+      return kBase + pre + size;                  // whole-file buffer (strip copies the preload)
+    case FileType::ZIP:
+      return kBase + pre + size;                  // whole-file buffer
+    case FileType::Image:
+      // Exiv2 reads only the metadata segments from disk but copies a MemIo input and
+      // rebuilds the whole image in memory on write
+      return kBase + 2 * pre + (strip ? size : std::min<std::uint64_t>(size, 16u << 20));
+    case FileType::Audio:
+      switch (guess_audio(path)) {
+        case AudioKind::MPEG:
+        case AudioKind::FLAC:
+          return kBase + 2 * pre + (1u << 20);    // TagLib touches the tag blocks only
+        default:
+          // other containers are stripped whole in memory (about three copies)
+          return kBase + 2 * pre + (strip ? 3 * size : (1u << 20));
+      }
+    default:
+      return kBase + size;                        // unknown extension: assume one full read
+  }
+}
+
+InspectResult strip_to(const Detected& d,
+                       const std::string& out_path,
+                       const Policy& policy) {
+  util::stats::stripped(static_cast<int>(d.type));
+  if (auto* b = backends::find(d.type)) {
+    backends::Slot slot(*b);
+    return clip_values(b->strip_to(d, out_path, policy), d.max_value);
+  }
+  return inspect(d);
+}
+
+util::Lanes backend_lanes(const std::vector<std::string>& paths) {
+  util::Lanes l;
+  l.of = [&paths](std::size_t i) { return static_cast<std::size_t>(guess_type(paths[i])); };
+  l.limit.assign(backends::kTypes, 0);
+  for (std::size_t t = 0; t < backends::kTypes; ++t) {
+    if (auto* b = backends::find(static_cast<FileType>(t))) l.limit[t] = b->limit();
+  }
+  return l;
+}
+
+bool can_strip(const Detected& d) {
+  return backends::find(d.type) != nullptr;
+}
+
+bool plan_drops(const InspectResult& r, const Policy& policy) {
+  util::stats::Timer t(util::stats::Phase::Policy, r.file);
+  auto any = [&](auto&& pred) { return std::any_of(r.fields.begin(), r.fields.end(), pred); };
+  auto keeps_all = [&](std::string_view prefix) { return block_action(policy, prefix) == BlockAction::KeepAll; };
+  switch (r.type) {
+    case FileType::Image: { // Exiv2 erases each field the policy does not keep
+      const BlockAction blocks[] = {block_action(policy, "EXIF."), block_action(policy, "XMP."),
+                                    block_action(policy, "IPTC.")};
+      return any([&](const Field& f) {
+        const auto b = f.block == "EXIF" ? blocks[0] : f.block == "XMP" ? blocks[1]
+                     : f.block == "IPTC" ? blocks[2] : BlockAction::Mixed;
+        return b == BlockAction::Mixed ? !policy_keep(policy, f.canonical) : b == BlockAction::DropAll;
+      });
+    }
+    case FileType::PDF: { // the /Info keys are blanked in place, so "()" is already clean
+      const bool info = !keeps_all("PDF."), xmp = !keeps_all("XMP.");
+      return any([&](const Field& f) { return f.value_bytes && (f.block == "XMP" ? xmp : info); });
+    }
+    case FileType::ZIP:   // only the archive comment is cleared
+      return !keeps_all("ZIP.") && any([](const Field& f) { return f.canonical == "ZIP.Comment"; });
+    case FileType::Audio: // MP3 loses its whole ID3 and APE tags, including frames inspect does not list
+      return !keeps_all("ID3.") &&
+             (!r.fields.empty() ||
+              std::find(r.detected_blocks.begin(), r.detected_blocks.end(), "ID3") != r.detected_blocks.end());
+    default:
+      return !r.fields.empty();
+  }
+}
+
+InspectResult strip_buffer(const Detected& d, const Policy& policy, std::string& out) {
+  util::stats::stripped(static_cast<int>(d.type));
+  out.clear();
+  if (auto* b = backends::find(d.type)) {
+    backends::Slot slot(*b);
+    return clip_values(b->strip_buffer(d, policy, out), d.max_value);
+  }
+
+  return inspect(d);
 }
 
 }
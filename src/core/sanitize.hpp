@@ -1,11 +1,38 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <vector>
 #include "detect.hpp"
 #include "policy.hpp"
+#include "util/sched.hpp"
 
 namespace core {
 // strip_to dispatches by type; for unimplemented types, returns InspectResult of input with note
 InspectResult strip_to(const std::string& in_path,
                        const std::string& out_path,
                        const Policy& policy);
+// Same, for an already detected (possibly preloaded) input.
+InspectResult strip_to(const Detected& in,
+                       const std::string& out_path,
+                       const Policy& policy);
+// True when a backend strips `in` (strip_to writes an output); false for types that
+// pass through untouched.
+bool can_strip(const Detected& in);
+// True when stripping `r` under `policy` would change the file, judged from the
+// inspection alone and erring towards a rewrite.
+bool plan_drops(const InspectResult& r, const Policy& policy);
+
+// In-memory strip: `out` receives the cleaned file and the result describes it. `out`
+// is left empty when nothing could be produced (unreadable input, or a type without a
+// stripper), as strip_to writes no file then.
+InspectResult strip_buffer(const Detected& in, const Policy& policy, std::string& out);
+
+// Rough peak heap use of inspecting (strip=false) or stripping `path`, `size` bytes, with
+// its type guessed from the extension; the --max-memory scheduler reserves this before
+// dispatch. `preloaded` adds the --io uring buffer.
+std::uint64_t estimate_footprint(const std::string& path, std::uint64_t size, bool strip, bool preloaded);
+
+// Scheduler lanes for `paths` (which must outlive them): one per file type, guessed from
+// the extension, capped by the concurrency limit of the backend registered for it.
+util::Lanes backend_lanes(const std::vector<std::string>& paths);
 }
@@ -0,0 +1,137 @@
+#include "text.hpp"
+#include <cstdint>
+#include <utility>
+
+namespace core {
+namespace {
+
+bool xml_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+void put_utf8(std::string& o, std::uint32_t cp) {
+  if (cp < 0x80) o += char(cp);
+  else if (cp < 0x800) { o += char(0xC0 | cp >> 6); o += char(0x80 | (cp & 0x3F)); }
+  else if (cp < 0x10000) {
+    o += char(0xE0 | cp >> 12); o += char(0x80 | (cp >> 6 & 0x3F)); o += char(0x80 | (cp & 0x3F));
+  } else {
+    o += char(0xF0 | cp >> 18); o += char(0x80 | (cp >> 12 & 0x3F));
+    o += char(0x80 | (cp >> 6 & 0x3F)); o += char(0x80 | (cp & 0x3F));
+  }
+} // namespace core
+
+int hex_val(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+} // namespace core
+
+} // namespace
+
+std::string xml_text(std::string_view v) {
+  static constexpr std::pair<std::string_view, char> kEntities[] = {
+    {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+  std::string o;
+  o.reserve(v.size());
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    if (v[i] != '&') { o += v[i]; continue; }
+    bool hit = false;
+    for (auto [ent, ch] : kEntities) {
+      if (v.substr(i, ent.size()) == ent) { o += ch; i += ent.size() - 1; hit = true; break; }
+    }
+    if (!hit) o += '&';
+  }
+  const auto b = o.find_first_not_of(" \t\r\n");
+  return b == std::string::npos ? std::string() : o.substr(b, o.find_last_not_of(" \t\r\n") - b + 1);
+} // namespace core
+
+std::string xmp_value(std::string_view x, std::string_view qname) {
+  for (std::size_t p = x.find(qname); p != std::string_view::npos; p = x.find(qname, p + 1)) {
+    if (p == 0) continue;
+    const char before = x[p - 1];
+    const std::size_t after = p + qname.size();
+    if (after >= x.size()) break;
+    if (xml_space(before) && x[after] == '=' && after + 1 < x.size()) {
+      const auto end = x.find(x[after + 1], after + 2);
+      if (end == std::string_view::npos) break;
+      return xml_text(x.substr(after + 2, end - after - 2));
+    }
+    if (before != '<' || !(x[after] == '>' || x[after] == '/' || xml_space(x[after]))) continue;
+    const auto open_end = x.find('>', after);
+    if (open_end == std::string_view::npos || x[open_end - 1] == '/') return {};
+    const auto close_at = x.find("</" + std::string(qname) + ">", open_end);
+    if (close_at == std::string_view::npos) return {};
+    const auto inner = x.substr(open_end + 1, close_at - open_end - 1);
+    if (inner.find("<rdf:li") == std::string_view::npos) return xml_text(inner);
+    std::string out;
+    for (auto li = inner.find("<rdf:li"); li != std::string_view::npos; li = inner.find("<rdf:li", li + 1)) {
+      const auto b = inner.find('>', li), e = inner.find("</rdf:li>", b);
+      if (b == std::string_view::npos || e == std::string_view::npos) break;
+      auto item = xml_text(inner.substr(b + 1, e - b - 1));
+      if (item.empty()) continue;
+      if (!out.empty()) out += "; ";
+      out += item;
+    }
+    return out;
+  }
+  return {};
+} // namespace core
+
+bool pdf_string(std::string_view v, std::string& out) {
+  std::string raw;
+  if (v.size() >= 2 && v.front() == '(' && v.back() == ')') {
+    v = v.substr(1, v.size() - 2);
+    for (std::size_t i = 0; i < v.size(); ++i) {
+      if (v[i] != '\\' || i + 1 == v.size()) { raw += v[i]; continue; }
+      const char c = v[++i];
+      switch (c) {
+        case 'n': raw += '\n'; break;
+        case 'r': raw += '\r'; break;
+        case 't': raw += '\t'; break;
+        case 'b': raw += '\b'; break;
+        case 'f': raw += '\f'; break;
+        case '\r': if (i + 1 < v.size() && v[i + 1] == '\n') ++i; break; // line continuation
+        case '\n': break;
+        default:
+          if (c >= '0' && c <= '7') {
+            int o = c - '0';
+            for (int k = 0; k < 2 && i + 1 < v.size() && v[i + 1] >= '0' && v[i + 1] <= '7'; ++k) {
+              o = o * 8 + (v[++i] - '0');
+            }
+            raw += char(o & 0xFF);
+          } else {
+            raw += c;
+          }
+      }
+    }
+  } else if (v.size() >= 2 && v.front() == '<' && v[1] != '<' && v.back() == '>') {
+    int hi = -1;
+    for (char c : v.substr(1, v.size() - 2)) {
+      const int h = hex_val(c);
+      if (h < 0) continue;
+      if (hi < 0) hi = h;
+      else { raw += char(hi << 4 | h); hi = -1; }
+    }
+    if (hi >= 0) raw += char(hi << 4);
+  } else {
+    return false;
+  }
+  out.clear();
+  if (raw.size() >= 2 && raw[0] == '\xFE' && raw[1] == '\xFF') {
+    for (std::size_t i = 2; i + 1 < raw.size(); i += 2) {
+      std::uint32_t u = std::uint32_t(static_cast<unsigned char>(raw[i])) << 8 | static_cast<unsigned char>(raw[i + 1]);
+      if (u >= 0xD800 && u < 0xDC00 && i + 3 < raw.size()) {
+        const std::uint32_t lo = std::uint32_t(static_cast<unsigned char>(raw[i + 2])) << 8 |
+                                 static_cast<unsigned char>(raw[i + 3]);
+        if (lo >= 0xDC00 && lo < 0xE000) { u = 0x10000 + ((u - 0xD800) << 10) + (lo - 0xDC00); i += 2; }
+      }
+      put_utf8(out, u);
+    }
+  } else if (raw.size() >= 3 && raw.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+    out = raw.substr(3);
+  } else {
+    out = std::move(raw);
+  }
+  return true;
+} // namespace core
+
+} // namespace core
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Metadata text read by more than one reader: XMP packets, scanned without an XML parser
+// by the PDF backend and by inspect --quick, and PDF string objects, from the backend's
+// Info dictionary and from quick's trailer scan. Both report the same values this way.
+namespace core {
+
+// XMP properties worth reporting, by qualified name (also their native keys in fields.hpp)
+inline constexpr std::string_view kXmpProps[] = {
+  "dc:title", "dc:creator", "dc:description",
+  "xmp:CreatorTool", "xmp:CreateDate", "xmp:ModifyDate", "xmp:MetadataDate",
+  "pdf:Producer", "pdf:Keywords", "xmpMM:DocumentID", "xmpMM:InstanceID",
+  "exif:GPSLatitude", "exif:GPSLongitude", "aux:SerialNumber",
+};
+
+// Character data with the predefined entities expanded and surrounding whitespace trimmed
+std::string xml_text(std::string_view v);
+// Value of `qname` in the packet `x`, written either as an attribute of rdf:Description
+// or as an element; rdf:Seq/Bag/Alt items are joined with "; ". Empty when absent.
+std::string xmp_value(std::string_view x, std::string_view qname);
+
+// Text of a literal "(...)" or hex "<...>" string; UTF-16BE (with BOM) becomes UTF-8.
+bool pdf_string(std::string_view v, std::string& out);
+
+}
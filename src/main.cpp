@@ -14,11 +14,25 @@ int main(int argc, char** argv) {
   auto* inspect = app.add_subcommand("inspect", "Inspect metadata");
   std::vector<std::string> inspect_targets;
   cmd::InspectOpts inspect_opts; // has: recursive, format, report, verbose, no_color
-  inspect->add_option("files", inspect_targets, "Files to inspect")->required();
+  inspect->add_option("files", inspect_targets, "Files to inspect");
+  inspect->add_option("--files-from", inspect_opts.files_from, "Read targets from a file, one per line ('-' = stdin)");
+  inspect->add_flag("-0,--null", inspect_opts.null_sep, "--files-from entries are NUL-separated (find -print0)");
   inspect->add_flag("-v,--verbose", inspect_opts.verbose, "Verbose field listing");
   inspect->add_flag("-r,--recursive", inspect_opts.recursive, "Recurse into directories");
+  inspect->add_flag("--dedup", inspect_opts.dedup, "Inspect hard links and identical copies once");
   inspect->add_option("--report", inspect_opts.report, "Write JSON report to file");
-  inspect->add_option("--format", inspect_opts.format, "Output format: auto|json|pretty");
+  inspect->add_option("--format", inspect_opts.format, "Output format: auto|json|pretty|stream (rows as they finish)");
+  inspect->add_flag("--summary", inspect_opts.summary, "Print counts by type, verdict and risk plus the top files, not one row per file");
+  inspect->add_flag("--stats", inspect_opts.stats, "Print per-phase timing and counters");
+  inspect->add_option("--trace", inspect_opts.trace, "Write a Chrome trace-event JSON of per-file spans");
+  inspect->add_option("--io", inspect_opts.io, "I/O engine: sync|uring (default: sync)");
+  inspect->add_option("--io-depth", inspect_opts.io_depth, "uring: files kept in flight");
+  inspect->add_option("-j,--jobs", inspect_opts.jobs, "Worker threads (0 = one per core)");
+  inspect->add_option("--max-memory", inspect_opts.max_memory, "Memory budget for files in flight, e.g. 2G");
+  inspect->add_option("--max-value-bytes", inspect_opts.max_value_bytes, "Cut each field value to N bytes in -v, JSON and reports (0 = whole)");
+  inspect->add_option("--shard", inspect_opts.shard, "Only the targets of shard i of N (i/N), for splitting a run across nodes");
+  inspect->add_option("--shard-by", inspect_opts.shard_by, "Shard key: path|dir (top-level directory; default: path)");
+  inspect->add_flag("--quick", inspect_opts.quick, "Triage: read at most 64 KiB at each end of a file; results carry a confidence");
 
   // ----- strip -----
   auto* strip = app.add_subcommand("strip", "Strip metadata");
@@ -26,20 +40,64 @@ int main(int argc, char** argv) {
   cmd::StripOpts strip_opts; // has: recursive, out_dir, in_place, yes, format, report, dry_run, verbose, no_color
   bool safe_flag = false;
   std::string custom_policy;
-  strip->add_option("files", strip_targets, "Files to strip")->required();
+  strip->add_option("files", strip_targets, "Files to strip ('-' = stdin to stdout)");
+  strip->add_option("--files-from", strip_opts.files_from, "Read targets from a file, one per line ('-' = stdin)");
+  strip->add_flag("-0,--null", strip_opts.null_sep, "--files-from entries are NUL-separated (find -print0)");
+  strip->add_option("--type", strip_opts.type, "Type of stdin input: auto|image|pdf|audio|zip");
   strip->add_flag("--dry-run", strip_opts.dry_run, "Show plan without writing");
   strip->add_flag("--in-place", strip_opts.in_place, "Overwrite original files (no backup)");
   strip->add_option("-o,--out-dir", strip_opts.out_dir, "Output directory");
   strip->add_flag("-r,--recursive", strip_opts.recursive, "Recurse into directories");
+  strip->add_flag("--dedup", strip_opts.dedup, "Strip identical files once and copy the result");
   strip->add_flag("--yes", strip_opts.yes, "Skip confirmation prompts");
   strip->add_option("--report", strip_opts.report, "Write JSON report to file");
   strip->add_option("--format", strip_opts.format, "Output format: auto|json|pretty");
+  strip->add_flag("--stats", strip_opts.stats, "Print per-phase timing and counters");
+  strip->add_option("--trace", strip_opts.trace, "Write a Chrome trace-event JSON of per-file spans");
+  strip->add_option("--io", strip_opts.io, "I/O engine: sync|uring (default: sync)");
+  strip->add_option("--io-depth", strip_opts.io_depth, "uring: files kept in flight");
+  strip->add_option("-j,--jobs", strip_opts.jobs, "Worker threads (0 = one per core)");
+  strip->add_option("--max-memory", strip_opts.max_memory, "Memory budget for files in flight, e.g. 2G");
+  strip->add_option("--durability", strip_opts.durability, "Output durability: none|file|batch (default: file)");
+  strip->add_option("--batch-files", strip_opts.batch_files, "batch: sync the filesystem every N files");
+  strip->add_option("--batch-ms", strip_opts.batch_ms, "batch: sync the filesystem at least every T ms");
+  strip->add_option("--journal", strip_opts.journal, "Record finished files in FILE so an interrupted run can resume");
+  strip->add_flag("--resume", strip_opts.resume, "Skip files the --journal already records as done");
+  strip->add_option("--max-value-bytes", strip_opts.max_value_bytes, "Cut each field value to N bytes in JSON and reports (0 = whole)");
+  strip->add_option("--shard", strip_opts.shard, "Only the targets of shard i of N (i/N), for splitting a run across nodes");
+  strip->add_option("--shard-by", strip_opts.shard_by, "Shard key: path|dir (top-level directory; default: path)");
   strip->add_flag("--safe", safe_flag, "Use built-in safe policy");
   strip->add_option("--custom", custom_policy, "Policy file (YAML/JSON)");
   std::vector<std::string> keep_cli, drop_cli;
   strip->add_option("--keep", keep_cli, "Keep specific field(s) (repeatable)")->expected(-1);
   strip->add_option("--drop", drop_cli, "Drop specific field(s) (repeatable)")->expected(-1);
 
+  // ----- serve -----
+  auto* serve = app.add_subcommand("serve", "Serve inspect/strip requests on a Unix socket");
+  cmd::ServeOpts serve_opts;
+  bool serve_safe = false;
+  std::string serve_custom;
+  std::vector<std::string> serve_keep, serve_drop;
+  serve->add_option("--socket", serve_opts.socket, "Unix domain socket to listen on")->required();
+  serve->add_option("-j,--jobs", serve_opts.jobs, "Worker threads (0 = one per core)");
+  serve->add_option("-o,--out-dir", serve_opts.out_dir, "Output directory for strip requests; \"out\" must lie under it");
+  serve->add_flag("--allow-any-out", serve_opts.any_out, "Let strip requests write \"out\" anywhere");
+  serve->add_option("--durability", serve_opts.durability, "Output durability: none|file (default: file)");
+  serve->add_flag("--safe", serve_safe, "Default policy: built-in safe policy");
+  serve->add_option("--custom", serve_custom, "Default policy: policy file (YAML/JSON)");
+  serve->add_option("--keep", serve_keep, "Default policy: keep field(s) (repeatable)")->expected(-1);
+  serve->add_option("--drop", serve_drop, "Default policy: drop field(s) (repeatable)")->expected(-1);
+
+  // ----- report -----
+  auto* report = app.add_subcommand("report", "Work with JSON reports");
+  auto* merge = report->add_subcommand("merge", "Merge per-shard reports (JSON or NDJSON) into one");
+  std::vector<std::string> merge_inputs;
+  cmd::MergeOpts merge_opts;
+  merge->add_option("reports", merge_inputs, "Reports to merge")->required();
+  merge->add_option("-o,--out", merge_opts.out, "Write the merged report to a file (default: stdout)");
+  merge->add_option("--format", merge_opts.format, "Output format: json|ndjson (default: json)");
+  report->require_subcommand(1);
+
   // ----- explain -----
   auto* explain = app.add_subcommand("explain", "Explain risks for a file");
   std::string explain_target;
@@ -56,15 +114,31 @@ int main(int argc, char** argv) {
   strip_opts.no_color   = no_color;
   explain_opts.no_color = no_color;
 
+  // Targets come as arguments, from --files-from, or both
+  auto no_targets = [](const std::vector<std::string>& t, const std::string& from) {
+    if (!t.empty() || !from.empty()) return false;
+    fmt::print(stderr, "No files given (pass paths or --files-from)\n");
+    return true;
+  };
+
   // Dispatch
   if (inspect->parsed()) {
+    if (no_targets(inspect_targets, inspect_opts.files_from)) return 1;
     return cmd::run_inspect(inspect_targets, inspect_opts);
   }
   if (strip->parsed()) {
+    if (no_targets(strip_targets, strip_opts.files_from)) return 1;
     // Build policy from safe/custom and CLI keep/drop
     core::Policy pol = core::load_policy(safe_flag, custom_policy, keep_cli, drop_cli);
     return cmd::run_strip(strip_targets, pol, strip_opts);
   }
+  if (serve->parsed()) {
+    core::Policy pol = core::load_policy(serve_safe, serve_custom, serve_keep, serve_drop);
+    return cmd::run_serve(pol, serve_opts);
+  }
+  if (merge->parsed()) {
+    return cmd::run_report_merge(merge_inputs, merge_opts);
+  }
   if (explain->parsed()) {
     return cmd::run_explain(explain_target, explain_opts);
   }
@@ -0,0 +1,402 @@
+#include "commit.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "stats.hpp"
+#include "trace.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#define open _open
+#define close _close
+#define getpid _getpid
+#define fsync _commit
+#define lseek _lseeki64
+#ifndef O_BINARY
+#define O_BINARY _O_BINARY
+#endif
+#else
+#include <unistd.h>
+#define O_BINARY 0
+#endif
+
+namespace fs = std::filesystem;
+
+namespace util {
+namespace {
+
+struct Pending {
+  std::string tmp, dest;
+};
+
+std::mutex g_mu;
+DurabilityOpts g_opts;
+std::vector<Pending> g_pending;
+std::set<std::string> g_dirs; // directories with renames not yet synced
+std::vector<std::string> g_failed;      // renames failed since the last flush_outputs()
+std::unordered_set<std::string> g_lost; // every destination a group commit failed
+std::chrono::steady_clock::time_point g_batch_t0; // when the oldest pending output arrived
+std::condition_variable g_batch_cv; // a batch started, or the flusher should stop
+std::atomic<unsigned> g_seq{0};
+std::atomic<bool> g_no_tmpfile{false}; // an O_TMPFILE could not be linked: use named temps
+
+std::string parent_of(const std::string& p) {
+  auto d = fs::path(p).parent_path();
+  return d.empty() ? std::string(".") : d.string();
+}
+
+std::string temp_name(const std::string& dest) {
+  fs::path p(dest);
+  auto name = "." + p.filename().string() + "." + std::to_string(getpid()) + "." +
+              std::to_string(g_seq.fetch_add(1, std::memory_order_relaxed)) + ".msw";
+  return (fs::path(parent_of(dest)) / name).string();
+}
+
+// A new temp file next to `dest`; -1 with `tmp` empty when none could be created
+int open_temp(const std::string& dest, int mode, std::string& tmp) {
+  int fd = -1;
+  for (int tries = 0; tries < 16 && fd < 0; ++tries) {
+    tmp = temp_name(dest);
+    fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_BINARY, mode);
+    if (fd < 0 && errno != EEXIST) break;
+  }
+  if (fd < 0) tmp.clear();
+  return fd;
+}
+
+bool write_all(int fd, const char* p, std::size_t n) {
+  while (n) {
+#ifdef _WIN32
+    auto w = _write(fd, p, static_cast<unsigned>(n > (1u << 30) ? (1u << 30) : n));
+#else
+    auto w = ::write(fd, p, n);
+#endif
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    p += w;
+    n -= static_cast<std::size_t>(w);
+  }
+  return true;
+}
+
+void sync_dir(const std::string& dir) {
+#ifndef _WIN32
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd >= 0) { ::fsync(fd); ::close(fd); }
+#else
+  (void)dir;
+#endif
+}
+
+// One syncfs per filesystem touched by `dirs`.
+void sync_filesystems(const std::set<std::string>& dirs) {
+#if defined(__linux__)
+  std::set<dev_t> seen;
+  for (auto& d : dirs) {
+    struct stat st{};
+    if (::stat(d.c_str(), &st) != 0 || !seen.insert(st.st_dev).second) continue;
+    int fd = ::open(d.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) { ::syncfs(fd); ::close(fd); }
+  }
+#elif !defined(_WIN32)
+  if (!dirs.empty()) ::sync();
+#else
+  for (auto& d : dirs) sync_dir(d);
+#endif
+}
+
+bool rename_into_place(const std::string& tmp, const std::string& dest) {
+  util::stats::Timer t(util::stats::Phase::Rename, dest);
+  std::error_code ec;
+  fs::rename(tmp, dest, ec);
+  if (!ec) return true;
+  fs::remove(tmp, ec);
+  return false;
+}
+
+// Data of every pending temp reaches disk before any of them is renamed, so each
+// destination holds either the old or the complete new content after a crash.
+void group_commit_locked() {
+  if (g_pending.empty()) return;
+  std::set<std::string> dirs = g_dirs;
+  for (auto& p : g_pending) dirs.insert(parent_of(p.dest));
+  {
+    util::stats::Timer t(util::stats::Phase::Fsync);
+    sync_filesystems(dirs);
+  }
+  g_dirs.clear();
+  for (auto& p : g_pending) {
+    if (!rename_into_place(p.tmp, p.dest)) {
+      g_failed.push_back(p.dest);
+      g_lost.insert(p.dest);
+      continue;
+    }
+    g_lost.erase(p.dest); // a later output for the same destination made it
+    g_dirs.insert(parent_of(p.dest)); // made durable by the next sync
+  }
+  g_pending.clear();
+}
+
+// Holds --batch-ms when no further output arrives to trigger the group commit: a
+// thread that sleeps until the oldest pending output is that old, then commits the batch.
+class Flusher {
+public:
+  void start() { // with g_mu held
+    if (!thread_.joinable()) thread_ = std::thread([this] { run(); });
+  }
+  ~Flusher() {
+    {
+      std::lock_guard<std::mutex> lk(g_mu);
+      stop_ = true;
+    }
+    g_batch_cv.notify_all();
+    if (thread_.joinable()) thread_.join();
+  }
+
+private:
+  void run() {
+    trace::set_thread_name("commit");
+    std::unique_lock<std::mutex> lk(g_mu);
+    while (!stop_) {
+      if (g_opts.mode != Durability::Batch || g_pending.empty()) {
+        g_batch_cv.wait(lk);
+        continue;
+      }
+      const auto due = g_batch_t0 + std::chrono::milliseconds(g_opts.batch_ms);
+      if (std::chrono::steady_clock::now() >= due) group_commit_locked();
+      else g_batch_cv.wait_until(lk, due);
+    }
+  }
+
+  bool stop_ = false;
+  std::thread thread_;
+};
+Flusher g_flusher; // after the state it uses, so it stops first at exit
+
+} // namespace
+
+bool parse_durability(const std::string& s, Durability& out) {
+  if (s == "none") out = Durability::None;
+  else if (s == "file") out = Durability::File;
+  else if (s == "batch") out = Durability::Batch;
+  else return false;
+  return true;
+}
+
+void set_durability(const DurabilityOpts& o) {
+  std::lock_guard<std::mutex> lk(g_mu);
+  g_opts = o;
+  if (!g_opts.batch_files) g_opts.batch_files = 1;
+  if (g_opts.mode == Durability::Batch) g_flusher.start();
+  g_batch_cv.notify_all();
+}
+
+std::vector<std::string> flush_outputs() {
+  std::lock_guard<std::mutex> lk(g_mu);
+  group_commit_locked();
+  if (!g_dirs.empty()) {
+    util::stats::Timer t(util::stats::Phase::Fsync);
+    sync_filesystems(g_dirs);
+    g_dirs.clear();
+  }
+  return std::exchange(g_failed, {});
+}
+
+bool output_lost(const std::string& dest) {
+  std::lock_guard<std::mutex> lk(g_mu);
+  return g_lost.count(dest) != 0;
+}
+
+bool link_output(const std::string& src, const std::string& dest) {
+  std::error_code ec;
+  if (fs::equivalent(src, dest, ec)) return true; // already linked by an earlier run
+  fs::create_directories(parent_of(dest), ec);
+  std::string tmp;
+  for (int tries = 0; tries < 16 && tmp.empty(); ++tries) {
+    tmp = temp_name(dest);
+    ec.clear();
+    fs::create_hard_link(src, tmp, ec);
+    if (ec) {
+      tmp.clear();
+      if (ec != std::errc::file_exists) return false;
+    }
+  }
+  if (tmp.empty() || !rename_into_place(tmp, dest)) return false;
+  // the data is the input's; only the new directory entry needs to reach disk
+  const auto mode = [] { std::lock_guard<std::mutex> lk(g_mu); return g_opts.mode; }();
+  if (mode == Durability::File) {
+    util::stats::Timer t(util::stats::Phase::Fsync, dest);
+    sync_dir(parent_of(dest));
+  } else if (mode == Durability::Batch) {
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_dirs.insert(parent_of(dest));
+  }
+  return true;
+}
+
+OutputFile::OutputFile(std::string dest, const std::string& like, bool need_path)
+  : dest_(std::move(dest)) {
+  std::error_code ec;
+  fs::create_directories(parent_of(dest_), ec);
+  int mode = 0644;
+  struct stat st{};
+  if (!like.empty() && ::stat(like.c_str(), &st) == 0) mode = st.st_mode & 07777;
+#ifdef O_TMPFILE
+  // read/write, so commit() can copy it to a named temp if it cannot be linked
+  if (!need_path && !g_no_tmpfile.load(std::memory_order_relaxed)) {
+    fd_ = ::open(parent_of(dest_).c_str(), O_TMPFILE | O_RDWR, mode);
+    if (fd_ >= 0) { anonymous_ = true; return; }
+  }
+#else
+  (void)need_path;
+#endif
+  fd_ = open_temp(dest_, mode, tmp_);
+}
+
+OutputFile::~OutputFile() {
+  if (fd_ >= 0) ::close(fd_);
+  if (!committed_ && !tmp_.empty()) {
+    std::error_code ec;
+    fs::remove(tmp_, ec);
+  }
+}
+
+bool OutputFile::write(const void* data, std::size_t n) {
+  if (fd_ < 0) return false;
+  util::stats::Timer t(util::stats::Phase::Write, dest_);
+  if (!write_all(fd_, static_cast<const char*>(data), n)) return false;
+  util::stats::bytes_written(n);
+  return true;
+}
+
+bool OutputFile::copy_from(const std::string& src) {
+  return copy_range(src, 0, std::numeric_limits<std::uint64_t>::max());
+}
+
+bool OutputFile::copy_range(const std::string& src, std::uint64_t off, std::uint64_t len) {
+  if (fd_ < 0) return false;
+  int in = ::open(src.c_str(), O_RDONLY | O_BINARY);
+  if (in < 0) return false;
+  bool ok = true;
+  const auto start = ::lseek(fd_, 0, SEEK_CUR); // whatever was written before stays
+#if defined(__linux__)
+  // in-kernel copy (reflink on filesystems that support it), read/write fallback below
+  loff_t pos = static_cast<loff_t>(off);
+  for (std::uint64_t left = len;;) {
+    if (left == 0) { ::close(in); return true; }
+    auto n = ::copy_file_range(in, &pos, fd_, nullptr, static_cast<std::size_t>(std::min<std::uint64_t>(left, 1u << 30)), 0);
+    if (n > 0) { left -= static_cast<std::uint64_t>(n); continue; }
+    if (n == 0) { ::close(in); return true; }
+    if (errno == EINTR) continue;
+    break;
+  }
+  if (start < 0 || ::lseek(fd_, start, SEEK_SET) < 0 || ::ftruncate(fd_, start) != 0) ok = false;
+#else
+  (void)start;
+#endif
+  if (::lseek(in, static_cast<long long>(off), SEEK_SET) < 0) ok = false;
+  std::vector<char> buf(std::size_t{1} << 16);
+  for (std::uint64_t left = len; ok && left;) {
+    const auto want = static_cast<std::size_t>(std::min<std::uint64_t>(left, buf.size()));
+#ifdef _WIN32
+    auto n = _read(in, buf.data(), static_cast<unsigned>(want));
+#else
+    auto n = ::read(in, buf.data(), want);
+#endif
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) { ok = n == 0; break; }
+    ok = write_all(fd_, buf.data(), static_cast<std::size_t>(n));
+    left -= static_cast<std::uint64_t>(n);
+  }
+  ::close(in);
+  return ok;
+}
+
+bool OutputFile::commit() {
+  if (fd_ < 0 || committed_) return false;
+  const auto mode = [] { std::lock_guard<std::mutex> lk(g_mu); return g_opts.mode; }();
+
+  if (!tmp_.empty() && !anonymous_) {
+    // libraries may have replaced the inode behind our descriptor; sync by name
+    ::close(fd_);
+    fd_ = ::open(tmp_.c_str(), O_RDONLY | O_BINARY);
+    if (fd_ < 0) return false;
+  }
+#if defined(O_TMPFILE)
+  if (anonymous_ && !name_anonymous()) return false;
+#endif
+  if (mode == Durability::File) {
+    util::stats::Timer t(util::stats::Phase::Fsync, dest_);
+    if (::fsync(fd_) != 0) return false;
+  }
+  ::close(fd_);
+  fd_ = -1;
+  committed_ = true;
+
+  if (mode == Durability::Batch) {
+    std::lock_guard<std::mutex> lk(g_mu);
+    if (g_pending.empty()) {
+      g_batch_t0 = std::chrono::steady_clock::now();
+      g_batch_cv.notify_all(); // the flusher times this batch
+    }
+    g_pending.push_back({tmp_, dest_});
+    if (g_pending.size() >= g_opts.batch_files) group_commit_locked();
+    return true;
+  }
+  if (!rename_into_place(tmp_, dest_)) return false;
+  if (mode == Durability::File) {
+    util::stats::Timer t(util::stats::Phase::Fsync, dest_);
+    sync_dir(parent_of(dest_));
+  }
+  return true;
+}
+
+#if defined(O_TMPFILE)
+bool OutputFile::name_anonymous() {
+  // give the anonymous inode a name so it can be renamed over the destination
+  const auto proc = "/proc/self/fd/" + std::to_string(fd_);
+  for (int tries = 0; tries < 16; ++tries) {
+    tmp_ = temp_name(dest_);
+    if (::linkat(AT_FDCWD, proc.c_str(), AT_FDCWD, tmp_.c_str(), AT_SYMLINK_FOLLOW) == 0) return true;
+    tmp_.clear();
+    if (errno != EEXIST) break;
+  }
+  // No /proc (some containers and sandboxes) or the link was refused: copy what was
+  // written into a named temp, and open named temps from here on.
+  g_no_tmpfile.store(true, std::memory_order_relaxed);
+  struct stat st{};
+  if (::fstat(fd_, &st) != 0) return false;
+  const int named = open_temp(dest_, static_cast<int>(st.st_mode & 07777), tmp_);
+  if (named < 0) return false;
+  std::vector<char> buf(std::size_t{1} << 16);
+  bool ok = true;
+  for (off_t at = 0; ok;) {
+    const auto n = ::pread(fd_, buf.data(), buf.size(), at);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) { ok = n == 0; break; }
+    ok = write_all(named, buf.data(), static_cast<std::size_t>(n));
+    at += n;
+  }
+  ::close(fd_);
+  fd_ = named;
+  anonymous_ = false;
+  return ok; // on failure the destructor removes the named temp
+}
+#endif
+
+} // namespace util
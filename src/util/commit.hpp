@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Output-commit layer: every backend writes its result to a temp file in the destination
+// directory and publishes it with an atomic rename, so a crash never leaves a torn output
+// and --in-place is safe.
+namespace util {
+
+enum class Durability {
+  None,  // rename only; the kernel flushes whenever it likes
+  File,  // fsync each output before its rename, fsync the directory after
+  Batch, // group commit: one syncfs per N files or T ms, then rename the batch
+};
+
+struct DurabilityOpts {
+  Durability mode = Durability::File;
+  unsigned batch_files = 256;
+  unsigned batch_ms = 1000;
+};
+
+bool parse_durability(const std::string& s, Durability& out);
+void set_durability(const DurabilityOpts& o);
+
+// Commit anything still pending in batch mode and make the renames durable.
+// Call once at the end of a run (a no-op in the other modes). Returns the destinations
+// whose rename failed in this call: their commit() returned true, but nothing was published.
+std::vector<std::string> flush_outputs();
+
+// True when an output committed for `dest` in batch mode was never renamed into place
+// (its group commit failed it), so `dest` does not hold the result.
+bool output_lost(const std::string& dest);
+
+// Publish `src` unchanged at `dest` as a hard link, atomically replacing what is there.
+// False when the filesystem cannot link (e.g. across devices); callers fall back to a copy.
+bool link_output(const std::string& src, const std::string& dest);
+
+class OutputFile {
+public:
+  // Opens a temp next to `dest`, with the permission bits of `like` when it exists.
+  // Writers that only use write()/copy_from() get an anonymous O_TMPFILE where the
+  // filesystem supports it; `need_path` forces a named temp for libraries that reopen
+  // the file by name (Exiv2, TagLib).
+  OutputFile(std::string dest, const std::string& like, bool need_path = false);
+  ~OutputFile(); // discards the temp unless committed
+  OutputFile(const OutputFile&) = delete;
+  OutputFile& operator=(const OutputFile&) = delete;
+
+  bool ok() const { return fd_ >= 0; }
+  const std::string& path() const { return tmp_; } // named temp (need_path only)
+
+  bool write(const void* data, std::size_t n);
+  bool copy_from(const std::string& src);
+  // Appends `len` bytes of `src` from `off` (fewer at end of file), in the kernel where it can.
+  bool copy_range(const std::string& src, std::uint64_t off, std::uint64_t len);
+
+  // Publish the output. In batch mode the rename waits for the group commit, so
+  // callers that re-read their output do it before committing, and true only means
+  // queued: flush_outputs() / output_lost() tell whether the rename happened.
+  bool commit();
+
+private:
+  bool name_anonymous(); // link the O_TMPFILE, or copy it to a named temp
+
+  std::string dest_;
+  std::string tmp_;
+  int fd_ = -1;
+  bool anonymous_ = false;
+  bool committed_ = false;
+};
+
+} // namespace util
@@ -0,0 +1,71 @@
+#include "dedup.hpp"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <sys/stat.h>
+#include "hash.hpp"
+
+#ifdef _WIN32
+#define stat _stat64 // the struct and the call; 64-bit st_size
+#define S_ISREG(m) (((m) & _S_IFMT) == _S_IFREG)
+#endif
+
+namespace util {
+namespace {
+
+bool same_content(const std::string& a, const std::string& b) {
+  std::FILE* fa = std::fopen(a.c_str(), "rb");
+  if (!fa) return false;
+  std::FILE* fb = std::fopen(b.c_str(), "rb");
+  if (!fb) { std::fclose(fa); return false; }
+  std::vector<unsigned char> ba(std::size_t{1} << 17), bb(ba.size());
+  bool same = true;
+  for (;;) {
+    const auto na = std::fread(ba.data(), 1, ba.size(), fa);
+    const auto nb = std::fread(bb.data(), 1, bb.size(), fb);
+    if (na != nb || std::memcmp(ba.data(), bb.data(), na) != 0) { same = false; break; }
+    if (na < ba.size()) { same = !std::ferror(fa) && !std::ferror(fb); break; }
+  }
+  std::fclose(fa);
+  std::fclose(fb);
+  return same;
+}
+
+} // namespace
+
+const DedupIndex::Entry* DedupIndex::find_or_add(const std::string& path, std::size_t index) {
+  struct stat st{};
+  if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return nullptr;
+  const Entry self{path, index};
+
+  // st_ino is not meaningful on Windows; rely on content there
+#ifndef _WIN32
+  const auto inode = std::make_pair(static_cast<std::uint64_t>(st.st_dev), static_cast<std::uint64_t>(st.st_ino));
+  auto [ino, ino_new] = inodes_.try_emplace(inode, self);
+  if (!ino_new) return &ino->second;
+#endif
+
+  const auto size = static_cast<std::uint64_t>(st.st_size);
+  auto [it, size_new] = sizes_.try_emplace(size);
+  auto& b = it->second;
+  if (size_new) { b.first = self; return nullptr; }
+  if (!b.first_hashed) {
+    b.first_hashed = true;
+    std::uint64_t h;
+    if (xxh64_file(b.first.path, h)) b.by_hash.emplace(h, b.first);
+  }
+  std::uint64_t h;
+  if (!xxh64_file(path, h)) return nullptr;
+  auto [lo, hi] = b.by_hash.equal_range(h);
+  for (auto hit = lo; hit != hi; ++hit) {
+    if (!same_content(hit->second.path, path)) continue;
+#ifndef _WIN32
+    ino->second = hit->second; // later hard links to this file resolve to the same primary
+#endif
+    return &hit->second;
+  }
+  b.by_hash.emplace(h, self);
+  return nullptr;
+}
+
+} // namespace util
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// --dedup: recognizes files whose content was already seen in this run. Hard links and
+// repeated paths match on (device, inode) without reading anything; other files match
+// by size first and are hashed (XXH64) only once a second file of the same size shows
+// up, so unique sizes are never read. A hash match is confirmed byte for byte before a
+// file counts as a duplicate, since its output is replaced by a copy of the first one.
+namespace util {
+
+class DedupIndex {
+public:
+  struct Entry {
+    std::string path;      // first file with this content
+    std::size_t index = 0; // caller's index for it
+  };
+
+  // The earlier file with the same content as `path`, or nullptr when `path` is new
+  // (it is then recorded under `index`). Files that cannot be stat'ed or read, and
+  // hash collisions, are always new.
+  const Entry* find_or_add(const std::string& path, std::size_t index);
+
+private:
+  struct SizeBucket {
+    Entry first;              // not hashed until a second file of this size arrives
+    bool first_hashed = false;
+    std::unordered_multimap<std::uint64_t, Entry> by_hash; // several only on a collision
+  };
+  std::map<std::pair<std::uint64_t, std::uint64_t>, Entry> inodes_;
+  std::unordered_map<std::uint64_t, SizeBucket> sizes_;
+};
+
+} // namespace util
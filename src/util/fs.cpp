@@ -1,4 +1,5 @@
 #include "fs.hpp"
+#include <cstring>
 #include <filesystem>
 #include <string>
 namespace fs = std::filesystem;
@@ -11,4 +12,50 @@ std::string derive_output_path(const std::string& in, const std::string& out_dir
   auto ext  = p.extension().string();
   return (dir / (stem + ".cleaned" + ext)).string();
 }
+
+// ---- PathList ----
+
+PathList::~PathList() {
+  if (own_ && f_) std::fclose(f_);
+}
+
+bool PathList::open(const std::string& source, bool nul) {
+  if (source == "-") { f_ = stdin; own_ = false; }
+  else { f_ = std::fopen(source.c_str(), "rb"); own_ = true; }
+  delim_ = nul ? '\0' : '\n';
+  buf_.resize(64 * 1024);
+  return f_ != nullptr;
+}
+
+bool PathList::next(std::vector<std::string>& out, std::size_t max) {
+  if (!f_) return false;
+  const auto before = out.size();
+  auto emit = [&](std::string&& s) {
+    if (delim_ == '\n' && !s.empty() && s.back() == '\r') s.pop_back();
+    if (!s.empty()) out.push_back(std::move(s));
+  };
+  while (out.size() - before < max) {
+    if (pos_ == len_) {
+      len_ = std::fread(buf_.data(), 1, buf_.size(), f_);
+      pos_ = 0;
+      if (len_ == 0) {
+        // end of input: the last entry may lack a terminator
+        emit(std::move(partial_));
+        partial_.clear();
+        if (own_) std::fclose(f_);
+        f_ = nullptr;
+        break;
+      }
+    }
+    const char* start = buf_.data() + pos_;
+    const char* end = buf_.data() + len_;
+    const char* hit = static_cast<const char*>(std::memchr(start, delim_, static_cast<std::size_t>(end - start)));
+    if (!hit) { partial_.append(start, end); pos_ = len_; continue; }
+    partial_.append(start, hit);
+    pos_ += static_cast<std::size_t>(hit - start) + 1;
+    emit(std::move(partial_));
+    partial_.clear();
+  }
+  return out.size() > before;
+}
 }
@@ -1,5 +1,32 @@
 #pragma once
+#include <cstddef>
+#include <cstdio>
 #include <string>
+#include <vector>
 namespace util {
 std::string derive_output_path(const std::string& in, const std::string& out_dir, bool in_place);
+
+// Target list for --files-from, read lazily: one path per line, or NUL-separated with
+// `nul` (as written by `find -print0`). "-" reads stdin. Empty entries are skipped and
+// a trailing '\r' is dropped from lines.
+class PathList {
+public:
+  PathList() = default;
+  ~PathList();
+  PathList(const PathList&) = delete;
+  PathList& operator=(const PathList&) = delete;
+
+  bool open(const std::string& source, bool nul);
+  bool is_open() const { return f_ != nullptr; }
+  // Appends up to `max` paths to `out`; false once the list is exhausted.
+  bool next(std::vector<std::string>& out, std::size_t max);
+
+private:
+  std::FILE* f_ = nullptr;
+  bool own_ = false;
+  char delim_ = '\n';
+  std::vector<char> buf_;
+  std::size_t pos_ = 0, len_ = 0;
+  std::string partial_;
+};
 }
@@ -0,0 +1,102 @@
+#include "hash.hpp"
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace util {
+namespace {
+
+constexpr std::uint64_t P1 = 11400714785074694791ULL;
+constexpr std::uint64_t P2 = 14029467366897019727ULL;
+constexpr std::uint64_t P3 = 1609587929392839161ULL;
+constexpr std::uint64_t P4 = 9650029242287828579ULL;
+constexpr std::uint64_t P5 = 2870177450012600261ULL;
+
+// little-endian loads; compilers turn these into single moves
+inline std::uint64_t read64(const unsigned char* p) {
+  std::uint64_t v = 0;
+  for (int i = 0; i < 8; ++i) v |= std::uint64_t{p[i]} << (8 * i);
+  return v;
+}
+inline std::uint64_t read32(const unsigned char* p) {
+  std::uint64_t v = 0;
+  for (int i = 0; i < 4; ++i) v |= std::uint64_t{p[i]} << (8 * i);
+  return v;
+}
+inline std::uint64_t round(std::uint64_t acc, std::uint64_t in) {
+  acc += in * P2;
+  return std::rotl(acc, 31) * P1;
+}
+inline std::uint64_t merge(std::uint64_t h, std::uint64_t v) {
+  h ^= round(0, v);
+  return h * P1 + P4;
+}
+
+} // namespace
+
+Xxh64::Xxh64(std::uint64_t seed)
+  : v_{seed + P1 + P2, seed + P2, seed, seed - P1}, seed_(seed) {}
+
+void Xxh64::update(const void* data, std::size_t n) {
+  auto p = static_cast<const unsigned char*>(data);
+  total_ += n;
+  if (buffered_ + n < 32) {
+    std::memcpy(buf_ + buffered_, p, n);
+    buffered_ += n;
+    return;
+  }
+  if (buffered_) {
+    const auto fill = 32 - buffered_;
+    std::memcpy(buf_ + buffered_, p, fill);
+    for (int i = 0; i < 4; ++i) v_[i] = round(v_[i], read64(buf_ + 8 * i));
+    p += fill; n -= fill;
+    buffered_ = 0;
+  }
+  for (; n >= 32; p += 32, n -= 32) {
+    for (int i = 0; i < 4; ++i) v_[i] = round(v_[i], read64(p + 8 * i));
+  }
+  std::memcpy(buf_, p, n);
+  buffered_ = n;
+}
+
+std::uint64_t Xxh64::digest() const {
+  std::uint64_t h;
+  if (total_ >= 32) {
+    h = std::rotl(v_[0], 1) + std::rotl(v_[1], 7) + std::rotl(v_[2], 12) + std::rotl(v_[3], 18);
+    for (auto v : v_) h = merge(h, v);
+  } else {
+    h = seed_ + P5;
+  }
+  h += total_;
+  const unsigned char* p = buf_;
+  std::size_t n = buffered_;
+  for (; n >= 8; p += 8, n -= 8) h = std::rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+  if (n >= 4) { h = std::rotl(h ^ (read32(p) * P1), 23) * P2 + P3; p += 4; n -= 4; }
+  for (; n; ++p, --n) h = std::rotl(h ^ (*p * P5), 11) * P1;
+  h ^= h >> 33; h *= P2;
+  h ^= h >> 29; h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+std::uint64_t xxh64(const void* data, std::size_t n, std::uint64_t seed) {
+  Xxh64 x(seed);
+  x.update(data, n);
+  return x.digest();
+}
+
+bool xxh64_file(const std::string& path, std::uint64_t& out) {
+  std::FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) return false;
+  Xxh64 x;
+  std::vector<unsigned char> buf(std::size_t{1} << 18);
+  std::size_t n;
+  while ((n = std::fread(buf.data(), 1, buf.size(), f)) > 0) x.update(buf.data(), n);
+  const bool ok = !std::ferror(f);
+  std::fclose(f);
+  out = x.digest();
+  return ok;
+}
+
+} // namespace util
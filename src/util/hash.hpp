@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// XXH64 (xxHash, 64-bit): a fast non-cryptographic content hash, used by --dedup to
+// tell identical files apart. Fed incrementally so files are hashed without loading them.
+namespace util {
+
+class Xxh64 {
+public:
+  explicit Xxh64(std::uint64_t seed = 0);
+  void update(const void* data, std::size_t n);
+  std::uint64_t digest() const;
+
+private:
+  std::uint64_t v_[4];
+  std::uint64_t seed_;
+  std::uint64_t total_ = 0;
+  unsigned char buf_[32];
+  std::size_t buffered_ = 0;
+};
+
+std::uint64_t xxh64(const void* data, std::size_t n, std::uint64_t seed = 0);
+// Hash of a file's contents; false when it cannot be read.
+bool xxh64_file(const std::string& path, std::uint64_t& out);
+
+} // namespace util
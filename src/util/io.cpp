@@ -0,0 +1,389 @@
+#include "io.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "stats.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace util::io {
+namespace {
+
+Loaded load_blocking(const std::string& path, std::size_t max_bytes) {
+  Loaded l;
+  util::stats::Timer t(util::stats::Phase::Open, path);
+#ifdef _WIN32
+  int fd = ::_open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+  if (fd < 0) { l.err = errno; return l; }
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) l.err = errno;
+  else if (static_cast<std::size_t>(st.st_size) > max_bytes) l.err = EFBIG;
+  else {
+    l.data.resize(static_cast<std::size_t>(st.st_size));
+    std::size_t got = 0;
+    while (got < l.data.size()) {
+#ifdef _WIN32
+      auto n = ::_read(fd, l.data.data() + got, static_cast<unsigned>(l.data.size() - got));
+#else
+      auto n = ::read(fd, l.data.data() + got, l.data.size() - got);
+#endif
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) { l.err = errno; break; }
+      if (n == 0) break; // shrank under us
+      got += static_cast<std::size_t>(n);
+    }
+    l.data.resize(got);
+    util::stats::bytes_read(got);
+  }
+#ifdef _WIN32
+  ::_close(fd);
+#else
+  ::close(fd);
+#endif
+  return l;
+}
+
+constexpr std::uint64_t kOverBudget = ~std::uint64_t{0};
+
+std::uint64_t reserve(const LoadOpts& o, std::size_t i) {
+  if (!o.budget || !o.cost) return 0;
+  const auto c = o.cost(i);
+  return o.budget->try_acquire(c) ? c : kOverBudget;
+}
+void unreserve(const LoadOpts& o, std::uint64_t c) {
+  if (o.budget && o.cost && c != kOverBudget) o.budget->release(c);
+}
+
+void load_all_blocking(const std::vector<std::string>& paths, const LoadOpts& o,
+                       const std::function<void(std::size_t, Loaded&)>& on_done) {
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    // fits unless something else holds the budget; the file is read either way
+    const auto c = reserve(o, i);
+    auto l = load_blocking(paths[i], o.max_bytes);
+    on_done(i, l);
+    unreserve(o, c);
+  }
+}
+
+#ifdef HAVE_IO_URING
+
+// ---- minimal io_uring wrapper ----
+class Ring {
+public:
+  bool init(unsigned entries) {
+    io_uring_params p{};
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+    if (fd_ < 0) return false;
+    sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+    sq_ = ::mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ == MAP_FAILED) { sq_ = nullptr; return false; }
+    cq_ = single ? sq_ : ::mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ == MAP_FAILED) { cq_ = nullptr; return false; }
+    sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) { sqes_ = nullptr; return false; }
+    auto* sq = static_cast<char*>(sq_);
+    auto* cq = static_cast<char*>(cq_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    sq_entries_ = p.sq_entries;
+    cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    return true;
+  }
+
+  ~Ring() {
+    if (sqes_) ::munmap(sqes_, sqes_len_);
+    if (cq_ && cq_ != sq_) ::munmap(cq_, cq_len_);
+    if (sq_) ::munmap(sq_, sq_len_);
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  // Caller keeps the number of queued entries below room().
+  io_uring_sqe* next() {
+    const unsigned tail = *sq_tail_ + pending_;
+    const unsigned idx = tail & sq_mask_;
+    sq_array_[idx] = idx;
+    ++pending_;
+    auto* e = &sqes_[idx];
+    std::memset(e, 0, sizeof(*e));
+    return e;
+  }
+  unsigned room() const { return sq_entries_ - pending_ - unsubmitted_; }
+  // Entries published to the SQ that the kernel has not taken yet (after EAGAIN/EBUSY)
+  unsigned unsubmitted() const { return unsubmitted_; }
+
+  // Submit everything queued and wait for at least `wait` completions. -1 with errno
+  // set on failure; entries the kernel did not take are offered again next time.
+  int enter(unsigned wait) {
+    __atomic_store_n(sq_tail_, *sq_tail_ + pending_, __ATOMIC_RELEASE);
+    unsubmitted_ += pending_;
+    pending_ = 0;
+    for (;;) {
+      int r = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait,
+                                         wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+      if (r >= 0) { unsubmitted_ -= std::min<unsigned>(unsubmitted_, static_cast<unsigned>(r)); return r; }
+      if (errno != EINTR) return r;
+    }
+  }
+  // Wait for a completion without submitting anything
+  int wait() {
+    for (;;) {
+      int r = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+      if (r >= 0 || errno != EINTR) return r;
+    }
+  }
+
+  bool ready() const { return *cq_head_ != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE); }
+
+  template <class Fn> void reap(Fn&& fn) {
+    unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const auto& c = cqes_[head & cq_mask_];
+      fn(c.user_data, c.res);
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+
+private:
+  int fd_ = -1;
+  void* sq_ = nullptr;
+  void* cq_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  std::size_t sq_len_ = 0, cq_len_ = 0, sqes_len_ = 0;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_mask_ = 0, sq_entries_ = 0, pending_ = 0, unsubmitted_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+};
+
+enum Op : std::uint64_t { kOpen = 1, kRead = 2, kClose = 3 };
+constexpr std::uint64_t kNoSlot = 0xffffffffu;
+
+struct Slot {
+  bool live = false; // holds a file between its open and finish()
+  std::size_t index = 0;
+  std::uint64_t reserved = 0;
+  int fd = -1;
+  std::size_t got = 0;
+  std::uint64_t t0 = 0;
+  Loaded l;
+};
+
+bool load_all_uring(const std::vector<std::string>& paths, const LoadOpts& o,
+                    const std::function<void(std::size_t, Loaded&)>& on_done) {
+  const unsigned depth = std::max(1u, o.depth);
+  Ring ring;
+  if (!ring.init(depth * 2)) return false;
+
+  std::vector<Slot> slots(depth);
+  std::vector<unsigned> free_slots;
+  for (unsigned s = depth; s-- > 0;) free_slots.push_back(s);
+  std::size_t next = 0, done = 0;
+  unsigned in_flight = 0;
+  unsigned busy = 0; // EAGAIN/EBUSY in a row
+  constexpr unsigned kMaxBusy = 1000;
+
+  auto tag = [](unsigned slot, Op op) { return (std::uint64_t{slot} << 8) | op; };
+  auto queue_read = [&](unsigned s) {
+    auto& sl = slots[s];
+    auto* e = ring.next();
+    e->opcode = IORING_OP_READ;
+    e->fd = sl.fd;
+    e->addr = reinterpret_cast<std::uint64_t>(sl.l.data.data() + sl.got);
+    e->len = static_cast<unsigned>(std::min<std::size_t>(sl.l.data.size() - sl.got, 1u << 30));
+    e->off = sl.got;
+    e->user_data = tag(s, kRead);
+    ++in_flight;
+  };
+  auto queue_close = [&](int fd) {
+    auto* e = ring.next();
+    e->opcode = IORING_OP_CLOSE;
+    e->fd = fd;
+    e->user_data = tag(kNoSlot, kClose);
+    ++in_flight;
+  };
+  auto finish = [&](unsigned s) {
+    auto& sl = slots[s];
+    if (sl.fd >= 0) { queue_close(sl.fd); sl.fd = -1; }
+    // in-flight time overlaps other files, so it goes to the trace only (not the phase totals)
+    if (util::trace::enabled()) util::trace::emit("open", paths[sl.index], sl.t0, util::stats::now_ns() - sl.t0);
+    util::stats::bytes_read(sl.got);
+    if (sl.l.err == EINVAL || sl.l.err == EOPNOTSUPP) {
+      sl.l = load_blocking(paths[sl.index], o.max_bytes); // kernel without this opcode
+    }
+    on_done(sl.index, sl.l);
+    std::string().swap(sl.l.data); // plain assignment would keep the capacity in the slot
+    sl.l.err = 0;
+    unreserve(o, sl.reserved);
+    sl.live = false;
+    free_slots.push_back(s);
+    ++done;
+  };
+  // The ring failed for good. Nothing may return while the kernel can still write into
+  // a slot's buffer, so wait out every request it holds; then give back the budget the
+  // unfinished files hold, for the blocking loader that takes over.
+  auto abandon = [&] {
+    bool stuck = false;
+    while (in_flight > ring.unsubmitted()) {
+      if (ring.wait() < 0 && errno != EAGAIN && errno != EBUSY) { stuck = true; break; }
+      ring.reap([&](std::uint64_t ud, int res) {
+        --in_flight;
+        if (static_cast<Op>(ud & 0xff) == kOpen && res >= 0) ::close(res);
+      });
+    }
+    for (auto& sl : slots) {
+      if (!sl.live) continue;
+      if (sl.fd >= 0 && !stuck) ::close(sl.fd);
+      unreserve(o, sl.reserved);
+      sl.live = false;
+    }
+    // cannot even wait: leave the buffers to the kernel rather than free them under it
+    if (stuck) new std::vector<Slot>(std::move(slots));
+  };
+
+  while (done < paths.size()) {
+    // start new files while there is slot and SQ room (keep one SQE per slot for its close)
+    while (next < paths.size() && !free_slots.empty() && ring.room() > depth) {
+      const auto reserved = reserve(o, next);
+      if (reserved == kOverBudget) break; // wait for completions
+      const unsigned s = free_slots.back();
+      free_slots.pop_back();
+      auto& sl = slots[s];
+      sl.live = true;
+      sl.reserved = reserved;
+      sl.index = next++;
+      sl.fd = -1;
+      sl.got = 0;
+      sl.t0 = util::trace::enabled() ? util::stats::now_ns() : 0;
+      auto* e = ring.next();
+      e->opcode = IORING_OP_OPENAT;
+      e->fd = AT_FDCWD;
+      e->addr = reinterpret_cast<std::uint64_t>(paths[sl.index].c_str());
+      e->open_flags = O_RDONLY | O_CLOEXEC;
+      e->user_data = tag(s, kOpen);
+      ++in_flight;
+    }
+    if (ring.enter(in_flight > ring.unsubmitted() ? 1 : 0) < 0) {
+      // EAGAIN/EBUSY: the kernel is short of resources or the CQ is full; reaping below
+      // makes room, then the loop submits again
+      if ((errno != EAGAIN && errno != EBUSY) || ++busy > kMaxBusy) {
+        abandon();
+        return false; // the caller finishes the rest the blocking way
+      }
+      if (!ring.ready()) std::this_thread::yield();
+    } else {
+      busy = 0;
+    }
+
+    std::vector<unsigned> completed;
+    ring.reap([&](std::uint64_t ud, int res) {
+      --in_flight;
+      const auto op = static_cast<Op>(ud & 0xff);
+      const auto s = static_cast<unsigned>(ud >> 8);
+      if (op == kClose) return;
+      auto& sl = slots[s];
+      if (res < 0) { sl.l.err = -res; completed.push_back(s); return; }
+      if (op == kOpen) {
+        sl.fd = res;
+        struct stat st{};
+        if (::fstat(sl.fd, &st) != 0) { sl.l.err = errno; completed.push_back(s); return; }
+        if (static_cast<std::size_t>(st.st_size) > o.max_bytes) { sl.l.err = EFBIG; completed.push_back(s); return; }
+        sl.l.data.resize(static_cast<std::size_t>(st.st_size));
+        if (sl.l.data.empty()) { completed.push_back(s); return; }
+        queue_read(s);
+        return;
+      }
+      // kRead
+      sl.got += static_cast<std::size_t>(res);
+      if (res == 0 || sl.got == sl.l.data.size()) {
+        sl.l.data.resize(sl.got);
+        completed.push_back(s);
+      } else {
+        queue_read(s); // short read
+      }
+    });
+    // hand buffers to the parser while the kernel keeps working on the rest
+    for (unsigned s : completed) finish(s);
+  }
+  // drain outstanding closes
+  while (in_flight) {
+    if (ring.enter(in_flight > ring.unsubmitted() ? 1 : 0) < 0 && errno != EAGAIN && errno != EBUSY) break;
+    ring.reap([&](std::uint64_t, int) { --in_flight; });
+  }
+  return true;
+}
+
+#endif // HAVE_IO_URING
+
+} // namespace
+
+bool parse_engine(const std::string& s, Engine& out) {
+  if (s == "sync") out = Engine::Sync;
+  else if (s == "uring") out = Engine::Uring;
+  else return false;
+  return true;
+}
+
+bool uring_available() {
+#ifdef HAVE_IO_URING
+  Ring r;
+  return r.init(2);
+#else
+  return false;
+#endif
+}
+
+void load_files(const std::vector<std::string>& paths, const LoadOpts& o,
+                const std::function<void(std::size_t, Loaded&)>& on_done) {
+#ifdef HAVE_IO_URING
+  if (o.engine == Engine::Uring) {
+    std::vector<bool> seen(paths.size());
+    std::size_t delivered = 0;
+    auto track = [&](std::size_t i, Loaded& l) { seen[i] = true; ++delivered; on_done(i, l); };
+    if (load_all_uring(paths, o, track)) return;
+    if (delivered) {
+      // ring failed mid-run: finish the stragglers the blocking way
+      for (std::size_t i = 0; i < paths.size(); ++i) {
+        if (seen[i]) continue;
+        const auto c = reserve(o, i);
+        auto l = load_blocking(paths[i], o.max_bytes);
+        on_done(i, l);
+        unreserve(o, c);
+      }
+      return;
+    }
+  }
+#endif
+  load_all_blocking(paths, o, on_done);
+}
+
+} // namespace util::io
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "sched.hpp"
+
+// Bulk file loader for `--io uring`. Keeps many opens and reads in flight through an
+// io_uring (raw syscalls, no liburing) and hands each file back as one buffer as soon
+// as it completes, so parsing overlaps with the I/O still outstanding. Falls back to
+// blocking reads when io_uring is unavailable (old kernel, seccomp, non-Linux).
+namespace util::io {
+
+enum class Engine { Sync, Uring };
+
+bool parse_engine(const std::string& s, Engine& out);
+
+struct Loaded {
+  std::string data;
+  int err = 0; // errno; EFBIG when the file exceeds max_bytes (callers read it themselves)
+};
+
+struct LoadOpts {
+  Engine engine = Engine::Uring;
+  unsigned depth = 32;                      // files in flight
+  std::size_t max_bytes = std::size_t{1} << 28; // larger files are not preloaded
+  // Optional --max-memory budget: file i reserves cost(i) before it is opened and gives
+  // it back once on_done returns; files are admitted in order.
+  MemBudget* budget = nullptr;
+  std::function<std::uint64_t(std::size_t)> cost;
+};
+
+// Calls on_done(index, loaded) exactly once per path, in completion order, on the
+// calling thread. `loaded.data` is only valid during the call.
+void load_files(const std::vector<std::string>& paths, const LoadOpts& o,
+                const std::function<void(std::size_t, Loaded&)>& on_done);
+
+// True when this build and kernel can run the io_uring engine.
+bool uring_available();
+
+} // namespace util::io
@@ -0,0 +1,155 @@
+#include "journal.hpp"
+#include <cstring>
+#include <sys/stat.h>
+#include "commit.hpp"
+#include "hash.hpp"
+#include "stats.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#define fileno _fileno
+#define fsync _commit
+#define ftruncate _chsize_s
+#else
+#include <unistd.h>
+#endif
+
+namespace util {
+namespace {
+
+constexpr char kMagic[8] = {'M', 'S', 'W', 'J', 1, 0, 0, 0};
+constexpr std::size_t kFixed = 4 + 1 + 8 + 8;  // path length, outcome, inode, mtime
+constexpr std::size_t kMaxPath = 1u << 16;
+constexpr std::size_t kQueued = 1024;           // records per checkpoint
+constexpr auto kInterval = std::chrono::seconds(1);
+
+void put(std::string& o, std::uint64_t v, int bytes) {
+  for (int i = 0; i < bytes; ++i) o += static_cast<char>(v >> (8 * i));
+}
+
+std::uint64_t get(const unsigned char* p, int bytes) {
+  std::uint64_t v = 0;
+  for (int i = bytes - 1; i >= 0; --i) v = v << 8 | p[i];
+  return v;
+}
+
+} // namespace
+
+bool Journal::stamp(const std::string& path, Stamp& out) {
+  struct stat st{};
+  if (::stat(path.c_str(), &st) != 0) return false;
+  out.ino = static_cast<std::uint64_t>(st.st_ino);
+#if defined(__APPLE__)
+  out.mtime = std::int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+  out.mtime = std::int64_t(st.st_mtime) * 1000000000;
+#else
+  out.mtime = std::int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+  return true;
+}
+
+bool Journal::open(const std::string& path, bool resume) {
+  if (!resume) {
+    f_ = std::fopen(path.c_str(), "wb");
+    if (!f_) return false;
+    std::fwrite(kMagic, 1, sizeof kMagic, f_);
+    return std::fflush(f_) == 0;
+  }
+  f_ = std::fopen(path.c_str(), "r+b");
+  if (!f_) f_ = std::fopen(path.c_str(), "w+b");
+  if (!f_) return false;
+
+  // Load every whole record; stop at the first one that is short or fails its checksum
+  // (the write a crash interrupted) and cut the file there so appends stay aligned.
+  unsigned char head[sizeof kMagic];
+  long good = 0;
+  if (std::fread(head, 1, sizeof head, f_) == sizeof head && std::memcmp(head, kMagic, sizeof head) == 0) {
+    good = sizeof kMagic;
+    std::string rec;
+    unsigned char fixed[kFixed];
+    for (;;) {
+      if (std::fread(fixed, 1, kFixed, f_) != kFixed) break;
+      const auto len = static_cast<std::size_t>(get(fixed, 4));
+      if (len > kMaxPath) break;
+      rec.assign(reinterpret_cast<const char*>(fixed), kFixed);
+      rec.resize(kFixed + len + 4);
+      if (std::fread(rec.data() + kFixed, 1, len + 4, f_) != len + 4) break;
+      const auto* p = reinterpret_cast<const unsigned char*>(rec.data());
+      if (get(p + kFixed + len, 4) != (xxh64(p, kFixed + len) & 0xFFFFFFFFu)) break;
+      const auto key = xxh64(p + kFixed, len);
+      const auto outcome = static_cast<Outcome>(fixed[4]);
+      if (outcome == Outcome::Failed) done_.erase(key);
+      else done_[key] = {get(fixed + 5, 8), static_cast<std::int64_t>(get(fixed + 13, 8))};
+      good = std::ftell(f_);
+    }
+  }
+  if (good == 0) {
+    // empty, or not a journal we wrote: start over
+    std::rewind(f_);
+    std::fwrite(kMagic, 1, sizeof kMagic, f_);
+    good = sizeof kMagic;
+  }
+  std::fflush(f_);
+  if (::ftruncate(fileno(f_), good) != 0) return false;
+  return std::fseek(f_, good, SEEK_SET) == 0;
+}
+
+Journal::~Journal() {
+  if (!f_) return;
+  checkpoint();
+  std::fclose(f_);
+}
+
+bool Journal::done(const std::string& path) const {
+  if (done_.empty()) return false;
+  auto it = done_.find(xxh64(path.data(), path.size()));
+  Stamp now;
+  return it != done_.end() && stamp(path, now) && now.ino == it->second.ino && now.mtime == it->second.mtime;
+}
+
+void Journal::add(const std::string& path, const std::string& out, Outcome o) {
+  if (!f_) return;
+  std::lock_guard<std::mutex> lk(mu_);
+  queued_.push_back({path, out, o});
+}
+
+bool Journal::due() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return queued_.size() >= kQueued ||
+         (!queued_.empty() && std::chrono::steady_clock::now() - last_ >= kInterval);
+}
+
+std::vector<std::string> Journal::checkpoint() {
+  std::vector<Queued> batch;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    last_ = std::chrono::steady_clock::now();
+    batch.swap(queued_);
+  }
+  if (!f_ || batch.empty()) return {};
+  // a record must never promise an output that a crash could still lose, so the
+  // records are only built once the renames behind them have happened
+  auto lost = flush_outputs();
+  std::string buf;
+  for (auto& q : batch) {
+    Stamp s;
+    if (q.path.size() > kMaxPath || !stamp(q.path, s)) continue;
+    const auto o = q.outcome != Outcome::Failed && !q.out.empty() && output_lost(q.out) ? Outcome::Failed : q.outcome;
+    const auto& path = q.path;
+    const auto at = buf.size();
+    put(buf, path.size(), 4);
+    buf += static_cast<char>(o);
+    put(buf, s.ino, 8);
+    put(buf, static_cast<std::uint64_t>(s.mtime), 8);
+    buf += path;
+    put(buf, xxh64(buf.data() + at, buf.size() - at) & 0xFFFFFFFFu, 4);
+  }
+  util::stats::Timer t(util::stats::Phase::Fsync);
+  if (std::fwrite(buf.data(), 1, buf.size(), f_) == buf.size() && std::fflush(f_) == 0) {
+    ::fsync(fileno(f_));
+  }
+  return lost;
+}
+
+} // namespace util
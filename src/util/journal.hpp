@@ -0,0 +1,61 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// --journal / --resume: an append-only log of the files a strip run has finished, so a
+// run killed part way (OOM, preemption, a crashing input) restarts where it stopped.
+// Each record holds the path, the file's inode and mtime once its output is durable, and
+// the outcome, framed by a length and a checksum so a torn tail is detected and dropped.
+namespace util {
+
+class Journal {
+public:
+  enum class Outcome : std::uint8_t { Stripped, Unchanged, Duplicate, Failed };
+
+  Journal() = default;
+  ~Journal(); // checkpoints what is still queued
+  Journal(const Journal&) = delete;
+  Journal& operator=(const Journal&) = delete;
+
+  // Opens `path` for appending. With `resume` the records already there are loaded first;
+  // otherwise the journal starts empty.
+  bool open(const std::string& path, bool resume);
+  bool is_open() const { return f_ != nullptr; }
+  std::size_t loaded() const { return done_.size(); }
+
+  // True when an earlier run finished `path` and the file is still the one it left
+  // (same inode and mtime). One stat and one hash lookup.
+  bool done(const std::string& path) const;
+
+  // Queue a finished file whose output is `out`; it is written at the next checkpoint.
+  // Safe to call from any thread.
+  void add(const std::string& path, const std::string& out, Outcome o);
+  // Enough queued, or long enough since the last checkpoint
+  bool due() const;
+  // Make the outputs durable (flush_outputs), then append the queued records and fsync.
+  // An output whose rename failed (util::output_lost) is recorded as Failed whatever was
+  // queued, so the outcome only stands once the output is in place. Records are stat'ed
+  // here, so an in-place output is recorded as the file it became. Returns the outputs
+  // flush_outputs() reported lost. Called from one thread at a time.
+  std::vector<std::string> checkpoint();
+
+private:
+  struct Stamp { std::uint64_t ino = 0; std::int64_t mtime = 0; };
+  static bool stamp(const std::string& path, Stamp& out);
+
+  struct Queued { std::string path, out; Outcome outcome; };
+
+  std::FILE* f_ = nullptr;
+  std::unordered_map<std::uint64_t, Stamp> done_; // XXH64 of the path
+  mutable std::mutex mu_; // queued_ and last_
+  std::vector<Queued> queued_;
+  std::chrono::steady_clock::time_point last_ = std::chrono::steady_clock::now();
+};
+
+} // namespace util
@@ -0,0 +1,217 @@
+#include "sched.hpp"
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trace.hpp"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace util {
+
+bool parse_memory(const std::string& s, std::uint64_t& out) {
+  if (s.empty()) return false;
+  std::size_t i = 0;
+  std::uint64_t v = 0;
+  while (i < s.size() && s[i] >= '0' && s[i] <= '9') v = v * 10 + std::uint64_t(s[i++] - '0');
+  if (i == 0) return false;
+  std::string suf = s.substr(i);
+  if (suf == "" || suf == "B") out = v;
+  else if (suf == "K" || suf == "KB" || suf == "KiB") out = v << 10;
+  else if (suf == "M" || suf == "MB" || suf == "MiB") out = v << 20;
+  else if (suf == "G" || suf == "GB" || suf == "GiB") out = v << 30;
+  else return false;
+  return true;
+}
+
+bool MemBudget::try_acquire(std::uint64_t n) {
+  std::lock_guard<std::mutex> lk(mu_);
+  if (limit_ && holders_ && used_ + n > limit_) return false;
+  used_ += n;
+  ++holders_;
+  peak_ = std::max(peak_, used_);
+  return true;
+}
+
+void MemBudget::release(std::uint64_t n) {
+  std::lock_guard<std::mutex> lk(mu_);
+  used_ -= std::min(used_, n);
+  if (holders_) --holders_;
+}
+
+std::uint64_t MemBudget::peak() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return peak_;
+}
+
+void bound_heap_retention() {
+#ifdef __GLIBC__
+  // a fixed threshold also disables the dynamic one that follows the largest free
+  mallopt(M_MMAP_THRESHOLD, 1 << 20);
+#endif
+}
+
+WorkerPool::WorkerPool(unsigned jobs, MemBudget& budget)
+    : jobs_(jobs), budget_(budget), queues_(1), caps_(1, 0), running_(1, 0) {
+  if (jobs_ <= 1) return;
+  threads_.reserve(jobs_);
+  for (unsigned t = 0; t < jobs_; ++t) threads_.emplace_back([this, t] { worker(t); });
+}
+
+WorkerPool::~WorkerPool() {
+  if (!batches_.empty()) wait(first_ + batches_.size() - 1);
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& th : threads_) th.join();
+}
+
+WorkerPool::Batch WorkerPool::submit(std::size_t n, std::function<std::uint64_t(std::size_t)> cost,
+                                     std::function<void(std::size_t)> fn, const Lanes* lanes) {
+  std::vector<Pending> tasks;
+  if (jobs_ > 1) {
+    // costs and lanes up front, outside the lock; inline runs take them as they go
+    const std::size_t nlanes = std::max(queues_.size(), lanes ? lanes->limit.size() : std::size_t{0});
+    tasks.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      tasks.push_back({0, i, lanes ? std::min(lanes->of(i), nlanes - 1) : 0, cost(i)});
+    }
+  }
+  std::lock_guard<std::mutex> lk(mu_);
+  const Batch b = first_ + batches_.size();
+  auto& w = batches_.emplace_back();
+  w.cost = std::move(cost);
+  w.fn = std::move(fn);
+  w.n = w.left = n;
+  if (lanes && lanes->limit.size() > queues_.size()) {
+    queues_.resize(lanes->limit.size());
+    running_.resize(lanes->limit.size(), 0);
+  }
+  if (lanes) caps_ = lanes->limit;
+  caps_.resize(queues_.size(), 0);
+  for (auto& t : tasks) {
+    t.batch = b;
+    queues_[t.lane].push_back(t);
+  }
+  queued_ += tasks.size();
+  cv_.notify_all();
+  return b;
+}
+
+bool WorkerPool::pick(Pending& out) {
+  // how far to look past a held-back task, and how often it may be overtaken
+  const std::size_t lookahead = std::size_t{jobs_} * 8;
+  const unsigned max_overtakes = jobs_ * 4;
+  order_.clear(); // open lanes, earliest head first
+  held_.clear();  // heads the budget held back during this pick
+  for (std::size_t l = 0; l < queues_.size(); ++l) {
+    if (queues_[l].empty() || (caps_[l] && running_[l] >= caps_[l])) continue;
+    order_.push_back(l);
+  }
+  std::sort(order_.begin(), order_.end(), [&](std::size_t a, std::size_t b) {
+    const auto& x = queues_[a].front();
+    const auto& y = queues_[b].front();
+    return x.batch != y.batch ? x.batch < y.batch : x.index < y.index;
+  });
+  auto take = [&](std::size_t l, std::size_t k) {
+    auto& q = queues_[l];
+    out = q[k];
+    for (std::size_t j = 0; j < k; ++j) ++q[j].overtaken;
+    q.erase(q.begin() + static_cast<std::ptrdiff_t>(k));
+    for (auto* h : held_) ++h->overtaken;
+    ++running_[l];
+    --queued_;
+    return true;
+  };
+  for (auto l : order_) {
+    auto& q = queues_[l];
+    auto& head = q.front();
+    if (budget_.try_acquire(head.cost)) return take(l, 0);
+    if (head.overtaken >= max_overtakes) return false; // let the budget drain for it
+    const auto end = std::min(q.size(), lookahead + 1);
+    for (std::size_t k = 1; k < end; ++k) {
+      if (budget_.try_acquire(q[k].cost)) return take(l, k);
+    }
+    held_.push_back(&head);
+  }
+  return false;
+}
+
+void WorkerPool::worker(unsigned t) {
+  trace::set_thread_name("worker-" + std::to_string(t + 1));
+  for (;;) {
+    Pending task{};
+    Work* w = nullptr;
+    {
+      std::unique_lock<std::mutex> lk(mu_);
+      bool got = false;
+      cv_.wait(lk, [&] { return (stop_ && queued_ == 0) || (got = pick(task)); });
+      if (!got) return; // stopped and drained
+      w = &work(task.batch);
+    }
+    w->fn(task.index);
+    budget_.release(task.cost);
+    {
+      std::lock_guard<std::mutex> lk(mu_); // pair with the waiters' predicate check
+      --running_[task.lane];
+      --w->left;
+    }
+    cv_.notify_all();
+  }
+}
+
+void WorkerPool::wait(Batch b, const std::function<void()>& tick) {
+  if (jobs_ <= 1) {
+    // one task at a time is already the smallest footprint possible
+    for (; !batches_.empty() && first_ <= b; batches_.pop_front(), ++first_) {
+      auto& w = batches_.front();
+      for (; w.left; --w.left) {
+        const auto i = w.n - w.left;
+        const auto c = w.cost(i);
+        budget_.try_acquire(c);
+        w.fn(i);
+        budget_.release(c);
+        if (tick) tick();
+      }
+    }
+    return;
+  }
+  std::unique_lock<std::mutex> lk(mu_);
+  auto done = [&] {
+    for (Batch x = first_; x <= b && x - first_ < batches_.size(); ++x) {
+      if (work(x).left) return false;
+    }
+    return true;
+  };
+  if (tick) {
+    // wakes on every finished task (notify_all) and on the timeout
+    for (bool all_done = false; !all_done;) {
+      if (!(all_done = done())) {
+        cv_.wait_for(lk, std::chrono::milliseconds(100));
+        all_done = done();
+      }
+      lk.unlock();
+      tick();
+      lk.lock();
+    }
+  } else {
+    cv_.wait(lk, done);
+  }
+  for (; !batches_.empty() && first_ <= b; batches_.pop_front()) ++first_;
+}
+
+void run_budgeted(std::size_t n, unsigned jobs, MemBudget& budget,
+                  const std::function<std::uint64_t(std::size_t)>& cost,
+                  const std::function<void(std::size_t)>& fn,
+                  const Lanes* lanes,
+                  const std::function<void()>& tick) {
+  WorkerPool pool(jobs, budget);
+  pool.wait(pool.submit(n, cost, fn, lanes), tick);
+}
+
+} // namespace util
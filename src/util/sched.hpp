@@ -0,0 +1,110 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Memory-budgeted dispatch for `--jobs` / `--max-memory`. Every task reserves its
+// estimated footprint before it starts and gives it back when it finishes, so the sum
+// of in-flight reservations never exceeds the budget. A task larger than the whole
+// budget still runs, but only once nothing else holds memory.
+namespace util {
+
+// "512M", "4G", "1048576"; binary units. 0 means unlimited.
+bool parse_memory(const std::string& s, std::uint64_t& out);
+
+class MemBudget {
+public:
+  explicit MemBudget(std::uint64_t limit = 0) : limit_(limit) {}
+
+  bool unlimited() const { return limit_ == 0; }
+  // Non-blocking; succeeds when `n` fits, or when nothing is reserved (oversize runs alone).
+  bool try_acquire(std::uint64_t n);
+  void release(std::uint64_t n);
+  std::uint64_t peak() const;
+
+private:
+  mutable std::mutex mu_;
+  std::uint64_t limit_;
+  std::uint64_t used_ = 0;
+  std::uint64_t peak_ = 0;
+  unsigned holders_ = 0;
+};
+
+// Make the allocator hand large freed buffers back to the OS right away. glibc's
+// adaptive mmap threshold otherwise keeps them in per-thread arenas, and resident
+// memory ends up well above what the budget accounts for. No-op elsewhere.
+void bound_heap_retention();
+
+// Concurrency caps by task class (one lane per backend): task i runs in lane of(i), and
+// at most limit[lane] tasks of a lane are in flight at once (0 = no cap).
+struct Lanes {
+  std::function<std::size_t(std::size_t)> of;
+  std::vector<unsigned> limit;
+};
+
+// The threads behind run_budgeted, kept for a whole run that is fed in batches (one per
+// chunk of a long file list): they start once, and a batch's last tasks overlap the next
+// batch's first instead of every worker waiting for the slowest file. Batches dispatch in
+// submission order under one budget, each task by the rules of run_budgeted.
+class WorkerPool {
+public:
+  using Batch = std::size_t;
+
+  WorkerPool(unsigned jobs, MemBudget& budget); // jobs <= 1: no threads, wait() runs inline
+  ~WorkerPool();                                // waits for what is queued, then joins
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Queues fn(i) for i in [0, n). What `cost` and `fn` refer to must stay valid until
+  // wait() for this batch returns. Every batch's lanes must share one limit vector.
+  Batch submit(std::size_t n, std::function<std::uint64_t(std::size_t)> cost,
+               std::function<void(std::size_t)> fn, const Lanes* lanes = nullptr);
+  // Returns once `b` and every batch before it finished. `tick` as in run_budgeted.
+  void wait(Batch b, const std::function<void()>& tick = {});
+
+private:
+  struct Pending { Batch batch; std::size_t index, lane; std::uint64_t cost; unsigned overtaken = 0; };
+  struct Work {
+    std::function<std::uint64_t(std::size_t)> cost;
+    std::function<void(std::size_t)> fn;
+    std::size_t n = 0, left = 0; // tasks, and those not finished yet
+  };
+  bool pick(Pending& out); // with mu_ held
+  void worker(unsigned t);
+  Work& work(Batch b) { return batches_[b - first_]; }
+
+  unsigned jobs_;
+  MemBudget& budget_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<Work> batches_; // from first_ on; references stay valid as batches are added
+  Batch first_ = 0;
+  std::vector<std::deque<Pending>> queues_; // one per lane, each in submission order
+  std::vector<unsigned> caps_, running_;
+  std::vector<std::size_t> order_; // pick() scratch
+  std::vector<Pending*> held_;
+  std::size_t queued_ = 0; // tasks not picked yet
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+// Runs fn(i) for i in [0, n) on `jobs` threads (jobs <= 1 runs inline, in order).
+// Tasks start in index order unless the next one does not fit in `budget`; then later
+// tasks that fit go first, up to a bounded number of overtakes per held-back task, after
+// which dispatch waits for it so large files are never starved. With `lanes`, a task
+// whose lane is full waits without holding back the other lanes. fn must not throw.
+// `tick`, when given, runs on the calling thread after tasks finish (at least every
+// 100 ms while they run), for housekeeping that must stay off the workers.
+void run_budgeted(std::size_t n, unsigned jobs, MemBudget& budget,
+                  const std::function<std::uint64_t(std::size_t)>& cost,
+                  const std::function<void(std::size_t)>& fn,
+                  const Lanes* lanes = nullptr,
+                  const std::function<void()>& tick = {});
+
+} // namespace util
@@ -0,0 +1,89 @@
+#include "stats.hpp"
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace util::stats {
+namespace {
+std::mutex g_mu;
+std::vector<std::unique_ptr<Totals>> g_threads; // never shrinks: slots outlive their threads
+std::uint64_t g_start = 0;
+} // namespace
+
+std::atomic<bool> g_enabled{false};
+
+const char* phase_name(Phase p) {
+  switch (p) {
+    case Phase::Walk:   return "walk";
+    case Phase::Detect: return "detect";
+    case Phase::Open:   return "open";
+    case Phase::Parse:  return "parse";
+    case Phase::Policy: return "policy";
+    case Phase::Write:  return "write";
+    case Phase::Fsync:  return "fsync";
+    case Phase::Rename: return "rename";
+    default:            return "?";
+  }
+}
+
+void enable() {
+  g_start = now_ns();
+  g_enabled.store(true, std::memory_order_relaxed);
+}
+
+Totals& local() {
+  thread_local Totals* mine = [] {
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_threads.push_back(std::make_unique<Totals>());
+    return g_threads.back().get();
+  }();
+  return *mine;
+}
+
+void record(Phase p, std::uint64_t ns) {
+  auto& t = local();
+  const int i = static_cast<int>(p);
+  ++t.calls[i];
+  t.ns[i] += ns;
+  t.max_ns[i] = std::max(t.max_ns[i], ns);
+  const int b = std::min(kBuckets - 1, ns ? static_cast<int>(std::bit_width(ns)) - 1 : 0);
+  ++t.hist[i][b];
+}
+
+Totals snapshot() {
+  Totals s;
+  std::lock_guard<std::mutex> lk(g_mu);
+  for (auto& t : g_threads) {
+    for (int i = 0; i < kPhases; ++i) {
+      s.calls[i] += t->calls[i];
+      s.ns[i] += t->ns[i];
+      s.max_ns[i] = std::max(s.max_ns[i], t->max_ns[i]);
+      for (int b = 0; b < kBuckets; ++b) s.hist[i][b] += t->hist[i][b];
+    }
+    s.bytes_read += t->bytes_read;
+    s.bytes_written += t->bytes_written;
+    for (int k = 0; k < kSlots; ++k) {
+      s.inspected[k] += t->inspected[k];
+      s.stripped[k] += t->stripped[k];
+    }
+  }
+  s.wall_ns = g_start ? now_ns() - g_start : 0;
+  return s;
+}
+
+std::uint64_t percentile(const Totals& t, Phase p, double q) {
+  const int i = static_cast<int>(p);
+  if (!t.calls[i]) return 0;
+  const auto want = static_cast<std::uint64_t>(q * static_cast<double>(t.calls[i]));
+  std::uint64_t seen = 0;
+  for (int b = 0; b < kBuckets; ++b) {
+    seen += t.hist[i][b];
+    // report the bucket's upper edge, clamped to the observed maximum
+    if (seen > want) return std::min(t.max_ns[i], (std::uint64_t{2} << b) - 1);
+  }
+  return t.max_ns[i];
+}
+
+} // namespace util::stats
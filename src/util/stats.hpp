@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include "trace.hpp"
+
+// Per-phase timers and counters for `--stats`. Each thread accumulates into its own
+// slot; snapshot() merges them once the work is done. When stats are off every hook
+// is a single relaxed load and a branch.
+namespace util::stats {
+
+enum class Phase : std::uint8_t { Walk, Detect, Open, Parse, Policy, Write, Fsync, Rename, Count_ };
+inline constexpr int kPhases = static_cast<int>(Phase::Count_);
+inline constexpr int kBuckets = 40; // log2(ns) buckets, last one is open-ended
+inline constexpr int kSlots = 8;    // per-backend counters, indexed by core::FileType
+
+const char* phase_name(Phase p);
+
+struct Totals {
+  std::array<std::uint64_t, kPhases> calls{};
+  std::array<std::uint64_t, kPhases> ns{};
+  std::array<std::uint64_t, kPhases> max_ns{};
+  std::array<std::array<std::uint64_t, kBuckets>, kPhases> hist{};
+  std::uint64_t bytes_read = 0;
+  std::uint64_t bytes_written = 0;
+  std::array<std::uint64_t, kSlots> inspected{};
+  std::array<std::uint64_t, kSlots> stripped{};
+  std::uint64_t wall_ns = 0; // filled by snapshot()
+};
+
+extern std::atomic<bool> g_enabled;
+inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+// Turn collection on and start the wall clock. Call before any worker starts.
+void enable();
+
+// This thread's accumulator (registered on first use, lives until exit).
+Totals& local();
+
+// Merge all threads. Call after workers have finished.
+Totals snapshot();
+
+// Approximate latency at quantile q (0..1) from a phase histogram, in ns.
+std::uint64_t percentile(const Totals& t, Phase p, double q);
+
+inline std::uint64_t now_ns() {
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now().time_since_epoch())
+                                      .count());
+}
+
+void record(Phase p, std::uint64_t ns);
+
+inline void bytes_read(std::uint64_t n) {
+  if (enabled()) local().bytes_read += n;
+}
+inline void bytes_written(std::uint64_t n) {
+  if (enabled()) local().bytes_written += n;
+}
+inline void inspected(int slot) {
+  if (enabled() && slot >= 0 && slot < kSlots) ++local().inspected[slot];
+}
+inline void stripped(int slot) {
+  if (enabled() && slot >= 0 && slot < kSlots) ++local().stripped[slot];
+}
+
+// RAII phase timer. Also emits a trace span (tagged with `path`) when --trace is on;
+// `path` must outlive the timer.
+class Timer {
+public:
+  explicit Timer(Phase p, std::string_view path = {})
+    : p_(p), path_(path), t0_(enabled() || trace::enabled() ? now_ns() : 0) {}
+  ~Timer() {
+    if (!t0_) return;
+    const auto dur = now_ns() - t0_;
+    if (enabled()) record(p_, dur);
+    if (trace::enabled()) trace::emit(phase_name(p_), path_, t0_, dur);
+  }
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
+
+private:
+  Phase p_;
+  std::string_view path_;
+  std::uint64_t t0_;
+};
+
+} // namespace util::stats
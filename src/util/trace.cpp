@@ -0,0 +1,127 @@
+#include "trace.hpp"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "stats.hpp"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace util::trace {
+namespace {
+
+struct Event {
+  const char* name;
+  std::string path;
+  std::uint64_t ts_ns, dur_ns;
+};
+
+// Bounded so a trace left on under production load cannot eat the heap.
+constexpr std::size_t kMaxEventsPerThread = 1u << 20;
+
+struct Buffer {
+  int tid = 0;
+  std::string name;
+  std::vector<Event> events;
+  std::uint64_t dropped = 0;
+};
+
+std::mutex g_mu; // registration and final write only
+std::vector<std::unique_ptr<Buffer>> g_buffers;
+std::uint64_t g_origin = 0;
+
+Buffer& local() {
+  thread_local Buffer* mine = [] {
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_buffers.push_back(std::make_unique<Buffer>());
+    auto* b = g_buffers.back().get();
+    b->tid = static_cast<int>(g_buffers.size());
+    b->name = b->tid == 1 ? "main" : "thread-" + std::to_string(b->tid);
+    b->events.reserve(4096);
+    return b;
+  }();
+  return *mine;
+}
+
+void json_string(std::ostream& f, std::string_view s) {
+  f << '"';
+  for (char c : s) {
+    switch (c) {
+      case '\\': f << "\\\\"; break;
+      case '"':  f << "\\\""; break;
+      case '\n': f << "\\n"; break;
+      case '\t': f << "\\t"; break;
+      default:   f << ((unsigned char)c < 0x20 ? '?' : c); break;
+    }
+  }
+  f << '"';
+}
+
+void micros(std::ostream& f, std::uint64_t ns) {
+  f << ns / 1000 << '.' << static_cast<char>('0' + ns / 100 % 10) << static_cast<char>('0' + ns / 10 % 10)
+    << static_cast<char>('0' + ns % 10);
+}
+
+} // namespace
+
+std::atomic<bool> g_enabled{false};
+
+void enable() {
+  g_origin = stats::now_ns();
+  local(); // the enabling thread becomes tid 1 ("main")
+  g_enabled.store(true, std::memory_order_relaxed);
+}
+
+void emit(const char* name, std::string_view path, std::uint64_t start_ns, std::uint64_t dur_ns) {
+  auto& b = local();
+  if (b.events.size() >= kMaxEventsPerThread) { ++b.dropped; return; }
+  b.events.push_back({name, std::string(path), start_ns, dur_ns});
+}
+
+void set_thread_name(std::string name) {
+  if (enabled()) local().name = std::move(name);
+}
+
+bool write(const std::string& path) {
+  std::ofstream f(path, std::ios::binary | std::ios::trunc);
+  if (!f) return false;
+  const auto pid = static_cast<long>(getpid());
+  std::lock_guard<std::mutex> lk(g_mu);
+  f << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  f << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << pid << ",\"tid\":0,\"args\":{\"name\":\"metasweep\"}}";
+  for (auto& b : g_buffers) {
+    f << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << b->tid
+      << ",\"args\":{\"name\":";
+    json_string(f, b->name);
+    f << ",\"dropped_events\":" << b->dropped << "}}";
+    for (auto& e : b->events) {
+      f << ",\n{\"ph\":\"X\",\"cat\":\"metasweep\",\"name\":\"" << e.name << "\",\"pid\":" << pid
+        << ",\"tid\":" << b->tid << ",\"ts\":";
+      micros(f, e.ts_ns - g_origin);
+      f << ",\"dur\":";
+      micros(f, e.dur_ns);
+      if (!e.path.empty()) {
+        f << ",\"args\":{\"path\":";
+        json_string(f, e.path);
+        f << '}';
+      }
+      f << '}';
+    }
+  }
+  f << "\n]}\n";
+  return static_cast<bool>(f);
+}
+
+Span::Span(const char* name, std::string_view path)
+  : name_(name), path_(path), t0_(enabled() ? stats::now_ns() : 0) {}
+
+Span::~Span() {
+  if (t0_) emit(name_, path_, t0_, stats::now_ns() - t0_);
+}
+
+} // namespace util::trace
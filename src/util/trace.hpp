@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Chrome trace-event recorder for `--trace out.json` (loads in Perfetto / chrome://tracing).
+// Each thread appends complete ("X") events to its own buffer without locking; the buffers
+// are merged and written once at the end of the run.
+namespace util::trace {
+
+extern std::atomic<bool> g_enabled;
+inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+// Turn recording on. Call before any worker starts.
+void enable();
+
+// Append a finished span to this thread's buffer (timestamps from util::stats::now_ns()).
+void emit(const char* name, std::string_view path, std::uint64_t start_ns, std::uint64_t dur_ns);
+
+// Name the calling thread in the trace ("main", "worker-3", ...).
+void set_thread_name(std::string name);
+
+// Write every buffered event; call after workers have finished.
+bool write(const std::string& path);
+
+// RAII span for work that is not a stats phase (e.g. the per-file envelope).
+class Span {
+public:
+  Span(const char* name, std::string_view path);
+  ~Span();
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+private:
+  const char* name_;
+  std::string_view path_;
+  std::uint64_t t0_;
+};
+
+} // namespace util::trace
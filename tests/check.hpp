@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdio>
+
+// CHECK / CHECK_EQ for the plain test executables: a failed check is printed and counted,
+// and main() ends with `return test_result();`.
+
+inline int failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++failures; } \
+  } while (0)
+
+#define CHECK_EQ(a, b) \
+  do { \
+    const auto& va_ = (a); const auto& vb_ = (b); \
+    if (!(va_ == vb_)) { \
+      std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed\n", __FILE__, __LINE__, #a, #b); ++failures; \
+    } \
+  } while (0)
+
+inline int test_result() {
+  if (failures) std::fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
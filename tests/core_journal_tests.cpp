@@ -0,0 +1,138 @@
+// The --journal / --resume log: torn tails, replay, and checkpoints during a run.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "util/journal.hpp"
+#include "util/sched.hpp"
+#include "check.hpp"
+
+namespace {
+
+namespace fs = std::filesystem;
+using Outcome = util::Journal::Outcome;
+
+// A fresh directory holding `n` small files; returns their paths
+std::vector<std::string> make_files(const fs::path& dir, std::size_t n) {
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  std::vector<std::string> files;
+  for (std::size_t i = 0; i < n; ++i) {
+    files.push_back((dir / ("f" + std::to_string(i))).string());
+    std::ofstream(files.back(), std::ios::binary) << "file " << i;
+  }
+  return files;
+}
+
+// A crash in the middle of the last append leaves a short record: resume drops it, cuts
+// the file there, and appends after the last whole record
+void test_truncated_tail() {
+  const auto dir = fs::temp_directory_path() / "core_journal_tail";
+  const auto files = make_files(dir, 3);
+  const auto path = (dir / "journal").string();
+  {
+    util::Journal j;
+    CHECK(j.open(path, false));
+    for (auto& f : files) j.add(f, {}, Outcome::Unchanged);
+    j.checkpoint();
+  }
+  const auto whole = fs::file_size(path);
+  fs::resize_file(path, whole - 5); // into the last record's path
+
+  {
+    util::Journal j;
+    CHECK(j.open(path, true));
+    CHECK_EQ(j.loaded(), std::size_t{2});
+    CHECK(j.done(files[0]));
+    CHECK(j.done(files[1]));
+    CHECK(!j.done(files[2]));
+    CHECK(fs::file_size(path) < whole - 5); // the torn record is gone, not kept as garbage
+    j.add(files[2], {}, Outcome::Unchanged);
+  }
+  util::Journal j;
+  CHECK(j.open(path, true));
+  CHECK_EQ(j.loaded(), std::size_t{3});
+  CHECK(j.done(files[2]));
+  fs::remove_all(dir);
+}
+
+// Resume skips what an earlier run finished, but not failures, and not a file changed
+// since its record was written
+void test_replay_skips_done() {
+  const auto dir = fs::temp_directory_path() / "core_journal_replay";
+  const auto files = make_files(dir, 5);
+  const auto path = (dir / "journal").string();
+  {
+    util::Journal j;
+    CHECK(j.open(path, false));
+    j.add(files[0], {}, Outcome::Unchanged);
+    j.add(files[1], {}, Outcome::Failed);
+    j.add(files[2], {}, Outcome::Duplicate);
+    j.add(files[3], {}, Outcome::Unchanged);
+  }
+  fs::last_write_time(files[3], fs::last_write_time(files[3]) + std::chrono::seconds(10));
+
+  util::Journal j;
+  CHECK(j.open(path, true));
+  auto todo = files;
+  std::erase_if(todo, [&](const std::string& f) { return j.done(f); });
+  CHECK(todo == (std::vector<std::string>{files[1], files[3], files[4]}));
+
+  // a later Failed record for the same path undoes an earlier success
+  j.add(files[0], {}, Outcome::Failed);
+  j.checkpoint();
+  util::Journal again;
+  CHECK(again.open(path, true));
+  CHECK(!again.done(files[0]));
+  CHECK(again.done(files[2]));
+  fs::remove_all(dir);
+}
+
+// Workers only queue records; the thread that dispatches them checkpoints from run_budgeted's
+// tick while files are still running, as strip does
+void test_checkpoint_on_dispatching_thread() {
+  const auto dir = fs::temp_directory_path() / "core_journal_tick";
+  const auto files = make_files(dir, 2100); // two checkpoints' worth of queued records
+  const auto path = (dir / "journal").string();
+  util::Journal j;
+  CHECK(j.open(path, false));
+  const auto main_id = std::this_thread::get_id();
+  std::atomic<std::size_t> finished{0};
+  std::size_t during = 0; // checkpoints written while files were still being processed
+  bool off_thread = false;
+  util::MemBudget budget;
+  util::run_budgeted(files.size(), 4, budget, [](std::size_t) { return std::uint64_t{0}; },
+      [&](std::size_t i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1)); // some work to overlap
+        j.add(files[i], {}, Outcome::Unchanged);
+        ++finished;
+      },
+      nullptr,
+      [&] {
+        if (std::this_thread::get_id() != main_id) off_thread = true;
+        if (!j.due()) return;
+        j.checkpoint();
+        if (finished < files.size()) ++during;
+      });
+  j.checkpoint();
+  CHECK(!off_thread);
+  CHECK(during >= 1);
+
+  util::Journal back;
+  CHECK(back.open(path, true));
+  CHECK_EQ(back.loaded(), files.size());
+  fs::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+  test_truncated_tail();
+  test_replay_skips_done();
+  test_checkpoint_on_dispatching_thread();
+  return test_result();
+}
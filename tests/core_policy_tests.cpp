@@ -0,0 +1,153 @@
+// Field classification and policy matching.
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "core/fields.hpp"
+#include "core/policy.hpp"
+#include "check.hpp"
+
+namespace {
+
+// The classifications risk_for() gave before the field table existed.
+void test_risk_for() {
+  using core::risk_for;
+  CHECK_EQ(risk_for("EXIF.GPSLatitude"), std::string_view("HIGH"));
+  CHECK_EQ(risk_for("EXIF.GPSLongitude"), std::string_view("HIGH"));
+  CHECK_EQ(risk_for("EXIF.GPSAltitude"), std::string_view("HIGH"));
+  CHECK_EQ(risk_for("EXIF.SerialNumber"), std::string_view("MEDIUM"));
+  CHECK_EQ(risk_for("EXIF.Make"), std::string_view("MEDIUM"));
+  CHECK_EQ(risk_for("EXIF.Model"), std::string_view("MEDIUM"));
+  CHECK_EQ(risk_for("EXIF.Orientation"), std::string_view("SAFE"));
+  CHECK_EQ(risk_for("EXIF.Artist"), std::string_view("LOW"));
+  CHECK_EQ(risk_for("Image.ColorProfile"), std::string_view("SAFE"));
+  CHECK_EQ(risk_for("Image.DPI"), std::string_view("SAFE"));
+  CHECK_EQ(risk_for("PDF.Title"), std::string_view("MEDIUM"));
+  CHECK_EQ(risk_for("PDF.Author"), std::string_view("MEDIUM"));
+  CHECK_EQ(risk_for("PDF.Keywords"), std::string_view("MEDIUM"));
+  CHECK_EQ(risk_for("PDF.CreationDate"), std::string_view("HIGH"));
+  CHECK_EQ(risk_for("PDF.ModDate"), std::string_view("HIGH"));
+  CHECK_EQ(risk_for("ID3.TPE1"), std::string_view("MEDIUM"));
+  CHECK_EQ(risk_for("ID3.TALB"), std::string_view("MEDIUM"));
+  CHECK_EQ(risk_for("ID3.TDRC"), std::string_view("LOW"));
+  CHECK_EQ(risk_for("ID3.TIT2"), std::string_view("LOW"));
+  CHECK_EQ(risk_for("ZIP.Comment"), std::string_view("LOW"));
+  CHECK_EQ(risk_for("XMP.CreatorTool"), std::string_view("LOW"));
+  CHECK_EQ(risk_for("Unknown.Field"), std::string_view("LOW"));
+  // image XMP keeps the Exiv2-key fallback
+  CHECK_EQ(risk_for("XMP.Xmp.dc.creator"), std::string_view("LOW"));
+  CHECK_EQ(risk_for("XMP.Xmp.xmp.CreateDate"), std::string_view("LOW"));
+}
+
+// Image XMP (Exiv2 keys) and PDF XMP (qualified names) are classified separately.
+void test_xmp_fields() {
+  const auto img = core::make_field("XMP.", "Xmp.dc.creator", "Alice", "XMP", 20);
+  CHECK_EQ(img.canonical, std::string("XMP.Xmp.dc.creator"));
+  CHECK_EQ(img.risk, std::string("LOW"));
+  CHECK(img.tag == core::RiskTag::None);
+  const auto tool = core::make_field("XMP.", "Xmp.xmp.CreatorTool", "GIMP", "XMP", 20);
+  CHECK_EQ(tool.canonical, std::string("XMP.CreatorTool"));
+  CHECK(tool.tag == core::RiskTag::Software);
+  const auto pdf = core::make_field("XMP.", "dc:creator", "Alice", "XMP", 20);
+  CHECK_EQ(pdf.canonical, std::string("XMP.Creator"));
+  CHECK_EQ(pdf.risk, std::string("MEDIUM"));
+  CHECK(pdf.tag == core::RiskTag::Author);
+  const auto date = core::make_field("XMP.", "xmp:CreateDate", "2024", "XMP", 20);
+  CHECK_EQ(date.risk, std::string("HIGH"));
+}
+
+void test_field_lookup() {
+  for (const auto& f : core::kFields) {
+    CHECK(core::field_by_native(f.native) != nullptr);
+    CHECK(core::field_by_canonical(f.canonical) != nullptr);
+  }
+  const auto* lat = core::field_by_native("Exif.GPSInfo.GPSLatitudeRef");
+  CHECK(lat && lat->canonical == "EXIF.GPSLatitude" && lat->tag == core::RiskTag::GPS);
+  CHECK(core::field_by_native("EXIF.GPSLatitude") == nullptr); // canonical, not native
+  CHECK(core::field_by_canonical("Exif.GPSInfo.GPSLatitude") == nullptr);
+}
+
+void test_glob_match() {
+  using core::glob_match;
+  CHECK(glob_match("*", "EXIF.Make"));
+  CHECK(glob_match("*", ""));
+  CHECK(glob_match("EXIF.*", "EXIF.Make"));
+  CHECK(glob_match("EXIF.*", "EXIF."));
+  CHECK(!glob_match("EXIF.*", "XMP.EXIF.Make"));
+  CHECK(glob_match("EXIF.?ake", "EXIF.Make"));
+  CHECK(!glob_match("EXIF.?ake", "EXIF.ake"));
+  CHECK(glob_match("*.GPS*", "EXIF.GPSLatitude"));
+  CHECK(!glob_match("EXIF.Make", "EXIF.Model"));
+}
+
+core::Policy keeping(std::vector<std::string> keep) {
+  core::Policy p;
+  p.keep = std::move(keep);
+  p.drop = {"*"};
+  return p;
+}
+
+// block_action must agree with policy_keep on every name under the prefix
+void check_consistent(const core::Policy& p, std::string_view prefix) {
+  static const char* const kNames[] = {
+    "EXIF.", "EXIF.Make", "EXIF.Model", "EXIF.GPSLatitude", "EXIF.Orientation", "PDF.Author",
+    "PDF.Title", "Image.DPI", "Image.ColorProfile", "ID3.TPE1", "XMP.CreatorTool", "ZIP.Comment"};
+  const auto a = core::block_action(p, prefix);
+  for (const char* n : kNames) {
+    const std::string name(n);
+    if (!name.starts_with(prefix)) continue;
+    if (a == core::BlockAction::KeepAll) CHECK(core::policy_keep(p, name));
+    if (a == core::BlockAction::DropAll) CHECK(!core::policy_keep(p, name));
+  }
+}
+
+void test_block_action() {
+  using core::BlockAction;
+  using core::block_action;
+  // wildcards
+  CHECK(block_action(keeping({"*"}), "EXIF.") == BlockAction::KeepAll);
+  CHECK(block_action(keeping({"*"}), "PDF.") == BlockAction::KeepAll);
+  CHECK(block_action(keeping({"EXIF.*"}), "EXIF.") == BlockAction::KeepAll);
+  CHECK(block_action(keeping({"EXIF.*"}), "PDF.") == BlockAction::DropAll);
+  CHECK(block_action(keeping({"E?IF.*"}), "EXIF.") == BlockAction::KeepAll);
+  CHECK(block_action(keeping({"EXIF.?ake"}), "EXIF.") == BlockAction::Mixed);
+  CHECK(block_action(keeping({"*.*"}), "EXIF.") == BlockAction::KeepAll);
+  // exact prefix: only the name equal to it matches
+  CHECK(block_action(keeping({"EXIF."}), "EXIF.") == BlockAction::Mixed);
+  CHECK(block_action(keeping({"EXIF"}), "EXIF.") == BlockAction::DropAll);
+  CHECK(block_action(keeping({"EXIF.Make"}), "EXIF.") == BlockAction::Mixed);
+  // patterns that only match after the prefix
+  CHECK(block_action(keeping({"*Make"}), "EXIF.") == BlockAction::Mixed);
+  CHECK(block_action(keeping({"*.GPS*"}), "EXIF.") == BlockAction::Mixed);
+  CHECK(block_action(keeping({"PDF.Author"}), "EXIF.") == BlockAction::DropAll);
+  // nothing kept
+  CHECK(block_action(keeping({}), "EXIF.") == BlockAction::DropAll);
+
+  // built-in policies keep a few image fields and drop everything else
+  for (bool safe : {false, true}) {
+    const auto p = core::load_policy(safe, "", {}, {});
+    CHECK(block_action(p, "EXIF.") == BlockAction::Mixed);
+    CHECK(block_action(p, "Image.") == BlockAction::Mixed);
+    CHECK(block_action(p, "XMP.") == BlockAction::DropAll);
+    CHECK(block_action(p, "IPTC.") == BlockAction::DropAll);
+    CHECK(block_action(p, "PDF.") == BlockAction::DropAll);
+    CHECK(block_action(p, "ID3.") == BlockAction::DropAll);
+    CHECK(block_action(p, "ZIP.") == BlockAction::DropAll);
+    for (auto prefix : {"EXIF.", "Image.", "XMP.", "PDF.", "ID3.", "ZIP."}) check_consistent(p, prefix);
+  }
+  const auto kept = core::load_policy(false, "", {"PDF.*", "ID3.TPE1"}, {});
+  CHECK(block_action(kept, "PDF.") == BlockAction::KeepAll);
+  CHECK(block_action(kept, "ID3.") == BlockAction::Mixed);
+  for (auto prefix : {"EXIF.", "PDF.", "ID3."}) check_consistent(kept, prefix);
+}
+
+} // namespace
+
+int main() {
+  test_risk_for();
+  test_field_lookup();
+  test_xmp_fields();
+  test_glob_match();
+  test_block_action();
+  return test_result();
+}
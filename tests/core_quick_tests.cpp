@@ -0,0 +1,292 @@
+// inspect --quick scanners over small in-memory files, and the text decoding they share
+// with the PDF backend.
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "core/detect.hpp"
+#include "core/quick.hpp"
+#include "core/text.hpp"
+#include "check.hpp"
+
+namespace {
+
+using namespace std::literals;
+
+void be(std::string& s, std::uint32_t v, int n) {
+  for (int i = n - 1; i >= 0; --i) s += static_cast<char>(v >> (8 * i));
+}
+void le(std::string& s, std::uint32_t v, int n) {
+  for (int i = 0; i < n; ++i) s += static_cast<char>(v >> (8 * i));
+}
+
+core::InspectResult quick(const std::string& name, const std::string& bytes) {
+  return core::quick_inspect(core::detect_buffer(name, bytes));
+}
+
+// Value of the field named `canonical`, or "<missing>"
+std::string value(const core::InspectResult& ir, std::string_view canonical) {
+  for (const auto& f : ir.fields) {
+    if (f.canonical == canonical) return f.value;
+  }
+  return "<missing>";
+}
+std::string risk(const core::InspectResult& ir, std::string_view canonical) {
+  for (const auto& f : ir.fields) {
+    if (f.canonical == canonical) return f.risk;
+  }
+  return "<missing>";
+}
+bool has_block(const core::InspectResult& ir, std::string_view b) {
+  for (const auto& x : ir.detected_blocks) {
+    if (x == b) return true;
+  }
+  return false;
+}
+bool has_tag(const core::InspectResult& ir, std::string_view t) {
+  for (const auto& x : ir.risk_tags) {
+    if (x == t) return true;
+  }
+  return false;
+}
+
+// Big-endian TIFF: IFD0 with Make and a GPS pointer, a GPS IFD with GPSLatitude
+std::string tiff() {
+  std::string t = "MM";
+  be(t, 42, 2); be(t, 8, 4);
+  be(t, 2, 2);                                          // IFD0 at 8, ends at 38
+  be(t, 0x010F, 2); be(t, 2, 2); be(t, 6, 4); be(t, 38, 4);
+  be(t, 0x8825, 2); be(t, 4, 2); be(t, 1, 4); be(t, 44, 4);
+  be(t, 0, 4);
+  t += "Canon\0"sv;                                     // 38
+  be(t, 1, 2);                                          // GPS IFD at 44, ends at 62
+  be(t, 2, 2); be(t, 5, 2); be(t, 3, 4); be(t, 62, 4);
+  be(t, 0, 4);
+  for (std::uint32_t v : {37u, 1u, 25u, 1u, 0u, 1u}) be(t, v, 4);
+  return t;
+}
+
+const std::string kPacket =
+  "<x:xmpmeta xmlns:x='adobe:ns:meta/'><rdf:RDF><rdf:Description rdf:about=''"
+  " exif:GPSLongitude='122,5W' aux:SerialNumber=\"A1 &amp; B\">"
+  "<dc:creator><rdf:Seq><rdf:li>Ann</rdf:li><rdf:li> Bob </rdf:li></rdf:Seq></dc:creator>"
+  "</rdf:Description></rdf:RDF></x:xmpmeta>";
+
+void check_image(const core::InspectResult& ir) {
+  CHECK_EQ(ir.type, core::FileType::Image);
+  CHECK(has_block(ir, "EXIF"));
+  CHECK(has_block(ir, "XMP"));
+  CHECK_EQ(value(ir, "EXIF.Make"), "Canon"s);
+  CHECK_EQ(value(ir, "EXIF.GPSLatitude"), "37/1 25/1 0/1"s);
+  CHECK_EQ(value(ir, "XMP.GPSLongitude"), "122,5W"s);
+  CHECK_EQ(risk(ir, "XMP.GPSLongitude"), "HIGH"s);
+  CHECK_EQ(value(ir, "XMP.SerialNumber"), "A1 & B"s);
+  CHECK_EQ(risk(ir, "XMP.SerialNumber"), "MEDIUM"s);
+  CHECK_EQ(value(ir, "XMP.Creator"), "Ann; Bob"s);
+  CHECK(has_tag(ir, "GPS"));
+  CHECK(has_tag(ir, "Device"));
+  CHECK(has_tag(ir, "Author"));
+  CHECK_EQ(ir.confidence, "complete"s);
+}
+
+void test_jpeg() {
+  const auto exif = "Exif\0\0"s + tiff();
+  const auto xmp = "http://ns.adobe.com/xap/1.0/\0"s + kPacket;
+  std::string j = "\xFF\xD8";
+  j += "\xFF\xE1"; be(j, static_cast<std::uint32_t>(exif.size() + 2), 2); j += exif;
+  j += "\xFF\xE1"; be(j, static_cast<std::uint32_t>(xmp.size() + 2), 2); j += xmp;
+  const auto head = j;
+  j += "\xFF\xDA"; be(j, 8, 2); j += std::string(6, '\0');
+  j += "\xFF\xD9";
+  check_image(quick("a.jpg", j));
+
+  // cut before the scan: later segments may still hold metadata
+  CHECK_EQ(quick("a.jpg", head).confidence, "partial"s);
+}
+
+void test_png() {
+  std::string p = "\x89PNG\r\n\x1A\n";
+  auto chunk = [&](std::string_view type, std::string_view data) {
+    be(p, static_cast<std::uint32_t>(data.size()), 4);
+    p += type; p += data; be(p, 0, 4); // the scanner does not check CRCs
+  };
+  chunk("IHDR", std::string(13, '\0'));
+  chunk("eXIf", tiff());
+  chunk("iTXt", "XML:com.adobe.xmp\0\0\0\0\0"s + kPacket);
+  chunk("IDAT", "x");
+  chunk("IEND", "");
+  check_image(quick("a.png", p));
+}
+
+void test_webp() {
+  std::string body = "WEBP";
+  auto chunk = [&](std::string_view fourcc, std::string_view data) {
+    body += fourcc; le(body, static_cast<std::uint32_t>(data.size()), 4); body += data;
+    if (data.size() & 1) body += '\0';
+  };
+  chunk("VP8 ", "frame");
+  chunk("EXIF", tiff());
+  chunk("XMP ", kPacket);
+  std::string w = "RIFF";
+  le(w, static_cast<std::uint32_t>(body.size()), 4);
+  check_image(quick("a.webp", w + body));
+}
+
+std::string pad10(std::size_t v) {
+  auto s = std::to_string(v);
+  return std::string(10 - s.size(), '0') + s;
+}
+
+void test_pdf() {
+  std::string p = "%PDF-1.4\n";
+  std::size_t off[4] = {};
+  off[1] = p.size();
+  p += "1 0 obj\n<< /Title (Hello \\(x\\)\\041) /Author <FEFF0041006E006E> /Subject (s) >>\nendobj\n";
+  off[2] = p.size();
+  p += "2 0 obj\n<< /Type /Metadata /Subtype /XML /Length " + std::to_string(kPacket.size()) +
+       " >>\nstream\n" + kPacket + "\nendstream\nendobj\n";
+  off[3] = p.size();
+  p += "3 0 obj\n<< /Type /Catalog /Metadata 2 0 R >>\nendobj\n";
+  const auto xref = p.size();
+  p += "xref\n0 4\n0000000000 65535 f \n";
+  for (int i = 1; i < 4; ++i) p += pad10(off[i]) + " 00000 n \n";
+  p += "trailer\n<< /Size 4 /Root 3 0 R /Info 1 0 R >>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n";
+
+  const auto ir = quick("a.pdf", p);
+  CHECK_EQ(ir.type, core::FileType::PDF);
+  CHECK(has_block(ir, "Info"));
+  CHECK(has_block(ir, "XMP"));
+  CHECK_EQ(value(ir, "PDF.Title"), "Hello (x)!"s);
+  CHECK_EQ(value(ir, "PDF.Author"), "Ann"s);
+  CHECK_EQ(value(ir, "XMP.Creator"), "Ann; Bob"s);
+  CHECK_EQ(value(ir, "XMP.GPSLatitude"), "<missing>"s);
+  CHECK_EQ(ir.confidence, "complete"s);
+}
+
+void test_zip() {
+  std::string z = "PK\x03\x04"s + std::string(22, '\0');
+  le(z, 5, 2); le(z, 0, 2); z += "a.txt";
+  const auto cd_off = z.size();
+  z += "PK\x01\x02"s + std::string(24, '\0');
+  le(z, 5, 2); le(z, 4, 2); le(z, 2, 2);               // name, extra, comment lengths
+  z += std::string(12, '\0');
+  z += "a.txt"; z += "\x55\x54\0\0"s; z += "hi";
+  const auto cd_size = z.size() - cd_off;
+  z += "PK\x05\x06"s; le(z, 0, 4); le(z, 1, 2); le(z, 1, 2);
+  le(z, static_cast<std::uint32_t>(cd_size), 4); le(z, static_cast<std::uint32_t>(cd_off), 4);
+  le(z, 5, 2); z += "note!";
+
+  const auto ir = quick("a.zip", z);
+  CHECK_EQ(ir.type, core::FileType::ZIP);
+  CHECK(has_block(ir, "central-directory"));
+  CHECK_EQ(value(ir, "ZIP.Comment"), "<archive comment>"s);
+  CHECK_EQ(value(ir, "ZIP.ExtraFields"), "1 files"s);
+  CHECK_EQ(value(ir, "ZIP.FileComments"), "1 files"s);
+  CHECK_EQ(ir.confidence, "complete"s);
+}
+
+void test_id3() {
+  std::string frames;
+  auto frame = [&](std::string_view id, std::string_view data) {
+    frames += id; be(frames, static_cast<std::uint32_t>(data.size()), 4); frames += "\0\0"sv; frames += data;
+  };
+  frame("TIT2", "\0Song"sv);
+  frame("TPE1", "\x01\xFF\xFE" "A\0n\0n\0"sv);
+  frame("TYER", "\0" "2019"sv);
+  frames += std::string(16, '\0');                      // padding
+  std::string m = "ID3\x03\0\0"s;
+  const auto n = static_cast<std::uint32_t>(frames.size());
+  for (int s : {21, 14, 7, 0}) m += static_cast<char>(n >> s & 0x7F);
+  m += frames;
+  m += "\xFF\xFB\x90\x00"s + std::string(200, '\0');
+  std::string v1 = "TAG" + std::string(60, '\0') + "Alb";
+  v1.resize(128, '\0');
+  m += v1;
+
+  const auto ir = quick("a.mp3", m);
+  CHECK_EQ(ir.type, core::FileType::Audio);
+  CHECK(has_block(ir, "ID3"));
+  CHECK_EQ(value(ir, "ID3.TIT2"), "Song"s);
+  CHECK_EQ(value(ir, "ID3.TPE1"), "Ann"s);
+  CHECK_EQ(value(ir, "ID3.TDRC"), "2019"s);
+  CHECK_EQ(value(ir, "ID3.TALB"), "Alb"s); // from ID3v1, which the v2 tag lacks
+  CHECK(has_tag(ir, "Artist"));
+  CHECK_EQ(ir.confidence, "complete"s);
+}
+
+std::string vorbis_comments() {
+  std::string c;
+  le(c, 3, 4); c += "lib";
+  le(c, 3, 4);
+  for (std::string_view e : {"title=T"sv, "ARTIST=A"sv, "DATE=2020-01-02"sv}) {
+    le(c, static_cast<std::uint32_t>(e.size()), 4); c += e;
+  }
+  return c;
+}
+
+void test_flac() {
+  std::string f = "fLaC";
+  f += '\0'; be(f, 34, 3); f += std::string(34, '\0'); // STREAMINFO
+  const auto c = vorbis_comments();
+  f += '\x84'; be(f, static_cast<std::uint32_t>(c.size()), 3); f += c;
+  f += "\xFF\xF8"s + std::string(32, '\0');
+
+  const auto ir = quick("a.flac", f);
+  CHECK_EQ(ir.type, core::FileType::Audio);
+  CHECK(has_block(ir, "Vorbis"));
+  CHECK_EQ(value(ir, "ID3.TIT2"), "T"s);
+  CHECK_EQ(value(ir, "ID3.TPE1"), "A"s);
+  CHECK_EQ(value(ir, "ID3.TDRC"), "2020"s);
+  CHECK_EQ(ir.confidence, "complete"s);
+}
+
+void test_ogg() {
+  auto page = [](std::string_view packet) {
+    std::string p = "OggS\0\x02"s + std::string(20, '\0');
+    p += '\x01'; p += static_cast<char>(packet.size()); p += packet;
+    return p;
+  };
+  const auto o = page("\x01vorbis"s + std::string(23, '\0')) + page("\x03vorbis"s + vorbis_comments() + '\x01');
+
+  const auto ir = quick("a.ogg", o);
+  CHECK_EQ(ir.type, core::FileType::Audio);
+  CHECK_EQ(value(ir, "ID3.TIT2"), "T"s);
+  CHECK_EQ(value(ir, "ID3.TDRC"), "2020"s);
+  CHECK_EQ(ir.confidence, "complete"s);
+}
+
+void test_text() {
+  std::string s;
+  CHECK(core::pdf_string("(a\\(b\\) \\101\\\nc)", s));
+  CHECK_EQ(s, "a(b) Ac"s);
+  CHECK(core::pdf_string("<48 69 7>", s));
+  CHECK_EQ(s, "Hip"s);
+  CHECK(core::pdf_string("<FEFFD83DDE00>", s)); // a surrogate pair
+  CHECK_EQ(s, "\xF0\x9F\x98\x80"s);
+  CHECK(!core::pdf_string("/Name", s));
+  CHECK(!core::pdf_string("<< /A 1 >>", s));
+
+  CHECK_EQ(core::xml_text("  a &lt;b&gt; &amp;c &x; "), "a <b> &c &x;"s);
+  const std::string_view x = "<rdf:Description xmp:CreateDate='2020' dc:title=\"t\">"
+                             "<xmp:CreatorTool>Tool</xmp:CreatorTool><pdf:Producer/></rdf:Description>";
+  CHECK_EQ(core::xmp_value(x, "xmp:CreateDate"), "2020"s);
+  CHECK_EQ(core::xmp_value(x, "dc:title"), "t"s);
+  CHECK_EQ(core::xmp_value(x, "xmp:CreatorTool"), "Tool"s);
+  CHECK_EQ(core::xmp_value(x, "pdf:Producer"), ""s);
+  CHECK_EQ(core::xmp_value(x, "dc:creator"), ""s);
+}
+
+} // namespace
+
+int main() {
+  test_jpeg();
+  test_png();
+  test_webp();
+  test_pdf();
+  test_zip();
+  test_id3();
+  test_flac();
+  test_ogg();
+  test_text();
+  return test_result();
+}
@@ -0,0 +1,87 @@
+// `report merge` over shard reports.
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "core/detect.hpp"
+#include "core/report.hpp"
+#include "check.hpp"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+core::InspectResult result(std::string file) {
+  core::InspectResult r;
+  r.file = std::move(file);
+  r.type = core::FileType::PDF;
+  r.detected_blocks = {"Info"};
+  r.status = "stripped";
+  return r;
+}
+
+// As a sharded run writes its report (Shard::order)
+void sort_by_key(std::vector<core::InspectResult>& rs) {
+  std::stable_sort(rs.begin(), rs.end(), [](const auto& a, const auto& b) {
+    return core::report_order_key(a.file) < core::report_order_key(b.file);
+  });
+}
+
+std::string merge(const std::vector<std::string>& inputs, bool ndjson) {
+  std::ostringstream os;
+  std::string err;
+  CHECK(core::merge_reports(inputs, os, ndjson, err));
+  CHECK(err.empty());
+  return os.str();
+}
+
+// Paths that differ only after a space, a quote, a backslash or a tab: in the report their
+// escaped text orders differently from the quoted token, so every shard must agree with
+// the merge on one key
+void test_merge_matches_single_shard() {
+  const auto dir = fs::temp_directory_path() / "core_report_merge";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  std::vector<core::InspectResult> all;
+  for (std::string f : {"d/x", "d/x y", "d/x\"q", "d/x\\b", "d/x\ty", "d/a b/c", "d/a/b", "d/x-y", "d/x!",
+                        "d/\xC3\xA9t\xC3\xA9", "d/x y z", "d/x/y"}) {
+    all.push_back(result(f));
+  }
+  sort_by_key(all);
+  const auto single = (dir / "single.json").string();
+  core::write_json_report(all, single);
+
+  // three shards, one of them NDJSON, each sorted on its own
+  std::vector<std::vector<core::InspectResult>> shards(3);
+  for (std::size_t i = 0; i < all.size(); ++i) shards[(i * 7 + 1) % 3].push_back(all[i]);
+  std::vector<std::string> inputs;
+  for (std::size_t s = 0; s < shards.size(); ++s) {
+    sort_by_key(shards[s]);
+    inputs.push_back((dir / ("shard" + std::to_string(s))).string());
+    if (s == 1) {
+      std::ofstream f(inputs.back(), std::ios::binary);
+      for (auto& r : shards[s]) f << core::to_json(r) << '\n';
+    } else {
+      core::write_json_report(shards[s], inputs.back());
+    }
+  }
+
+  for (bool ndjson : {false, true}) {
+    const auto want = merge({single}, ndjson);
+    CHECK_EQ(merge(inputs, ndjson), want);
+    std::reverse(inputs.begin(), inputs.end()); // input order does not matter
+    CHECK_EQ(merge(inputs, ndjson), want);
+  }
+  const auto lines = merge(inputs, true);
+  CHECK_EQ(static_cast<std::size_t>(std::count(lines.begin(), lines.end(), '\n')), all.size());
+  fs::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+  test_merge_matches_single_shard();
+  return test_result();
+}
@@ -0,0 +1,103 @@
+// Strip planning and the results strip reports, through the registered backends.
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include "backends/registry.hpp"
+#include "core/detect.hpp"
+#include "core/policy.hpp"
+#include "core/sanitize.hpp"
+#include "check.hpp"
+
+namespace {
+
+using namespace std::literals;
+
+// `n` MPEG-1 Layer III frames, 128 kbit/s at 44.1 kHz: 417 bytes each, no padding
+std::string mpeg_frames(int n) {
+  std::string f = "\xFF\xFB\x90\x00"s + std::string(413, '\0');
+  std::string out;
+  for (int i = 0; i < n; ++i) out += f;
+  return out;
+}
+
+bool has_block(const core::InspectResult& ir, std::string_view b) {
+  for (const auto& x : ir.detected_blocks) {
+    if (x == b) return true;
+  }
+  return false;
+}
+
+// A tag-free MP3 has nothing to drop, so strip passes it through untouched
+void test_clean_mp3() {
+  const auto policy = core::load_policy(false, "", {}, {});
+  const auto clean = mpeg_frames(8);
+  const auto d = core::detect_buffer("clean.mp3", clean);
+  CHECK_EQ(d.type, core::FileType::Audio);
+  CHECK(d.audio == core::AudioKind::MPEG);
+  const auto ir = core::inspect(d);
+  CHECK(!has_block(ir, "ID3"));
+  CHECK(ir.fields.empty());
+  CHECK(!core::plan_drops(ir, policy));
+
+  if (!backends::find(core::FileType::Audio)) return; // no audio backend: nothing is read
+  // the same stream behind an ID3v2 tag with one title frame
+  const auto frame = "TIT2\0\0\0\x05\0\0\0Song"s;
+  std::string tagged = "ID3\x03\0\0\0\0\0"s + static_cast<char>(frame.size()) + frame + clean;
+  const auto t = core::inspect(core::detect_buffer("tagged.mp3", tagged));
+  CHECK(has_block(t, "ID3"));
+  CHECK(core::plan_drops(t, policy));
+}
+
+std::string le32(std::uint32_t v) {
+  std::string s;
+  for (int i = 0; i < 4; ++i) s += static_cast<char>(v >> (8 * i) & 0xFF);
+  return s;
+}
+
+// Tags behind the audio go too: an APE tag (header, one item, footer) and an ID3v1 trailer
+void test_strip_mp3_tail_tags() {
+  if (!backends::find(core::FileType::Audio)) return;
+  const auto item = le32(4) + le32(0) + "Title\0Song"s;
+  const auto ape = [&](std::uint32_t flags) {
+    return "APETAGEX"s + le32(2000) + le32(static_cast<std::uint32_t>(item.size()) + 32) + le32(1) + le32(flags) +
+           std::string(8, '\0');
+  };
+  std::string v1 = "TAG" + "Song"s;
+  v1.resize(128, '\0');
+  const auto clean = mpeg_frames(8);
+  const auto in = clean + ape(0xA0000000u) + item + ape(0x80000000u) + v1;
+
+  const auto dir = std::filesystem::temp_directory_path();
+  const auto out = (dir / "core_sanitize_tail.mp3").string();
+  const auto policy = core::load_policy(false, "", {}, {});
+  const auto ir = core::strip_to(core::detect_buffer("tail.mp3", in), out, policy);
+  CHECK_EQ(ir.file, out);
+  CHECK(!has_block(ir, "ID3"));
+  std::ifstream f(out, std::ios::binary);
+  const std::string written{std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+  CHECK(written == clean);
+  std::filesystem::remove(out);
+}
+
+// A bare frame sync is MPEG only when the next frame header lines up behind it
+void test_bare_mpeg_sniff() {
+  CHECK_EQ(core::detect_buffer("stream.bin", mpeg_frames(2)).type, core::FileType::Audio);
+  auto stray = mpeg_frames(2);
+  stray[417] = 'x'; // the second header is not where the first frame ends
+  CHECK_EQ(core::detect_buffer("data.bin", stray).type, core::FileType::Unknown);
+  CHECK_EQ(core::detect_buffer("song.mp3", stray).type, core::FileType::Unknown);
+  // one frame and nothing after it: only the name can vouch for it
+  CHECK_EQ(core::detect_buffer("data.bin", mpeg_frames(1)).type, core::FileType::Unknown);
+  CHECK_EQ(core::detect_buffer("one.mp3", mpeg_frames(1)).type, core::FileType::Audio);
+}
+
+} // namespace
+
+int main() {
+  test_clean_mp3();
+  test_bare_mpeg_sniff();
+  test_strip_mp3_tail_tags();
+  return test_result();
+}
@@ -0,0 +1,316 @@
+#include <CLI/CLI.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "core/detect.hpp"
+#include "core/policy.hpp"
+#include "core/report.hpp"
+#include "core/sanitize.hpp"
+#include "corpus.hpp"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// ---------- allocation counting (whole process; benchmarks run single-threaded) ----------
+static std::atomic<std::uint64_t> g_allocs{0};
+
+void* operator new(std::size_t n) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  std::string name;
+  double ns_per_op = 0;
+  double ops_per_s = 0;
+  double mb_per_s = 0;
+  double allocs_per_op = 0;
+  std::uint64_t iterations = 0;
+};
+
+struct Runner {
+  double min_time = 0.2; // seconds per repetition
+  int reps = 3;
+  std::string filter;
+  std::vector<Result> results;
+
+  // Run `f` in calibrated batches; keep the median repetition.
+  template <class F>
+  void run(const std::string& name, F&& f, std::uint64_t bytes_per_op = 0) {
+    if (!filter.empty() && name.find(filter) == std::string::npos) return;
+    f(); // warm caches and lazy statics
+    std::uint64_t batch = 1;
+    for (;;) {
+      auto t0 = Clock::now();
+      for (std::uint64_t i = 0; i < batch; ++i) f();
+      double s = std::chrono::duration<double>(Clock::now() - t0).count();
+      if (s >= min_time / 10 || batch >= (1ull << 30)) {
+        batch = std::max<std::uint64_t>(1, std::uint64_t(batch * (min_time / std::max(s, 1e-9))));
+        break;
+      }
+      batch *= 10;
+    }
+    std::vector<Result> rs;
+    for (int r = 0; r < reps; ++r) {
+      auto a0 = g_allocs.load(std::memory_order_relaxed);
+      auto t0 = Clock::now();
+      for (std::uint64_t i = 0; i < batch; ++i) f();
+      double s = std::chrono::duration<double>(Clock::now() - t0).count();
+      auto a1 = g_allocs.load(std::memory_order_relaxed);
+      Result x;
+      x.name = name;
+      x.iterations = batch;
+      x.ns_per_op = s * 1e9 / double(batch);
+      x.ops_per_s = double(batch) / s;
+      x.mb_per_s = bytes_per_op ? double(bytes_per_op) * x.ops_per_s / (1024.0 * 1024.0) : 0;
+      x.allocs_per_op = double(a1 - a0) / double(batch);
+      rs.push_back(x);
+    }
+    std::sort(rs.begin(), rs.end(), [](auto& a, auto& b) { return a.ns_per_op < b.ns_per_op; });
+    results.push_back(rs[rs.size() / 2]);
+    auto& m = results.back();
+    fmt::print("{:<34} {:>12.1f} ns/op {:>12.0f} op/s {:>9} {:>9.1f} allocs/op\n", m.name, m.ns_per_op,
+               m.ops_per_s, m.mb_per_s ? fmt::format("{:.1f} MB/s", m.mb_per_s) : "", m.allocs_per_op);
+  }
+
+  // One pass over a batch; throughput is files/s and bytes/s over the whole batch.
+  template <class F>
+  void batch(const std::string& name, std::size_t files, std::uint64_t bytes, F&& f) {
+    if (!filter.empty() && name.find(filter) == std::string::npos) return;
+    std::vector<Result> rs;
+    for (int r = 0; r < reps; ++r) {
+      auto a0 = g_allocs.load(std::memory_order_relaxed);
+      auto t0 = Clock::now();
+      f();
+      double s = std::chrono::duration<double>(Clock::now() - t0).count();
+      auto a1 = g_allocs.load(std::memory_order_relaxed);
+      Result x;
+      x.name = name;
+      x.iterations = files;
+      x.ns_per_op = s * 1e9 / double(files);
+      x.ops_per_s = double(files) / s;
+      x.mb_per_s = double(bytes) / s / (1024.0 * 1024.0);
+      x.allocs_per_op = double(a1 - a0) / double(files);
+      rs.push_back(x);
+    }
+    std::sort(rs.begin(), rs.end(), [](auto& a, auto& b) { return a.ns_per_op < b.ns_per_op; });
+    results.push_back(rs[rs.size() / 2]);
+    auto& m = results.back();
+    fmt::print("{:<34} {:>12.1f} ns/file {:>10.0f} files/s {:>9.1f} MB/s {:>9.1f} allocs/file\n", m.name,
+               m.ns_per_op, m.ops_per_s, m.mb_per_s, m.allocs_per_op);
+  }
+};
+
+// ---------- baseline file: one benchmark per line so compare can parse it without a JSON lib ----------
+void write_baseline(const std::vector<Result>& rs, const std::string& path) {
+  std::ofstream f(path, std::ios::binary | std::ios::trunc);
+  f << "{\n  \"version\": 1,\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < rs.size(); ++i) {
+    const auto& r = rs[i];
+    f << fmt::format("    {{\"name\":\"{}\",\"ns_per_op\":{:.3f},\"ops_per_s\":{:.3f},\"mb_per_s\":{:.3f},"
+                     "\"allocs_per_op\":{:.3f},\"iterations\":{}}}",
+                     r.name, r.ns_per_op, r.ops_per_s, r.mb_per_s, r.allocs_per_op, r.iterations);
+    f << (i + 1 < rs.size() ? ",\n" : "\n");
+  }
+  f << "  ]\n}\n";
+}
+
+double json_number(const std::string& line, const std::string& key) {
+  auto p = line.find("\"" + key + "\":");
+  if (p == std::string::npos) return 0;
+  return std::strtod(line.c_str() + p + key.size() + 3, nullptr);
+}
+
+std::map<std::string, Result> read_baseline(const std::string& path) {
+  std::map<std::string, Result> out;
+  std::ifstream f(path, std::ios::binary);
+  std::string line;
+  while (std::getline(f, line)) {
+    auto p = line.find("\"name\":\"");
+    if (p == std::string::npos) continue;
+    p += 8;
+    Result r;
+    r.name = line.substr(p, line.find('"', p) - p);
+    r.ns_per_op = json_number(line, "ns_per_op");
+    r.ops_per_s = json_number(line, "ops_per_s");
+    r.mb_per_s = json_number(line, "mb_per_s");
+    r.allocs_per_op = json_number(line, "allocs_per_op");
+    out[r.name] = r;
+  }
+  return out;
+}
+
+// Returns the number of regressions beyond `threshold` percent.
+int compare(const std::vector<Result>& now, const std::map<std::string, Result>& base, double threshold) {
+  int regressions = 0;
+  fmt::print("\n{:<34} {:>12} {:>12} {:>8} {:>10} {:>10}\n", "benchmark", "base op/s", "now op/s", "delta",
+             "base allocs", "now allocs");
+  for (auto& r : now) {
+    auto it = base.find(r.name);
+    if (it == base.end()) { fmt::print("{:<34} (new)\n", r.name); continue; }
+    const auto& b = it->second;
+    double delta = b.ops_per_s > 0 ? (r.ops_per_s - b.ops_per_s) * 100.0 / b.ops_per_s : 0;
+    bool slow = delta < -threshold;
+    // allocations are deterministic, but allow half an allocation of jitter from lazy statics
+    bool alloc = r.allocs_per_op > b.allocs_per_op * (1 + threshold / 100.0) + 0.5;
+    if (slow || alloc) ++regressions;
+    fmt::print("{:<34} {:>12.0f} {:>12.0f} {:>7.1f}% {:>10.1f} {:>10.1f}{}\n", r.name, b.ops_per_s,
+               r.ops_per_s, delta, b.allocs_per_op, r.allocs_per_op,
+               slow && alloc ? "  REGRESSION (throughput, allocs)"
+               : slow        ? "  REGRESSION (throughput)"
+               : alloc       ? "  REGRESSION (allocs)"
+                             : "");
+  }
+  return regressions;
+}
+
+std::uint64_t file_size(const std::string& p) {
+  std::error_code ec;
+  auto n = fs::file_size(p, ec);
+  return ec ? 0 : n;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  CLI::App app{"metasweep_bench — micro and end-to-end benchmarks"};
+  Runner run;
+  std::string out, baseline, corpus_dir;
+  double threshold = 10.0;
+  std::size_t corpus_files = 500;
+  bool no_e2e = false;
+  app.add_option("--min-time", run.min_time, "Seconds per repetition");
+  app.add_option("--reps", run.reps, "Repetitions (median is reported)");
+  app.add_option("--filter", run.filter, "Only run benchmarks whose name contains this");
+  app.add_option("--out", out, "Save results as a JSON baseline");
+  app.add_option("--compare", baseline, "Compare against a JSON baseline");
+  app.add_option("--threshold", threshold, "Regression threshold in percent");
+  app.add_option("--corpus", corpus_dir, "Existing corpus for end-to-end runs (default: generate one)");
+  app.add_option("--corpus-files", corpus_files, "Files to generate for end-to-end runs");
+  app.add_flag("--no-e2e", no_e2e, "Skip end-to-end batch runs");
+  try { app.parse(argc, argv); }
+  catch (const CLI::ParseError& e) { return app.exit(e); }
+  run.reps = std::max(1, run.reps);
+
+#ifndef _WIN32
+  fs::path work = fs::temp_directory_path() / fmt::format("metasweep_bench_{}", ::getpid());
+#else
+  fs::path work = fs::temp_directory_path() / "metasweep_bench";
+#endif
+  fs::create_directories(work / "in");
+  fs::create_directories(work / "out");
+
+  // one representative input per backend, generated with default densities
+  corpus::Spec spec;
+  const std::pair<corpus::Kind, const char*> kinds[] = {
+    {corpus::Kind::Jpeg, "image/jpeg"}, {corpus::Kind::Png, "image/png"}, {corpus::Kind::Webp, "image/webp"},
+    {corpus::Kind::Pdf, "pdf"}, {corpus::Kind::Mp3, "audio/mp3"}, {corpus::Kind::Flac, "audio/flac"},
+    {corpus::Kind::Zip, "zip"}};
+  std::vector<std::pair<std::string, std::string>> inputs; // label, path
+  for (auto& [k, label] : kinds) {
+    auto p = (work / "in" / (std::string("sample.") + corpus::kind_name(k))).string();
+    corpus::write_file(spec, k, 0, p);
+    inputs.emplace_back(label, p);
+  }
+
+  // ---- core helpers ----
+  const auto& jpeg = inputs[0].second;
+  run.run("detect_file", [&] { auto d = core::detect_file(jpeg); (void)d; });
+  volatile bool sink = false;
+  run.run("glob_match/literal", [&] { sink = core::glob_match("EXIF.Orientation", "EXIF.Orientation"); });
+  run.run("glob_match/prefix_star", [&] { sink = core::glob_match("EXIF.GPS*", "EXIF.GPSLongitude"); });
+  run.run("glob_match/miss", [&] { sink = core::glob_match("XMP.History*", "EXIF.Exif.Photo.DateTimeOriginal"); });
+
+  const auto aggressive = core::load_policy(false, "", {}, {});
+  const auto safe = core::load_policy(true, "", {}, {});
+  const std::vector<std::string> canon{"EXIF.GPSLatitude", "EXIF.Orientation", "EXIF.Exif.Photo.DateTimeOriginal",
+                                       "XMP.CreatorTool", "PDF.Author", "ID3.TPE1", "ZIP.Comment", "IPTC.Iptc.Application2.City"};
+  run.run("policy_keep/aggressive", [&] { for (auto& c : canon) sink = core::policy_keep(aggressive, c); });
+  run.run("policy_keep/safe", [&] { for (auto& c : canon) sink = core::policy_keep(safe, c); });
+  run.run("risk_for", [&] { for (auto& c : canon) { auto r = core::risk_for(c); (void)r; } });
+
+  // ---- backends ----
+  std::vector<core::InspectResult> sample_results;
+  for (auto& [label, path] : inputs) {
+    const auto bytes = file_size(path);
+    auto d = core::detect_file(path);
+    run.run("inspect/" + label, [&] { auto r = core::inspect(d); (void)r; }, bytes);
+    auto out_path = (work / "out" / fs::path(path).filename()).string();
+    run.run("strip_to/" + label, [&] { auto r = core::strip_to(path, out_path, aggressive); (void)r; }, bytes);
+    sample_results.push_back(core::inspect(d));
+  }
+
+  // ---- report ----
+  std::vector<core::InspectResult> report;
+  for (int i = 0; i < 100; ++i) report.insert(report.end(), sample_results.begin(), sample_results.end());
+  std::ostringstream probe;
+  core::write_json_report_stream(probe, report);
+  const auto json_bytes = probe.str().size();
+  run.run("json_write/700_files", [&] { std::ostringstream os; core::write_json_report_stream(os, report); }, json_bytes);
+
+  // ---- end-to-end batches ----
+  if (!no_e2e) {
+    std::vector<std::string> files;
+    std::uint64_t total = 0;
+    if (corpus_dir.empty()) {
+      corpus::Spec cs;
+      cs.out_dir = (work / "corpus").string();
+      cs.count = corpus_files;
+      cs.depth = 2; cs.fanout = 8;
+      for (auto& g : corpus::generate(cs)) { files.push_back(g.path); total += g.bytes; }
+    } else {
+      for (auto& e : fs::recursive_directory_iterator(corpus_dir))
+        if (e.is_regular_file()) { files.push_back(e.path().string()); total += e.file_size(); }
+    }
+    if (!files.empty()) {
+      run.batch("e2e/inspect", files.size(), total, [&] {
+        for (auto& f : files) { auto r = core::inspect(core::detect_file(f)); (void)r; }
+      });
+      auto out_dir = work / "e2e_out";
+      fs::create_directories(out_dir);
+      run.batch("e2e/strip", files.size(), total, [&] {
+        std::size_t i = 0;
+        for (auto& f : files) {
+          auto o = (out_dir / fmt::format("{}_{}", i++, fs::path(f).filename().string())).string();
+          auto r = core::strip_to(f, o, aggressive);
+          (void)r;
+        }
+      });
+    }
+  }
+
+  std::error_code ec;
+  fs::remove_all(work, ec);
+
+  if (!out.empty()) {
+    write_baseline(run.results, out);
+    fmt::print("Wrote baseline: {}\n", out);
+  }
+  if (!baseline.empty()) {
+    auto base = read_baseline(baseline);
+    if (base.empty()) { fmt::print(stderr, "No benchmarks in baseline {}\n", baseline); return 2; }
+    int n = compare(run.results, base, threshold);
+    if (n) { fmt::print("{} regression{} beyond {:.1f}%\n", n, n == 1 ? "" : "s", threshold); return 1; }
+    fmt::print("No regressions beyond {:.1f}%\n", threshold);
+  }
+  return 0;
+}
@@ -0,0 +1,606 @@
+#include "corpus.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace corpus {
+namespace {
+
+// ---------- deterministic randomness ----------
+struct Rng {
+  std::uint64_t s;
+  Rng(std::uint64_t seed, std::uint64_t index, std::uint64_t salt)
+    : s(seed ^ (index * 0x9E3779B97F4A7C15ull) ^ (salt << 32)) { next(); }
+  std::uint64_t next() {
+    std::uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+  std::uint64_t below(std::uint64_t n) { return n ? next() % n : 0; }
+  double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+  template <class T, std::size_t N> const T& pick(const std::array<T, N>& a) { return a[below(N)]; }
+};
+
+enum Salt : std::uint64_t { SaltKind = 1, SaltDir, SaltMeta, SaltSize, SaltClean };
+
+constexpr std::array<const char*, 6> kMakes{"Canon", "NIKON CORPORATION", "SONY", "FUJIFILM",
+                                            "Apple", "samsung"};
+constexpr std::array<const char*, 6> kModels{"Canon EOS 5D Mark IV", "NIKON D850", "ILCE-7M3",
+                                             "X-T4", "iPhone 14 Pro", "SM-G991B"};
+constexpr std::array<const char*, 6> kPeople{"Alice Example", "Bob Sample", "Carol Test",
+                                             "Dan Placeholder", "Eve Fixture", "Frank Corpus"};
+constexpr std::array<const char*, 5> kTools{"Adobe Photoshop 24.1 (Windows)", "GIMP 2.10.34",
+                                            "darktable 4.4.2", "Microsoft Word 16.0",
+                                            "LibreOffice 7.5"};
+constexpr std::array<const char*, 5> kCities{"Berlin", "Cairo", "Lisbon", "Osaka", "Toronto"};
+
+std::string serial(Rng& r) { return std::to_string(100000000 + r.below(900000000)); }
+std::string stamp(Rng& r) {
+  char buf[32];
+  std::snprintf(buf, sizeof buf, "20%02u:%02u:%02u %02u:%02u:%02u",
+                unsigned(10 + r.below(14)), unsigned(1 + r.below(12)), unsigned(1 + r.below(28)),
+                unsigned(r.below(24)), unsigned(r.below(60)), unsigned(r.below(60)));
+  return buf;
+}
+
+// ---------- byte helpers ----------
+void put16le(std::string& b, std::uint16_t v) { b += char(v & 0xFF); b += char(v >> 8); }
+void put32le(std::string& b, std::uint32_t v) { for (int i = 0; i < 4; ++i) b += char((v >> (8 * i)) & 0xFF); }
+void put64le(std::string& b, std::uint64_t v) { for (int i = 0; i < 8; ++i) b += char((v >> (8 * i)) & 0xFF); }
+void put16be(std::string& b, std::uint16_t v) { b += char(v >> 8); b += char(v & 0xFF); }
+void put24be(std::string& b, std::uint32_t v) { b += char((v >> 16) & 0xFF); b += char((v >> 8) & 0xFF); b += char(v & 0xFF); }
+void put32be(std::string& b, std::uint32_t v) { for (int i = 3; i >= 0; --i) b += char((v >> (8 * i)) & 0xFF); }
+
+std::uint32_t crc32(std::string_view d, std::uint32_t crc = 0) {
+  static const auto table = [] {
+    std::array<std::uint32_t, 256> t{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+      std::uint32_t c = i;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (unsigned char ch : d) crc = table[(crc ^ ch) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+std::uint32_t adler32(std::string_view d) {
+  std::uint32_t a = 1, b = 0;
+  for (unsigned char ch : d) { a = (a + ch) % 65521; b = (b + a) % 65521; }
+  return (b << 16) | a;
+}
+
+// ---------- TIFF / Exif ----------
+struct TiffEntry {
+  std::uint16_t tag, type;
+  std::uint32_t count;
+  std::string data; // little-endian payload
+};
+
+TiffEntry ascii(std::uint16_t tag, const std::string& s) {
+  return {tag, 2, std::uint32_t(s.size() + 1), s + '\0'};
+}
+TiffEntry short1(std::uint16_t tag, std::uint16_t v) {
+  std::string d; put16le(d, v); return {tag, 3, 1, d};
+}
+TiffEntry long1(std::uint16_t tag, std::uint32_t v) {
+  std::string d; put32le(d, v); return {tag, 4, 1, d};
+}
+TiffEntry rational3(std::uint16_t tag, double deg) {
+  std::string d;
+  auto whole = std::uint32_t(deg);
+  double rem = (deg - whole) * 60;
+  auto minutes = std::uint32_t(rem);
+  auto sec100 = std::uint32_t((rem - minutes) * 6000);
+  put32le(d, whole); put32le(d, 1); put32le(d, minutes); put32le(d, 1); put32le(d, sec100); put32le(d, 100);
+  return {tag, 5, 3, d};
+}
+
+std::size_t ifd_size(const std::vector<TiffEntry>& es) {
+  std::size_t n = 2 + 12 * es.size() + 4;
+  for (auto& e : es) if (e.data.size() > 4) n += (e.data.size() + 1) & ~std::size_t(1);
+  return n;
+}
+
+// Serialize one IFD placed at absolute offset `at`; out-of-line values follow it.
+std::string ifd_bytes(std::vector<TiffEntry> es, std::uint32_t at) {
+  std::sort(es.begin(), es.end(), [](auto& a, auto& b) { return a.tag < b.tag; });
+  std::string head, tail;
+  std::uint32_t data_at = at + std::uint32_t(2 + 12 * es.size() + 4);
+  put16le(head, std::uint16_t(es.size()));
+  for (auto& e : es) {
+    put16le(head, e.tag); put16le(head, e.type); put32le(head, e.count);
+    if (e.data.size() <= 4) {
+      std::string v = e.data; v.resize(4, '\0'); head += v;
+    } else {
+      put32le(head, data_at + std::uint32_t(tail.size()));
+      tail += e.data;
+      if (tail.size() & 1) tail += '\0';
+    }
+  }
+  put32le(head, 0); // no next IFD
+  return head + tail;
+}
+
+std::string make_tiff(const Spec& spec, Rng& r) {
+  std::vector<TiffEntry> ifd0{
+    ascii(0x010F, r.pick(kMakes)), ascii(0x0110, r.pick(kModels)), short1(0x0112, 1),
+    ascii(0x0131, r.pick(kTools)), ascii(0x0132, stamp(r)), ascii(0x013B, r.pick(kPeople)),
+    long1(0x8769, 0), long1(0x8825, 0)};
+  std::vector<TiffEntry> exif{ascii(0x9003, stamp(r)), ascii(0xA431, serial(r))};
+  for (unsigned i = 0; i < spec.exif_tags; ++i)
+    exif.push_back(ascii(std::uint16_t(0xC000 + i), "corpus-tag-" + std::to_string(r.next() & 0xFFFFFF)));
+  std::string ver; ver += '\2'; ver += '\3'; ver += '\0'; ver += '\0';
+  std::vector<TiffEntry> gps{
+    {0x0000, 1, 4, ver},
+    ascii(0x0001, r.below(2) ? "N" : "S"), rational3(0x0002, r.unit() * 89),
+    ascii(0x0003, r.below(2) ? "E" : "W"), rational3(0x0004, r.unit() * 179)};
+
+  std::uint32_t exif_at = 8 + std::uint32_t(ifd_size(ifd0));
+  std::uint32_t gps_at = exif_at + std::uint32_t(ifd_size(exif));
+  for (auto& e : ifd0) {
+    if (e.tag == 0x8769) { e.data.clear(); put32le(e.data, exif_at); }
+    if (e.tag == 0x8825) { e.data.clear(); put32le(e.data, gps_at); }
+  }
+  std::string t = "II*";
+  t += '\0';
+  put32le(t, 8);
+  t += ifd_bytes(ifd0, 8);
+  t += ifd_bytes(exif, exif_at);
+  t += ifd_bytes(gps, gps_at);
+  return t;
+}
+
+// ---------- XMP / IPTC ----------
+std::string make_xmp(std::size_t target, Rng& r) {
+  std::string p = "<?xpacket begin=\"\xEF\xBB\xBF\" id=\"W5M0MpCehiHzreSzNTczkc9d\"?>\n"
+    "<x:xmpmeta xmlns:x=\"adobe:ns:meta/\"><rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\">"
+    "<rdf:Description rdf:about=\"\" xmlns:xmp=\"http://ns.adobe.com/xap/1.0/\""
+    " xmlns:dc=\"http://purl.org/dc/elements/1.1/\" xmlns:pdf=\"http://ns.adobe.com/pdf/1.3/\"";
+  p += " xmp:CreatorTool=\"" + std::string(r.pick(kTools)) + "\"";
+  p += " xmp:CreateDate=\"20" + std::to_string(10 + r.below(14)) + "-06-01T12:00:00Z\"";
+  p += " pdf:Producer=\"" + std::string(r.pick(kTools)) + "\">";
+  p += "<dc:creator><rdf:Seq><rdf:li>" + std::string(r.pick(kPeople)) + "</rdf:li></rdf:Seq></dc:creator>";
+  p += "</rdf:Description></rdf:RDF></x:xmpmeta>\n";
+  const std::string end = "<?xpacket end=\"w\"?>";
+  while (p.size() + end.size() < target) {
+    std::size_t n = std::min<std::size_t>(99, target - p.size() - end.size());
+    p.append(n, ' ');
+    p += '\n';
+  }
+  return p + end;
+}
+
+std::string make_iptc(Rng& r) {
+  std::string d;
+  auto ds = [&](std::uint8_t n, const std::string& v) {
+    d += '\x1C'; d += '\x02'; d += char(n); put16be(d, std::uint16_t(v.size())); d += v;
+  };
+  ds(0x00, std::string("\x00\x04", 2));
+  ds(0x19, "corpus");
+  ds(0x50, r.pick(kPeople));
+  ds(0x5A, r.pick(kCities));
+  ds(0x74, std::string("(c) ") + r.pick(kPeople));
+  return d;
+}
+
+// ---------- images ----------
+void jpeg_segment(std::string& b, std::uint8_t marker, const std::string& payload) {
+  b += '\xFF'; b += char(marker);
+  put16be(b, std::uint16_t(payload.size() + 2));
+  b += payload;
+}
+
+// 8x8 mid-gray baseline JPEG: one-code Huffman tables, a single block coded as
+// DC diff 0 + EOB ("00", padded with ones -> 0x3F).
+std::string jpeg_image_tail() {
+  std::string b;
+  jpeg_segment(b, 0xDB, std::string(1, '\0') + std::string(64, '\x01'));
+  jpeg_segment(b, 0xC0, std::string("\x08\x00\x08\x00\x08\x01\x01\x11\x00", 9));
+  std::string dht(1, '\0'); dht += '\x01'; dht.append(15, '\0'); dht += '\0';
+  jpeg_segment(b, 0xC4, dht);
+  dht[0] = '\x10';
+  jpeg_segment(b, 0xC4, dht);
+  jpeg_segment(b, 0xDA, std::string("\x01\x01\x00\x00\x3F\x00", 6));
+  b += '\x3F';
+  b += "\xFF\xD9";
+  return b;
+}
+
+std::string make_jpeg(const Spec& spec, Rng& r, bool clean) {
+  std::string b = "\xFF\xD8";
+  if (!clean) {
+    jpeg_segment(b, 0xE1, std::string("Exif\0\0", 6) + make_tiff(spec, r));
+    if (spec.xmp_bytes) {
+      std::string ns("http://ns.adobe.com/xap/1.0/\0", 29);
+      jpeg_segment(b, 0xE1, ns + make_xmp(std::min<std::size_t>(spec.xmp_bytes, 65533 - ns.size()), r));
+    }
+    if (spec.iptc) {
+      std::string iptc = make_iptc(r);
+      std::string ps("Photoshop 3.0\0", 14);
+      ps += "8BIM"; put16be(ps, 0x0404); ps += std::string(2, '\0');
+      put32be(ps, std::uint32_t(iptc.size())); ps += iptc;
+      if (iptc.size() & 1) ps += '\0';
+      jpeg_segment(b, 0xED, ps);
+    }
+  }
+  return b + jpeg_image_tail();
+}
+
+void png_chunk(std::string& b, const char* type, const std::string& data) {
+  put32be(b, std::uint32_t(data.size()));
+  std::string td = std::string(type, 4) + data;
+  b += td;
+  put32be(b, crc32(td));
+}
+
+std::string make_png(const Spec& spec, Rng& r, bool clean) {
+  std::string b = "\x89PNG\r\n\x1A\n";
+  png_chunk(b, "IHDR", std::string("\0\0\0\x01\0\0\0\x01\x08\0\0\0\0", 13));
+  if (!clean) {
+    png_chunk(b, "eXIf", make_tiff(spec, r));
+    if (spec.xmp_bytes)
+      png_chunk(b, "iTXt", std::string("XML:com.adobe.xmp\0\0\0\0\0", 22) + make_xmp(spec.xmp_bytes, r));
+    png_chunk(b, "tEXt", std::string("Author\0", 7) + r.pick(kPeople));
+    png_chunk(b, "tEXt", std::string("Software\0", 9) + r.pick(kTools));
+  }
+  std::string raw("\x00\x80", 2); // filter byte + one gray pixel
+  std::string z("\x78\x01\x01\x02\x00\xFD\xFF", 7); // zlib header + stored final block
+  z += raw;
+  put32be(z, adler32(raw));
+  png_chunk(b, "IDAT", z);
+  png_chunk(b, "IEND", "");
+  return b;
+}
+
+void riff_chunk(std::string& b, const char* fourcc, const std::string& data) {
+  b.append(fourcc, 4);
+  put32le(b, std::uint32_t(data.size()));
+  b += data;
+  if (data.size() & 1) b += '\0';
+}
+
+std::string make_webp(const Spec& spec, Rng& r, bool clean) {
+  const std::string vp8l("\x2F\x00\x00\x00\x10\x07\x10\x11\x11\x88\x88\xFE\x07", 13); // 1x1 lossless
+  std::string body = "WEBP";
+  if (clean) {
+    riff_chunk(body, "VP8L", vp8l);
+  } else {
+    std::uint8_t flags = 0x08 | (spec.xmp_bytes ? 0x04 : 0);
+    std::string x(1, char(flags)); x.append(9, '\0'); // reserved + 24-bit (w-1),(h-1) = 0
+    riff_chunk(body, "VP8X", x);
+    riff_chunk(body, "VP8L", vp8l);
+    riff_chunk(body, "EXIF", make_tiff(spec, r));
+    if (spec.xmp_bytes) riff_chunk(body, "XMP ", make_xmp(spec.xmp_bytes, r));
+  }
+  std::string b = "RIFF";
+  put32le(b, std::uint32_t(body.size()));
+  return b + body;
+}
+
+// ---------- audio ----------
+std::uint32_t syncsafe(std::uint32_t v) {
+  return (v & 0x7F) | ((v & 0x3F80) << 1) | ((v & 0x1FC000) << 2) | ((v & 0xFE00000) << 3);
+}
+
+std::string id3_frame(const char* id, const std::string& data) {
+  std::string f(id, 4);
+  put32be(f, std::uint32_t(data.size()));
+  f += std::string(2, '\0');
+  return f + data;
+}
+
+std::string make_mp3(const Spec& spec, Rng& r, bool clean) {
+  std::string b;
+  std::string title = "Corpus Track " + std::to_string(r.below(1000));
+  std::string artist = r.pick(kPeople);
+  if (!clean) {
+    std::string frames;
+    frames += id3_frame("TIT2", '\0' + title);
+    frames += id3_frame("TPE1", '\0' + artist);
+    frames += id3_frame("TALB", '\0' + std::string("Corpus Sessions"));
+    frames += id3_frame("TYER", '\0' + std::to_string(1990 + r.below(34)));
+    frames += id3_frame("COMM", std::string("\0eng\0", 5) + "recorded in " + r.pick(kCities));
+    for (unsigned i = 0; i < spec.id3_frames; ++i)
+      frames += id3_frame("TXXX", '\0' + std::string("corpus_") + std::to_string(i) + '\0' + serial(r));
+    if (spec.id3_picture) {
+      std::string pic("\0image/jpeg\0\x03\0", 14);
+      for (std::size_t i = 0; i < spec.id3_picture; ++i) pic += char(r.next() & 0xFF);
+      frames += id3_frame("APIC", pic);
+    }
+    frames.append(256, '\0'); // padding
+    b = "ID3";
+    b += '\x03'; b += '\0'; b += '\0';
+    put32be(b, syncsafe(std::uint32_t(frames.size())));
+    b += frames;
+  }
+  // MPEG-1 Layer III, 128 kbit/s, 44.1 kHz, joint stereo: 417-byte silent frames
+  std::size_t n = std::max<std::size_t>(1, spec.audio_bytes / 417);
+  std::string frame("\xFF\xFB\x90\x64", 4);
+  frame.resize(417, '\0');
+  for (std::size_t i = 0; i < n; ++i) b += frame;
+  if (!clean) {
+    std::string v1 = "TAG";
+    auto fixed = [&](const std::string& s, std::size_t w) { std::string t = s.substr(0, w); t.resize(w, '\0'); v1 += t; };
+    fixed(title, 30); fixed(artist, 30); fixed("Corpus Sessions", 30); fixed("2020", 4); fixed("", 30);
+    v1 += '\xFF';
+    b += v1;
+  }
+  return b;
+}
+
+void flac_block(std::string& b, std::uint8_t type, bool last, const std::string& data) {
+  b += char((last ? 0x80 : 0) | type);
+  put24be(b, std::uint32_t(data.size()));
+  b += data;
+}
+
+std::string make_flac(const Spec& spec, Rng& r, bool clean) {
+  std::string b = "fLaC";
+  std::string si;
+  put16be(si, 4096); put16be(si, 4096);
+  put24be(si, 0); put24be(si, 0);
+  std::uint64_t packed = (std::uint64_t(44100) << 44) | (std::uint64_t(1) << 41) | (std::uint64_t(15) << 36);
+  for (int i = 7; i >= 0; --i) si += char((packed >> (8 * i)) & 0xFF);
+  si.append(16, '\0'); // MD5
+  flac_block(b, 0, false, si);
+  if (!clean) {
+    std::vector<std::string> cs{
+      "TITLE=Corpus Track " + std::to_string(r.below(1000)), std::string("ARTIST=") + r.pick(kPeople),
+      "ALBUM=Corpus Sessions", "DATE=" + std::to_string(1990 + r.below(34)),
+      std::string("LOCATION=") + r.pick(kCities)};
+    for (unsigned i = 0; i < spec.vorbis_comments; ++i)
+      cs.push_back("CORPUS_" + std::to_string(i) + "=" + serial(r));
+    std::string vc;
+    const std::string vendor = "metasweep corpus";
+    put32le(vc, std::uint32_t(vendor.size())); vc += vendor;
+    put32le(vc, std::uint32_t(cs.size()));
+    for (auto& c : cs) { put32le(vc, std::uint32_t(c.size())); vc += c; }
+    flac_block(b, 4, false, vc);
+  }
+  flac_block(b, 1, true, std::string(256, '\0')); // PADDING
+  std::string payload("\xFF\xF8", 2);
+  payload.resize(std::max<std::size_t>(2, spec.audio_bytes), '\0');
+  return b + payload;
+}
+
+// ---------- ZIP ----------
+std::string make_zip(const Spec& spec, Rng& r, bool clean) {
+  const bool z64 = spec.zip64 || spec.zip_entries > 0xFFFF;
+  struct Entry { std::string name, data, comment; std::uint32_t crc; std::uint64_t off; };
+  std::vector<Entry> es;
+  std::string b;
+  for (unsigned i = 0; i < spec.zip_entries; ++i) {
+    Entry e;
+    e.name = "docs/part_" + std::to_string(i / 64) + "/file_" + std::to_string(i) + ".txt";
+    e.data = "entry " + std::to_string(i) + " ";
+    e.data.append(32 + r.below(192), char('a' + r.below(26)));
+    if (!clean && r.below(4) == 0) e.comment = std::string("by ") + r.pick(kPeople);
+    e.crc = crc32(e.data);
+    e.off = b.size();
+
+    std::string extra;
+    if (!clean) { put16le(extra, 0x5455); put16le(extra, 5); extra += '\x01'; put32le(extra, 1600000000u + std::uint32_t(r.below(1u << 26))); }
+    if (z64) { put16le(extra, 0x0001); put16le(extra, 16); put64le(extra, e.data.size()); put64le(extra, e.data.size()); }
+    put32le(b, 0x04034b50);
+    put16le(b, z64 ? 45 : 20); put16le(b, 0); put16le(b, 0);
+    put16le(b, 0x6000); put16le(b, 0x5021); // 12:00, 2020-01-01
+    put32le(b, e.crc);
+    put32le(b, z64 ? 0xFFFFFFFFu : std::uint32_t(e.data.size()));
+    put32le(b, z64 ? 0xFFFFFFFFu : std::uint32_t(e.data.size()));
+    put16le(b, std::uint16_t(e.name.size())); put16le(b, std::uint16_t(extra.size()));
+    b += e.name; b += extra; b += e.data;
+    es.push_back(std::move(e));
+  }
+  const std::uint64_t cd_off = b.size();
+  for (auto& e : es) {
+    std::string extra;
+    if (!clean) { put16le(extra, 0x5455); put16le(extra, 5); extra += '\x01'; put32le(extra, 1600000000u); }
+    if (z64) { put16le(extra, 0x0001); put16le(extra, 24); put64le(extra, e.data.size()); put64le(extra, e.data.size()); put64le(extra, e.off); }
+    put32le(b, 0x02014b50);
+    put16le(b, 0x031E); put16le(b, z64 ? 45 : 20); put16le(b, 0); put16le(b, 0);
+    put16le(b, 0x6000); put16le(b, 0x5021);
+    put32le(b, e.crc);
+    put32le(b, z64 ? 0xFFFFFFFFu : std::uint32_t(e.data.size()));
+    put32le(b, z64 ? 0xFFFFFFFFu : std::uint32_t(e.data.size()));
+    put16le(b, std::uint16_t(e.name.size())); put16le(b, std::uint16_t(extra.size()));
+    put16le(b, std::uint16_t(e.comment.size()));
+    put16le(b, 0); put16le(b, 0); put32le(b, 0100644u << 16);
+    put32le(b, z64 ? 0xFFFFFFFFu : std::uint32_t(e.off));
+    b += e.name; b += extra; b += e.comment;
+  }
+  const std::uint64_t cd_size = b.size() - cd_off;
+  if (z64) {
+    const std::uint64_t rec_off = b.size();
+    put32le(b, 0x06064b50); put64le(b, 44);
+    put16le(b, 45); put16le(b, 45); put32le(b, 0); put32le(b, 0);
+    put64le(b, es.size()); put64le(b, es.size()); put64le(b, cd_size); put64le(b, cd_off);
+    put32le(b, 0x07064b50); put32le(b, 0); put64le(b, rec_off); put32le(b, 1);
+  }
+  std::string comment = clean ? "" : std::string("archived by ") + r.pick(kPeople) + " on " + stamp(r);
+  put32le(b, 0x06054b50);
+  put16le(b, 0); put16le(b, 0);
+  put16le(b, z64 ? 0xFFFF : std::uint16_t(es.size()));
+  put16le(b, z64 ? 0xFFFF : std::uint16_t(es.size()));
+  put32le(b, z64 ? 0xFFFFFFFFu : std::uint32_t(cd_size));
+  put32le(b, z64 ? 0xFFFFFFFFu : std::uint32_t(cd_off));
+  put16le(b, std::uint16_t(comment.size()));
+  return b + comment;
+}
+
+// ---------- PDF (streamed: sizes may reach GBs) ----------
+std::uint64_t write_pdf(const Spec& spec, Rng& r, bool clean, std::ofstream& o) {
+  std::uint64_t target = spec.pdf_min;
+  if (spec.pdf_max > spec.pdf_min) {
+    Rng sr(r.next(), 0, SaltSize);
+    double lo = std::log(double(spec.pdf_min)), hi = std::log(double(spec.pdf_max));
+    target = std::uint64_t(std::exp(lo + (hi - lo) * sr.unit()));
+  }
+  std::uint64_t pos = 0;
+  std::vector<std::uint64_t> offs;
+  auto put = [&](const std::string& s) { o.write(s.data(), std::streamsize(s.size())); pos += s.size(); };
+  auto obj = [&](const std::string& body) {
+    offs.push_back(pos);
+    put(std::to_string(offs.size()) + " 0 obj\n" + body + "\nendobj\n");
+  };
+
+  std::string info;
+  if (!clean) {
+    std::string d = "D:20" + std::to_string(10 + r.below(14)) + "0601120000Z";
+    info = "<< /Title (Corpus document " + std::to_string(r.below(10000)) + ")"
+           " /Author (" + r.pick(kPeople) + ") /Creator (" + r.pick(kTools) + ")"
+           " /Producer (" + r.pick(kTools) + ") /CreationDate (" + d + ") /ModDate (" + d + ") >>";
+  }
+  const std::string head = "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n";
+  const std::size_t nobj = clean ? 4 : 5;
+  // fixed overhead estimate so the payload lands the file near `target`
+  std::uint64_t overhead = head.size() + 260 + info.size() + 20 * (nobj + 1) + 120;
+  std::uint64_t payload = target > overhead ? target - overhead : 0;
+
+  put(head);
+  obj("<< /Type /Catalog /Pages 2 0 R >>");
+  obj("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+  obj("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Contents 4 0 R >>");
+  offs.push_back(pos);
+  put("4 0 obj\n<< /Length " + std::to_string(payload) + " >>\nstream\n");
+  {
+    std::string chunk;
+    while (chunk.size() < (1u << 20)) chunk += "% metasweep corpus padding line\n";
+    std::uint64_t left = payload;
+    while (left) {
+      std::size_t n = std::size_t(std::min<std::uint64_t>(left, chunk.size()));
+      o.write(chunk.data(), std::streamsize(n));
+      left -= n; pos += n;
+    }
+  }
+  put("\nendstream\nendobj\n");
+  if (!clean) obj(info);
+
+  const std::uint64_t xref = pos;
+  put("xref\n0 " + std::to_string(offs.size() + 1) + "\n0000000000 65535 f \n");
+  for (auto off : offs) {
+    char line[24];
+    std::snprintf(line, sizeof line, "%010llu 00000 n \n", static_cast<unsigned long long>(off));
+    put(line);
+  }
+  put("trailer\n<< /Size " + std::to_string(offs.size() + 1) + " /Root 1 0 R" +
+      (clean ? "" : " /Info 5 0 R") + " >>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n");
+  return pos;
+}
+
+const char* kind_ext(Kind k) {
+  switch (k) {
+    case Kind::Jpeg: return ".jpg";
+    case Kind::Png:  return ".png";
+    case Kind::Webp: return ".webp";
+    case Kind::Pdf:  return ".pdf";
+    case Kind::Mp3:  return ".mp3";
+    case Kind::Flac: return ".flac";
+    case Kind::Zip:  return ".zip";
+  }
+  return ".bin";
+}
+
+Kind choose_kind(const Spec& spec, std::size_t index) {
+  unsigned total = 0;
+  for (auto w : spec.mix) total += w;
+  if (!total) throw std::invalid_argument("corpus mix has no weight");
+  Rng r(spec.seed, index, SaltKind);
+  auto x = unsigned(r.below(total));
+  for (std::size_t k = 0; k < spec.mix.size(); ++k) {
+    if (x < spec.mix[k]) return Kind(k);
+    x -= spec.mix[k];
+  }
+  return Kind::Jpeg;
+}
+
+fs::path choose_dir(const Spec& spec, std::size_t index) {
+  fs::path p(spec.out_dir);
+  if (!spec.depth || !spec.fanout) return p;
+  Rng r(spec.seed, index, SaltDir);
+  char name[16];
+  for (unsigned l = 0; l < spec.depth; ++l) {
+    double u = r.unit();
+    if (spec.skewed) u = u * u * u;
+    std::snprintf(name, sizeof name, "d%02u", unsigned(u * spec.fanout));
+    p /= name;
+  }
+  return p;
+}
+
+} // namespace
+
+const char* kind_name(Kind k) { return kind_ext(k) + 1; }
+
+bool parse_kind(const std::string& s, Kind& out) {
+  static constexpr std::pair<std::string_view, Kind> names[] = {
+    {"jpeg", Kind::Jpeg}, {"jpg", Kind::Jpeg}, {"png", Kind::Png}, {"webp", Kind::Webp},
+    {"pdf", Kind::Pdf}, {"mp3", Kind::Mp3}, {"flac", Kind::Flac}, {"zip", Kind::Zip}};
+  for (auto& [n, k] : names) if (s == n) { out = k; return true; }
+  return false;
+}
+
+bool parse_size(const std::string& s, std::uint64_t& out) {
+  if (s.empty()) return false;
+  std::size_t i = 0;
+  std::uint64_t v = 0;
+  while (i < s.size() && s[i] >= '0' && s[i] <= '9') v = v * 10 + std::uint64_t(s[i++] - '0');
+  if (i == 0) return false;
+  std::string suf = s.substr(i);
+  if (suf == "" || suf == "B") out = v;
+  else if (suf == "K" || suf == "KB") out = v << 10;
+  else if (suf == "M" || suf == "MB") out = v << 20;
+  else if (suf == "G" || suf == "GB") out = v << 30;
+  else return false;
+  return true;
+}
+
+std::uint64_t write_file(const Spec& spec, Kind kind, std::size_t index, const std::string& path) {
+  Rng r(spec.seed, index, SaltMeta);
+  Rng c(spec.seed, index, SaltClean);
+  const bool clean = c.below(100) < spec.clean_pct;
+  std::ofstream o(path, std::ios::binary | std::ios::trunc);
+  if (!o) throw std::runtime_error("cannot write " + path);
+  if (kind == Kind::Pdf) return write_pdf(spec, r, clean, o);
+
+  std::string b;
+  switch (kind) {
+    case Kind::Jpeg: b = make_jpeg(spec, r, clean); break;
+    case Kind::Png:  b = make_png(spec, r, clean); break;
+    case Kind::Webp: b = make_webp(spec, r, clean); break;
+    case Kind::Mp3:  b = make_mp3(spec, r, clean); break;
+    case Kind::Flac: b = make_flac(spec, r, clean); break;
+    case Kind::Zip:  b = make_zip(spec, r, clean); break;
+    case Kind::Pdf:  break;
+  }
+  o.write(b.data(), std::streamsize(b.size()));
+  return b.size();
+}
+
+std::vector<Generated> generate(const Spec& spec) {
+  std::vector<Generated> out;
+  out.reserve(spec.count);
+  for (std::size_t i = 0; i < spec.count; ++i) {
+    Kind k = choose_kind(spec, i);
+    fs::path dir = choose_dir(spec, i);
+    fs::create_directories(dir);
+    char name[32];
+    std::snprintf(name, sizeof name, "%s_%06zu%s", k == Kind::Pdf || k == Kind::Zip ? "doc" :
+                  k == Kind::Mp3 || k == Kind::Flac ? "track" : "IMG", i, kind_ext(k));
+    auto path = (dir / name).string();
+    out.push_back({path, k, write_file(spec, k, i, path)});
+  }
+  return out;
+}
+
+} // namespace corpus
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace corpus {
+
+enum class Kind { Jpeg, Png, Webp, Pdf, Mp3, Flac, Zip };
+
+// Knobs for one generated corpus. Every file is a pure function of (seed, index),
+// so two runs with the same spec produce byte-identical trees.
+struct Spec {
+  std::string out_dir = "corpus";
+  std::size_t count = 100;
+  std::uint64_t seed = 1;
+
+  // relative weights per kind, indexed by Kind
+  std::vector<unsigned> mix{4, 1, 1, 2, 1, 1, 1};
+  // percentage of files generated without any metadata (second-pass runs)
+  unsigned clean_pct = 0;
+
+  // directory fan-out: files land `depth` levels deep, `fanout` dirs per level
+  unsigned depth = 0;
+  unsigned fanout = 0;
+  bool skewed = false; // zipf-like placement, a few hot dirs hold most files
+
+  // metadata density
+  unsigned exif_tags = 8;           // extra Exif IFD tags on top of the core set
+  std::size_t xmp_bytes = 2048;     // XMP packet size incl. padding (JPEG caps at 64 KB)
+  bool iptc = true;
+  unsigned id3_frames = 4;          // extra TXXX frames
+  std::size_t id3_picture = 0;      // APIC payload bytes
+  unsigned vorbis_comments = 4;     // extra Vorbis comments
+  std::size_t audio_bytes = 16384;  // payload after the tag block
+  std::uint64_t pdf_min = 1024;     // PDF size range, log-uniform between min and max
+  std::uint64_t pdf_max = 64 * 1024;
+  unsigned zip_entries = 16;
+  bool zip64 = false;
+};
+
+struct Generated {
+  std::string path;
+  Kind kind{};
+  std::uint64_t bytes = 0;
+};
+
+const char* kind_name(Kind k);
+bool parse_kind(const std::string& s, Kind& out);
+
+// "64K", "10M", "2G" -> bytes; returns false on garbage
+bool parse_size(const std::string& s, std::uint64_t& out);
+
+// Generate a single file of the given kind at path. `index` seeds content.
+std::uint64_t write_file(const Spec& spec, Kind kind, std::size_t index, const std::string& path);
+
+// Generate the whole tree; returns what was written in index order.
+std::vector<Generated> generate(const Spec& spec);
+
+} // namespace corpus
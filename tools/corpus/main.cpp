@@ -0,0 +1,86 @@
+#include <CLI/CLI.hpp>
+#include <fmt/format.h>
+#include <fstream>
+#include <sstream>
+#include "corpus.hpp"
+
+int main(int argc, char** argv) {
+  CLI::App app{"metasweep_mkcorpus — deterministic synthetic corpus for benchmarking"};
+
+  corpus::Spec spec;
+  std::string mix, shape = "flat", pdf_size, id3_picture, audio_bytes, xmp_bytes, manifest;
+  bool no_iptc = false;
+  app.add_option("-o,--out", spec.out_dir, "Output directory");
+  app.add_option("-n,--count", spec.count, "Number of files");
+  app.add_option("--seed", spec.seed, "Seed; same seed + options => identical corpus");
+  app.add_option("--mix", mix, "Weights, e.g. jpeg=4,png=1,pdf=2 (unlisted kinds get 0)");
+  app.add_option("--clean", spec.clean_pct, "Percent of files without metadata");
+  app.add_option("--shape", shape, "Directory fan-out: flat|wide|deep|share");
+  app.add_option("--depth", spec.depth, "Directory depth (overrides --shape)");
+  app.add_option("--fanout", spec.fanout, "Directories per level (overrides --shape)");
+  app.add_option("--exif-tags", spec.exif_tags, "Extra Exif tags per image");
+  app.add_option("--xmp-bytes", xmp_bytes, "XMP packet size, e.g. 2K, 60K (0 disables)");
+  app.add_flag("--no-iptc", no_iptc, "Omit IPTC in JPEGs");
+  app.add_option("--id3-frames", spec.id3_frames, "Extra TXXX frames per MP3");
+  app.add_option("--id3-picture", id3_picture, "APIC payload size per MP3, e.g. 200K");
+  app.add_option("--vorbis-comments", spec.vorbis_comments, "Extra Vorbis comments per FLAC");
+  app.add_option("--audio-bytes", audio_bytes, "Audio payload size, e.g. 4M");
+  app.add_option("--pdf-size", pdf_size, "PDF size or range MIN:MAX, e.g. 1K:2G");
+  app.add_option("--zip-entries", spec.zip_entries, "Entries per ZIP");
+  app.add_flag("--zip64", spec.zip64, "Write Zip64 records");
+  app.add_option("--manifest", manifest, "Write path/kind/bytes TSV");
+
+  try { app.parse(argc, argv); }
+  catch (const CLI::ParseError& e) { return app.exit(e); }
+
+  auto size_opt = [](const std::string& s, auto& dst, const char* what) {
+    if (s.empty()) return true;
+    std::uint64_t v = 0;
+    if (!corpus::parse_size(s, v)) { fmt::print(stderr, "bad {}: {}\n", what, s); return false; }
+    dst = static_cast<std::remove_reference_t<decltype(dst)>>(v);
+    return true;
+  };
+  if (!size_opt(xmp_bytes, spec.xmp_bytes, "--xmp-bytes") ||
+      !size_opt(id3_picture, spec.id3_picture, "--id3-picture") ||
+      !size_opt(audio_bytes, spec.audio_bytes, "--audio-bytes")) return 2;
+  if (!pdf_size.empty()) {
+    auto colon = pdf_size.find(':');
+    if (!size_opt(pdf_size.substr(0, colon), spec.pdf_min, "--pdf-size")) return 2;
+    spec.pdf_max = spec.pdf_min;
+    if (colon != std::string::npos && !size_opt(pdf_size.substr(colon + 1), spec.pdf_max, "--pdf-size")) return 2;
+  }
+  spec.iptc = !no_iptc;
+
+  if (!mix.empty()) {
+    std::fill(spec.mix.begin(), spec.mix.end(), 0u);
+    std::stringstream ss(mix);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      auto eq = item.find('=');
+      corpus::Kind k{};
+      if (!corpus::parse_kind(item.substr(0, eq), k)) { fmt::print(stderr, "unknown kind in --mix: {}\n", item); return 2; }
+      spec.mix[static_cast<size_t>(k)] = eq == std::string::npos ? 1u : static_cast<unsigned>(std::stoul(item.substr(eq + 1)));
+    }
+  }
+
+  // Presets modelled on what file shares tend to look like; explicit --depth/--fanout win.
+  if (!spec.depth && !spec.fanout) {
+    if (shape == "wide")       { spec.depth = 1; spec.fanout = 256; }
+    else if (shape == "deep")  { spec.depth = 8; spec.fanout = 2; }
+    else if (shape == "share") { spec.depth = 3; spec.fanout = 12; spec.skewed = true; }
+    else if (shape != "flat")  { fmt::print(stderr, "unknown --shape: {}\n", shape); return 2; }
+  }
+
+  std::vector<corpus::Generated> files;
+  try { files = corpus::generate(spec); }
+  catch (const std::exception& e) { fmt::print(stderr, "error: {}\n", e.what()); return 1; }
+
+  std::uint64_t total = 0;
+  for (auto& g : files) total += g.bytes;
+  if (!manifest.empty()) {
+    std::ofstream m(manifest, std::ios::binary | std::ios::trunc);
+    for (auto& g : files) m << g.path << '\t' << corpus::kind_name(g.kind) << '\t' << g.bytes << '\n';
+  }
+  fmt::print("Generated {} file{} ({} bytes) in {}\n", files.size(), files.size() == 1 ? "" : "s", total, spec.out_dir);
+  return 0;
+}